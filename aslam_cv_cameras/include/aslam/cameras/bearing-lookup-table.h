@@ -0,0 +1,75 @@
+#ifndef ASLAM_CAMERAS_BEARING_LOOKUP_TABLE_H_
+#define ASLAM_CAMERAS_BEARING_LOOKUP_TABLE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <aslam/cameras/distortion.h>
+#include <aslam/common/macros.h>
+
+namespace aslam {
+class Camera;
+
+/// \class BearingLookupTable
+/// \brief Table of the normalized bearing vectors of a camera at all integer pixel
+///        coordinates of the image, including the right and bottom image border.
+///
+/// Sub-pixel keypoints are back-projected by bilinear interpolation of the four surrounding
+/// bearing vectors. At a spacing of one pixel the interpolation error is far below the
+/// keypoint noise: below 1e-5 rad, i.e. a few thousandths of a pixel, even in the strongly
+/// distorted corners of the test cameras. The bearing vectors are stored in single precision
+/// to halve the memory, which adds an error of a few 1e-8 rad.
+/// Keypoints outside of the image and keypoints next to pixels that fail to back-project
+/// are back-projected exactly by the camera.
+class BearingLookupTable {
+ public:
+  ASLAM_POINTER_TYPEDEFS(BearingLookupTable);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /// \brief Builds the table by back-projecting all integer pixel coordinates of the camera.
+  explicit BearingLookupTable(const Camera& camera);
+
+  /// \brief Restores a table of the camera from stored nodes, e.g. from a calibration cache,
+  ///        instead of back-projecting them. The nodes must have been built for the current
+  ///        calibration of the camera, see \ref getBearings and \ref getNodeValidity.
+  BearingLookupTable(
+      const Camera& camera, const Eigen::Matrix3Xf& bearings,
+      const std::vector<unsigned char>& is_valid);
+
+  /// \brief Is the table built for the current intrinsics, distortion and image size of
+  ///        the camera?
+  bool isValidFor(const Camera& camera) const;
+
+  /// \brief Look up the normalized bearing vectors of the keypoints.
+  /// @param[in]  camera        The camera the table was built for, used for the keypoints
+  ///                           not covered by the table.
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_bearings  Normalized bearing vectors.
+  /// @param[out] out_success   Were the back-projections successful?
+  void getNormalizedBearingVectors(
+      const Camera& camera, const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+      Eigen::Matrix3Xd* out_bearings, std::vector<unsigned char>* out_success) const;
+
+  /// Normalized bearing vectors of the nodes in row-major order.
+  const Eigen::Matrix3Xf& getBearings() const { return bearings_; }
+
+  /// Could the nodes be back-projected?
+  const std::vector<unsigned char>& getNodeValidity() const { return is_valid_; }
+
+ private:
+  /// Number of nodes per row and column: one more than the pixels to cover the border.
+  int num_cols_;
+  int num_rows_;
+  /// Normalized bearing vectors of the nodes in row-major order.
+  Eigen::Matrix3Xf bearings_;
+  std::vector<unsigned char> is_valid_;
+
+  /// Calibration the table was built for.
+  Eigen::VectorXd intrinsics_;
+  Distortion::Type distortion_type_;
+  Eigen::VectorXd distortion_parameters_;
+};
+}  // namespace aslam
+#endif  // ASLAM_CAMERAS_BEARING_LOOKUP_TABLE_H_
@@ -1,10 +1,13 @@
 #ifndef ASLAM_CAMERAS_CAMERA_3D_LIDAR_H_
 #define ASLAM_CAMERAS_CAMERA_3D_LIDAR_H_
 
+#include <vector>
+
 #include <aslam/cameras/camera.h>
 #include <aslam/cameras/distortion.h>
 #include <aslam/common/crtp-clone.h>
 #include <aslam/common/macros.h>
+#include <aslam/common/parallel-process.h>
 #include <aslam/common/types.h>
 
 namespace aslam {
@@ -90,6 +93,43 @@ class Camera3DLidar : public aslam::Cloneable<Camera, Camera3DLidar> {
       const Eigen::MatrixBase<DerivedKeyPoint>& keypoint,
       const Eigen::MatrixBase<DerivedPoint3d>& point_3d) const;
 
+  /// \brief The image of the lidar wraps around the sensor, so its border does not bound
+  ///        the viewing rays: the cone contains all directions (cos_half_angle = -1).
+  virtual void getBoundingCone(Eigen::Vector3d* out_axis, double* out_cos_half_angle) const;
+
+  /// \brief There is no frustum that contains the viewing rays of the lidar.
+  /// @return Always false.
+  virtual bool getBoundingFrustum(Eigen::Matrix<double, 4, 3>* out_plane_normals) const;
+
+  /// @}
+
+  //////////////////////////////////////////////////////////////
+  /// \name Range image rasterization
+  /// @{
+
+  /// \brief Rasterizes a point cloud into a dense range image with a z-buffer: every pixel
+  ///        holds the range and the index of the nearest point that projects into it. Empty
+  ///        pixels have range 0 and index -1.
+  ///
+  /// A point falls into the pixel that contains its keypoint, i.e. the keypoint is floored
+  /// like in \ref rollingShutterDelayNanoSeconds, so the column of a pixel determines its
+  /// capture time. Points whose keypoint is outside the image are skipped like in
+  /// \ref project3, including points on the seam of the sweep that round to the image
+  /// width. The images are stored column-major and the z-buffer is resolved in parallel over
+  /// blocks of columns, so no two threads write to the same pixel. Ties are resolved towards
+  /// the lower point index, the result does not depend on the number of threads.
+  /// @param[in]  points_3d            The points in euclidean coordinates.
+  /// @param[out] out_range_image      Range of the nearest point per pixel (height x width).
+  /// @param[out] out_index_image      Index of the nearest point per pixel (height x width).
+  /// @param[out] out_column_delays_nanoseconds Capture time of every column relative to the
+  ///                                  first column. nullptr: calculation is skipped.
+  /// @param[in]  num_threads          Maximal number of threads.
+  void rasterizeRangeImage(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d, Eigen::MatrixXd* out_range_image,
+      Eigen::MatrixXi* out_index_image,
+      std::vector<int64_t>* out_column_delays_nanoseconds = nullptr,
+      size_t num_threads = common::getNumHardwareThreads()) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
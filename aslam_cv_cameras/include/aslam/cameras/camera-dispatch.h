@@ -0,0 +1,322 @@
+#ifndef ASLAM_CAMERAS_CAMERA_DISPATCH_H_
+#define ASLAM_CAMERAS_CAMERA_DISPATCH_H_
+
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+
+#include <aslam/cameras/camera-3d-lidar.h>
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/camera-unified-projection.h>
+#include <aslam/cameras/camera.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-null.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/cameras/distortion.h>
+#include <aslam/cameras/internal/radtan-kernel.h>
+
+/// Statically dispatched camera projection for hot loops.
+///
+/// Camera::project3 costs two virtual calls per point, one for the camera and one for the
+/// distortion, and neither can be inlined. The kernels below copy the parameters of one
+/// camera/distortion pair and project with the same arithmetic as the camera classes, in
+/// non-virtual inline functions. \ref visitProjectionKernel resolves the pair once and passes
+/// the matching kernel to a visitor with a templated call operator, so the loop inside the
+/// visitor is compiled once per pair with everything inlined:
+///
+///   struct ProjectAll {
+///     template <typename Kernel>
+///     void operator()(const Kernel& kernel) const {
+///       for (int i = 0; i < points.cols(); ++i) {
+///         results[i] = kernel.project3(points.col(i), &keypoint);
+///       }
+///     }
+///     ...
+///   };
+///   visitProjectionKernel(camera, ProjectAll{...});
+///
+/// C++14 code can pass a generic lambda instead. This header itself only requires C++11.
+///
+/// The kernels hold a reference to the camera and are only valid while the camera and its
+/// parameters are unchanged.
+namespace aslam {
+
+//////////////////////////////////////////////////////////////
+/// \name Distortion kernels
+/// @{
+
+/// \brief Kernel of \ref NullDistortion.
+class NullDistortionKernel {
+ public:
+  typedef NullDistortion DistortionType;
+  explicit NullDistortionKernel(const Distortion& /*distortion*/) {}
+  inline void distort(Eigen::Vector2d* /*point*/) const {}
+};
+
+/// \brief Kernel of \ref RadTanDistortion.
+class RadTanDistortionKernel {
+ public:
+  typedef RadTanDistortion DistortionType;
+  explicit RadTanDistortionKernel(const Distortion& distortion) {
+    const Eigen::VectorXd& parameters = distortion.getParameters();
+    CHECK_EQ(parameters.size(), 4);
+    coefficients_.k1 = parameters(0);
+    coefficients_.k2 = parameters(1);
+    coefficients_.p1 = parameters(2);
+    coefficients_.p2 = parameters(3);
+  }
+  inline void distort(Eigen::Vector2d* point) const {
+    internal::distortRadTan(coefficients_, point, nullptr, nullptr);
+  }
+
+ private:
+  internal::RadTanCoefficients coefficients_;
+};
+
+/// \brief Kernel of \ref EquidistantDistortion.
+class EquidistantDistortionKernel {
+ public:
+  typedef EquidistantDistortion DistortionType;
+  explicit EquidistantDistortionKernel(const Distortion& distortion)
+      : k_(distortion.getParameters()) {
+    CHECK_EQ(k_.size(), 4);
+  }
+  inline void distort(Eigen::Vector2d* point) const {
+    const double r = point->norm();
+    // Keypoint remains unchanged around the image center.
+    if (r < 1e-10) {
+      return;
+    }
+    const double theta = std::atan(r);
+    const double theta2 = theta * theta;
+    const double theta4 = theta2 * theta2;
+    const double theta6 = theta2 * theta4;
+    const double theta8 = theta4 * theta4;
+    const double thetad =
+        theta * (1 + k_(0) * theta2 + k_(1) * theta4 + k_(2) * theta6 + k_(3) * theta8);
+    *point *= thetad / r;
+  }
+
+ private:
+  Eigen::Vector4d k_;
+};
+
+/// \brief Kernel of \ref FisheyeDistortion.
+class FisheyeDistortionKernel {
+ public:
+  typedef FisheyeDistortion DistortionType;
+  explicit FisheyeDistortionKernel(const Distortion& distortion) {
+    CHECK_EQ(distortion.getParameters().size(), 1);
+    w_ = distortion.getParameters()(0);
+    mul2tanwby2_ = 2.0 * std::tan(w_ / 2.0);
+  }
+  inline void distort(Eigen::Vector2d* point) const {
+    // Limit w > 0.
+    if (w_ * w_ < 1e-5) {
+      return;
+    }
+    const double r_u = point->norm();
+    // Limit r_u > 0.
+    *point *= (r_u * r_u < 1e-5) ? mul2tanwby2_ / w_ : std::atan(mul2tanwby2_ * r_u) / (r_u * w_);
+  }
+
+ private:
+  double w_;
+  double mul2tanwby2_;
+};
+
+/// @}
+
+//////////////////////////////////////////////////////////////
+/// \name Projection kernels
+/// @{
+
+/// \brief Kernel of \ref PinholeCamera with the distortion kernel DistortionKernel.
+template <typename DistortionKernel>
+class PinholeProjectionKernel {
+ public:
+  typedef PinholeCamera CameraType;
+  explicit PinholeProjectionKernel(const PinholeCamera& camera)
+      : camera_(camera), distortion_(camera.getDistortion()),
+        fu_(camera.fu()), fv_(camera.fv()), cu_(camera.cu()), cv_(camera.cv()) {}
+
+  /// \brief Same as \ref Camera::project3.
+  template <typename DerivedPoint3d>
+  inline const ProjectionResult project3(
+      const Eigen::MatrixBase<DerivedPoint3d>& point_3d, Eigen::Vector2d* out_keypoint) const {
+    const double rz = 1.0 / point_3d[2];
+    Eigen::Vector2d keypoint(point_3d[0] * rz, point_3d[1] * rz);
+    distortion_.distort(&keypoint);
+    (*out_keypoint)[0] = fu_ * keypoint[0] + cu_;
+    (*out_keypoint)[1] = fv_ * keypoint[1] + cv_;
+    return camera_.evaluateProjectionResult(*out_keypoint, point_3d);
+  }
+
+  const PinholeCamera& camera() const { return camera_; }
+
+ private:
+  const PinholeCamera& camera_;
+  const DistortionKernel distortion_;
+  const double fu_, fv_, cu_, cv_;
+};
+
+/// \brief Kernel of \ref UnifiedProjectionCamera with the distortion kernel DistortionKernel.
+template <typename DistortionKernel>
+class UnifiedProjectionKernel {
+ public:
+  typedef UnifiedProjectionCamera CameraType;
+  explicit UnifiedProjectionKernel(const UnifiedProjectionCamera& camera)
+      : camera_(camera), distortion_(camera.getDistortion()), xi_(camera.xi()),
+        fov_parameter_(camera.fov_parameter(camera.xi())),
+        fu_(camera.fu()), fv_(camera.fv()), cu_(camera.cu()), cv_(camera.cv()) {}
+
+  /// \brief Same as \ref Camera::project3.
+  template <typename DerivedPoint3d>
+  inline const ProjectionResult project3(
+      const Eigen::MatrixBase<DerivedPoint3d>& point_3d, Eigen::Vector2d* out_keypoint) const {
+    const Eigen::Vector3d point = point_3d;
+    const double d = point.norm();
+    // Check if point will lead to a valid projection.
+    if (!(point[2] > -(fov_parameter_ * d))) {
+      out_keypoint->setZero();
+      return ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+    }
+    const double rz = 1.0 / (point[2] + xi_ * d);
+    Eigen::Vector2d keypoint(point[0] * rz, point[1] * rz);
+    distortion_.distort(&keypoint);
+    (*out_keypoint)[0] = fu_ * keypoint[0] + cu_;
+    (*out_keypoint)[1] = fv_ * keypoint[1] + cv_;
+    return camera_.evaluateProjectionResult(*out_keypoint, point);
+  }
+
+  const UnifiedProjectionCamera& camera() const { return camera_; }
+
+ private:
+  const UnifiedProjectionCamera& camera_;
+  const DistortionKernel distortion_;
+  const double xi_, fov_parameter_;
+  const double fu_, fv_, cu_, cv_;
+};
+
+/// \brief Kernel of \ref Camera3DLidar, the lidar has no distortion.
+class Lidar3DProjectionKernel {
+ public:
+  typedef Camera3DLidar CameraType;
+  explicit Lidar3DProjectionKernel(const Camera3DLidar& camera) : camera_(camera) {}
+
+  /// \brief Same as \ref Camera::project3.
+  template <typename DerivedPoint3d>
+  inline const ProjectionResult project3(
+      const Eigen::MatrixBase<DerivedPoint3d>& point_3d, Eigen::Vector2d* out_keypoint) const {
+    return camera_.project3Functional<double, NullDistortion>(
+        Eigen::Vector3d(point_3d), camera_.getParameters(), Eigen::VectorXd(), out_keypoint);
+  }
+
+  const Camera3DLidar& camera() const { return camera_; }
+
+ private:
+  const Camera3DLidar& camera_;
+};
+
+/// @}
+
+//////////////////////////////////////////////////////////////
+/// \name Dispatch
+/// @{
+
+namespace internal {
+template <template <typename> class ProjectionKernel, typename CameraType, typename Visitor>
+void visitDistortionKernel(const CameraType& camera, Visitor&& visitor) {
+  switch (camera.getDistortion().getType()) {
+    case Distortion::Type::kNoDistortion:
+      visitor(ProjectionKernel<NullDistortionKernel>(camera));
+      break;
+    case Distortion::Type::kRadTan:
+      visitor(ProjectionKernel<RadTanDistortionKernel>(camera));
+      break;
+    case Distortion::Type::kEquidistant:
+      visitor(ProjectionKernel<EquidistantDistortionKernel>(camera));
+      break;
+    case Distortion::Type::kFisheye:
+      visitor(ProjectionKernel<FisheyeDistortionKernel>(camera));
+      break;
+    default:
+      LOG(FATAL) << "Unknown distortion model: "
+                 << static_cast<std::underlying_type<Distortion::Type>::type>(
+                        camera.getDistortion().getType());
+  }
+}
+}  // namespace internal
+
+/// \brief Calls visitor(kernel) once with the projection kernel of the concrete camera and
+///        distortion model of the camera. The visitor needs a templated call operator.
+template <typename Visitor>
+void visitProjectionKernel(const Camera& camera, Visitor&& visitor) {
+  switch (camera.getType()) {
+    case Camera::Type::kPinhole:
+      internal::visitDistortionKernel<PinholeProjectionKernel>(
+          static_cast<const PinholeCamera&>(camera), std::forward<Visitor>(visitor));
+      break;
+    case Camera::Type::kUnifiedProjection:
+      internal::visitDistortionKernel<UnifiedProjectionKernel>(
+          static_cast<const UnifiedProjectionCamera&>(camera), std::forward<Visitor>(visitor));
+      break;
+    case Camera::Type::kLidar3D:
+      CHECK(camera.getDistortion().getType() == Distortion::Type::kNoDistortion);
+      visitor(Lidar3DProjectionKernel(static_cast<const Camera3DLidar&>(camera)));
+      break;
+    default:
+      LOG(FATAL) << "Unknown camera model: "
+                 << static_cast<std::underlying_type<Camera::Type>::type>(camera.getType());
+  }
+}
+
+namespace internal {
+/// Visitor of \ref applyProjectionKernel.
+template <typename Functor>
+class ProjectionKernelApplier {
+ public:
+  ProjectionKernelApplier(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d, Functor* functor)
+      : points_3d_(points_3d), functor_(*CHECK_NOTNULL(functor)) {}
+
+  template <typename Kernel>
+  void operator()(const Kernel& kernel) const {
+    Eigen::Vector2d keypoint;
+    const int num_points = static_cast<int>(points_3d_.cols());
+    for (int i = 0; i < num_points; ++i) {
+      const ProjectionResult result = kernel.project3(points_3d_.col(i), &keypoint);
+      functor_(i, keypoint, result);
+    }
+  }
+
+ private:
+  const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d_;
+  Functor& functor_;
+};
+}  // namespace internal
+
+/// \brief Projects all points with the projection kernel of the camera and calls
+///        functor(index, keypoint, projection_result) for every point. The functor is
+///        inlined into the loop of every camera/distortion pair.
+/// @param[in] camera    The camera.
+/// @param[in] points_3d The points in euclidean coordinates.
+/// @param[in] functor   Callable with the signature
+///                      void(int, const Eigen::Vector2d&, const ProjectionResult&).
+template <typename Functor>
+void applyProjectionKernel(
+    const Camera& camera, const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Functor&& functor) {
+  visitProjectionKernel(
+      camera, internal::ProjectionKernelApplier<typename std::remove_reference<Functor>::type>(
+                  points_3d, &functor));
+}
+
+/// @}
+
+}  // namespace aslam
+#endif  // ASLAM_CAMERAS_CAMERA_DISPATCH_H_
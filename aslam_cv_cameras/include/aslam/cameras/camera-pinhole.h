@@ -116,6 +116,57 @@ class PinholeCamera : public aslam::Cloneable<Camera, PinholeCamera> {
   virtual bool backProject3(const Eigen::Ref<const Eigen::Vector2d>& keypoint,
                             Eigen::Vector3d* out_point_3d) const;
 
+  /// \brief Compute the 3d bearing vectors in euclidean coordinates given a list of
+  ///        keypoints in image coordinates. The keypoints are undistorted as one batch,
+  ///        see \ref Distortion::undistortVectorized.
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_points_3d Bearing vectors in euclidean coordinates (with z=1).
+  /// @param[out] out_success   Were the projections successful? Always true for the
+  ///                           pinhole model.
+  virtual void backProject3Vectorized(const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+                                      Eigen::Matrix3Xd* out_points_3d,
+                                      std::vector<unsigned char>* out_success) const;
+
+  /// \brief Single precision version of \ref backProject3Vectorized, the keypoints are
+  ///        normalized and undistorted in single precision.
+  virtual void backProject3VectorizedFloat(const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+                                           Eigen::Matrix3Xf* out_points_3d,
+                                           std::vector<unsigned char>* out_success) const;
+
+  /// \brief Projects a matrix of euclidean points to 2d image measurements. Applies the
+  ///        projection (& distortion) models to the points.
+  ///
+  /// The points are processed in blocks laid out as structure of arrays so the null, radtan
+  /// and equidistant distortions run as vectorized Eigen array expressions. Other distortion
+  /// models fall back to the per-point base implementation.
+  /// @param[in]  points_3d     The points in euclidean coordinates.
+  /// @param[out] out_keypoints The keypoints in image coordinates.
+  /// @param[out] out_results   Contains information about the success of the
+  ///                           projections. Check \ref ProjectionResult for
+  ///                           more information.
+  virtual void project3Vectorized(const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+                                  Eigen::Matrix2Xd* out_keypoints,
+                                  std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Single precision version of \ref project3Vectorized, the blocks of the null,
+  ///        radtan and equidistant distortions are evaluated in single precision and hold
+  ///        twice as many points per SIMD register.
+  virtual void project3VectorizedFloat(const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+                                       Eigen::Matrix2Xf* out_keypoints,
+                                       std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Projects a matrix of euclidean points and computes the stacked Jacobians of the
+  ///        projections, see \ref Camera::project3VectorizedWithJacobians. The null and
+  ///        radtan distortions are evaluated inline with the parameters unpacked once;
+  ///        other distortion models fall back to the per-point base implementation.
+  virtual void project3VectorizedWithJacobians(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      Eigen::Matrix2Xd* out_keypoints,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+      std::vector<ProjectionResult>* out_results) const;
+
   /// \brief Checks the success of a projection operation and returns the result in a
   ///        ProjectionResult object.
   /// @param[in] keypoint Keypoint in image coordinates.
@@ -262,6 +313,14 @@ class PinholeCamera : public aslam::Cloneable<Camera, PinholeCamera> {
   /// \brief Minimal depth for a valid projection.
   static const double kMinimumDepth;
 
+  /// \brief Blocked projection shared by the double and single precision versions of
+  ///        project3Vectorized. Supports the null, radtan and equidistant distortions.
+  template <typename Scalar>
+  void project3VectorizedImpl(
+      const Eigen::Ref<const Eigen::Matrix<Scalar, 3, Eigen::Dynamic>>& points_3d,
+      Eigen::Matrix<Scalar, 2, Eigen::Dynamic>* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
   bool isValidImpl() const override;
   void setRandomImpl() override;
   bool isEqualImpl(const Sensor& other, const bool verbose) const override;
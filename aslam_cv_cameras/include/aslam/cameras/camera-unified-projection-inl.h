@@ -0,0 +1,26 @@
+#ifndef ASLAM_UNIFIED_PROJECTION_CAMERA_INL_H_
+#define ASLAM_UNIFIED_PROJECTION_CAMERA_INL_H_
+
+namespace aslam {
+
+inline const ProjectionResult UnifiedProjectionCamera::evaluateProjectionResult(
+    const Eigen::Ref<const Eigen::Vector2d>& keypoint,
+    const Eigen::Vector3d& point_3d) const {
+
+  const bool visibility = isKeypointVisible(keypoint);
+
+  const double d2 = point_3d.squaredNorm();
+  const double minDepth2 = kMinimumDepth*kMinimumDepth;
+
+  if (visibility && (d2 > minDepth2))
+    return ProjectionResult(ProjectionResult::Status::KEYPOINT_VISIBLE);
+  else if (!visibility && (d2 > minDepth2))
+    return ProjectionResult(ProjectionResult::Status::KEYPOINT_OUTSIDE_IMAGE_BOX);
+  else if (d2 <= minDepth2)
+    return ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+
+  return ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+}
+
+}  // namespace aslam
+#endif  // ASLAM_UNIFIED_PROJECTION_CAMERA_INL_H_
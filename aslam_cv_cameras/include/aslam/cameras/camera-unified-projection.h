@@ -122,6 +122,45 @@ class UnifiedProjectionCamera
   virtual bool backProject3(const Eigen::Ref<const Eigen::Vector2d>& keypoint,
                             Eigen::Vector3d* out_point_3d) const;
 
+  /// \brief Projects a matrix of euclidean points to 2d image measurements. Applies the
+  ///        projection (& distortion) models to the points.
+  ///
+  /// The points are processed in blocks laid out as structure of arrays with the fisheye
+  /// distortion fused into the projection, so the null and fisheye distortions run as
+  /// vectorized Eigen array expressions. Other distortion models fall back to the per-point
+  /// base implementation.
+  /// @param[in]  points_3d     The points in euclidean coordinates.
+  /// @param[out] out_keypoints The keypoints in image coordinates.
+  /// @param[out] out_results   Contains information about the success of the
+  ///                           projections. Check \ref ProjectionResult for
+  ///                           more information.
+  virtual void project3Vectorized(const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+                                  Eigen::Matrix2Xd* out_keypoints,
+                                  std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Projects a matrix of euclidean points and computes the stacked Jacobians of the
+  ///        projections, see \ref Camera::project3VectorizedWithJacobians. The null and
+  ///        radtan distortions are evaluated inline with the parameters unpacked once;
+  ///        other distortion models fall back to the per-point base implementation.
+  virtual void project3VectorizedWithJacobians(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      Eigen::Matrix2Xd* out_keypoints,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+      std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Compute the 3d bearing vectors in euclidean coordinates given a list of
+  ///        keypoints in image coordinates. Uses the projection (& distortion) models.
+  ///
+  /// Vectorized like project3Vectorized for the null and fisheye distortions.
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_points_3d Bearing vectors in euclidean coordinates.
+  /// @param[out] out_success   Were the projections successful?
+  virtual void backProject3Vectorized(const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+                                      Eigen::Matrix3Xd* out_points_3d,
+                                      std::vector<unsigned char>* out_success) const;
+
   /// \brief Checks the success of a projection operation and returns the result in a
   ///        ProjectionResult object.
   /// @param[in] keypoint Keypoint in image coordinates.
@@ -274,4 +313,6 @@ class UnifiedProjectionCamera
 
 }  // namespace aslam
 
+#include "aslam/cameras/camera-unified-projection-inl.h"
+
 #endif  // ASLAM_UNIFIED_PROJECTION_CAMERA_H_
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -23,6 +24,7 @@
 //}
 
 namespace aslam {
+class BearingLookupTable;
 
 // Forward declarations
 class MappedUndistorter;
@@ -107,6 +109,36 @@ struct ProjectionResult {
   Status status_;
 };
 
+/// \struct RollingShutterMotion
+/// \brief Constant velocity motion of a rolling shutter camera while it reads out an
+///        image. The velocities are expressed in the camera frame C0 at the capture time of
+///        the first line. The camera frame Ct at time t after the first line is given by
+///        R_C0_Ct = exp(t * angular_velocity) and C0_p_C0_Ct = t * linear_velocity.
+struct RollingShutterMotion {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  /// Linear velocity in meters per second.
+  Eigen::Vector3d linear_velocity = Eigen::Vector3d::Zero();
+  /// Angular velocity in radians per second.
+  Eigen::Vector3d angular_velocity = Eigen::Vector3d::Zero();
+};
+
+/// \struct RollingShutterProjectionReport
+/// \brief Convergence of a batched rolling shutter projection, see
+///        \ref Camera::project3RollingShutterVectorized.
+struct RollingShutterProjectionReport {
+  /// Number of iterations until all points converged or the iteration limit was reached.
+  int num_iterations = 0;
+  /// Points whose line coordinate changed less than the tolerance in the last iteration.
+  int num_converged = 0;
+  /// Points that did not converge within the iteration limit.
+  int num_not_converged = 0;
+  /// Points that left the domain of the projection, i.e. moved behind the camera.
+  int num_failed = 0;
+  /// Largest change of the line coordinate in the last iteration over all points that did
+  /// not converge. Infinity if they were only projected once.
+  double max_line_change = 0.0;
+};
+
 /// \class Camera
 /// \brief The base camera class provides methods to project/backproject
 /// euclidean and
@@ -191,10 +223,14 @@ class Camera : public Sensor {
         image_width_(other.image_width_),
         image_height_(other.image_height_),
         mask_(other.mask_.clone()),
+        use_packed_mask_(other.use_packed_mask_),
+        packed_mask_(other.packed_mask_),
+        packed_mask_words_per_row_(other.packed_mask_words_per_row_),
         is_compressed_(other.is_compressed_),
         intrinsics_(other.intrinsics_),
         camera_type_(other.camera_type_),
-        distortion_(nullptr) {
+        distortion_(nullptr),
+        use_bearing_lookup_table_(other.use_bearing_lookup_table_) {
     CHECK(other.distortion_);
     distortion_.reset(other.distortion_->clone());
   };
@@ -291,6 +327,34 @@ class Camera : public Sensor {
       Eigen::Matrix2Xd* out_keypoints,
       std::vector<ProjectionResult>* out_results) const;
 
+  /// \brief Projects a matrix of euclidean points to 2d image measurements and computes
+  ///        the Jacobians of all projections with the internal parameters. The
+  ///        Jacobians of point i are stored in the columns [3i, 3i + 3) of
+  ///        out_jacobians_point and likewise for the intrinsics and distortion
+  ///        parameters, so the Jacobians of one point are contiguous in memory. The
+  ///        Jacobians of projections with the status PROJECTION_INVALID are zero.
+  ///
+  /// This vanilla version just repeatedly calls project3Functional. Camera
+  /// implementers are encouraged to override for efficiency.
+  /// @param[in]  points_3d                The points in euclidean coordinates.
+  /// @param[out] out_keypoints            The keypoints in image coordinates.
+  /// @param[out] out_jacobians_point      The stacked 2x3 Jacobians wrt. the points.
+  ///                                        nullptr: calculation is skipped.
+  /// @param[out] out_jacobians_intrinsics The stacked Jacobians wrt. the intrinsics.
+  ///                                        nullptr: calculation is skipped.
+  /// @param[out] out_jacobians_distortion The stacked Jacobians wrt. the distortion
+  ///                                      parameters.
+  ///                                        nullptr: calculation is skipped.
+  /// @param[out] out_results              Contains information about the success of
+  ///                                      the projections.
+  virtual void project3VectorizedWithJacobians(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      Eigen::Matrix2Xd* out_keypoints,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+      std::vector<ProjectionResult>* out_results) const;
+
   /// \brief Compute the 3d bearing vector in euclidean coordinates given a
   /// keypoint in
   ///        image coordinates. Uses the projection (& distortion) models.
@@ -319,6 +383,30 @@ class Camera : public Sensor {
       const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
       Eigen::Matrix3Xd* out_points_3d,
       std::vector<unsigned char>* out_success) const;
+
+  /// \brief Single precision versions of project3Vectorized and backProject3Vectorized for
+  ///        consumers that store their points and keypoints as floats.
+  ///
+  /// Single precision has a relative resolution of 6e-8. The keypoints are accurate to
+  /// about 1e-3 pixels for images up to a few thousand pixels and the bearing vectors to
+  /// about 1e-6 rad. Consequently keypoints within this distance of the image border can
+  /// report a different visibility than the double precision versions.
+  /// These vanilla versions cast to double and call the double precision versions. Camera
+  /// implementers are encouraged to override them with a single precision evaluation.
+  /// @param[in]  points_3d     The points in euclidean coordinates.
+  /// @param[out] out_keypoints The keypoints in image coordinates.
+  /// @param[out] out_results   Contains information about the success of the projections.
+  virtual void project3VectorizedFloat(
+      const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+      Eigen::Matrix2Xf* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_points_3d Bearing vectors in euclidean coordinates.
+  /// @param[out] out_success   Were the projections successful?
+  virtual void backProject3VectorizedFloat(
+      const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+      Eigen::Matrix3Xf* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -481,6 +569,29 @@ class Camera : public Sensor {
   virtual LineDelayMode getLineDelayMode() const {
     return LineDelayMode::kRows;
   }
+
+  /// \brief Projects a batch of points into a moving rolling shutter camera.
+  ///
+  /// The keypoint of a point depends on the capture time of its line, which depends on the
+  /// keypoint. The time is solved by fixed-point iteration, starting from the first line:
+  /// the point is transformed into the camera pose at the current time and projected, the
+  /// line coordinate of the keypoint gives the next time. All points that did not converge
+  /// are projected together with \ref project3Vectorized in every iteration. Unlike
+  /// \ref rollingShutterDelayNanoSeconds, the line coordinate is not rounded down, so the
+  /// iteration converges to the continuous solution. Global shutter cameras project once.
+  /// @param[in]  points_3d      The points in the camera frame at the first line.
+  /// @param[in]  motion         Constant velocity motion of the camera.
+  /// @param[out] out_keypoints  The keypoints in image coordinates.
+  /// @param[out] out_results    Projection results at the solved capture times.
+  /// @param[out] out_report     Convergence of the batch. nullptr: not reported.
+  /// @param[in]  max_iterations Maximal number of projections per point.
+  /// @param[in]  tolerance_lines Convergence threshold on the change of the line
+  ///                            coordinate between two iterations.
+  void project3RollingShutterVectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d, const RollingShutterMotion& motion,
+      Eigen::Matrix2Xd* out_keypoints, std::vector<ProjectionResult>* out_results,
+      RollingShutterProjectionReport* out_report = nullptr, int max_iterations = 10,
+      double tolerance_lines = 1e-3) const;
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -530,6 +641,34 @@ class Camera : public Sensor {
       const Eigen::MatrixBase<DerivedKeyPoint>& keypoint,
       typename DerivedKeyPoint::Scalar margin) const;
 
+  /// \brief Cone that contains the viewing rays of all pixels, for culling landmarks before
+  ///        they are projected. A point can only be visible if
+  ///        axis.dot(point_3d) >= cos_half_angle * point_3d.norm().
+  ///
+  /// The cone is found from the back-projected rays of a pixel grid that spans the image up
+  /// to its outer edge and is widened by the largest angle between neighboring grid rays.
+  /// The interior is sampled too: with strong distortion of wide-angle models, the border
+  /// rays do not enclose the rays of the image. The bound is approximate, it only misses
+  /// rays if the distortion bends them by more than the widening between grid samples.
+  /// Cameras that see in every direction return cos_half_angle = -1. The cone is cached and
+  /// recomputed when the intrinsics, the distortion or the image size changed.
+  /// @param[out] out_axis           Unit axis of the cone in the camera frame.
+  /// @param[out] out_cos_half_angle Cosine of the half opening angle of the cone.
+  virtual void getBoundingCone(Eigen::Vector3d* out_axis, double* out_cos_half_angle) const;
+
+  /// \brief Frustum that contains the viewing rays of all pixels. A point can only be
+  ///        visible if (out_plane_normals * point_3d).minCoeff() >= 0.
+  ///
+  /// The frustum is the one of the pinhole camera that \ref common::getOptimalNewCameraMatrix
+  /// returns for alpha = 1 and undistort_to_pinhole, i.e. the bounding box of the rays on
+  /// the normalized image plane. It is found from the same pixel grid as the cone and
+  /// widened by the largest distance between neighboring grid points. Like the cone, the
+  /// bound is approximate.
+  /// @param[out] out_plane_normals Inward normals of the four side planes, one per row.
+  /// @return False if the rays do not all point in front of the camera (z > 0), the
+  ///         frustum is then not defined.
+  virtual bool getBoundingFrustum(Eigen::Matrix<double, 4, 3>* out_plane_normals) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -562,6 +701,7 @@ class Camera : public Sensor {
   /// Set the distortion model.
   void setDistortion(aslam::Distortion::UniquePtr& distortion) {
     distortion_ = std::move(distortion);
+    invalidateBearingLookupTable();
   };
 
   /// Is a distortion model set for this camera.
@@ -573,6 +713,7 @@ class Camera : public Sensor {
   /// Remove the distortion model from this camera.
   void removeDistortion() {
     distortion_.reset(new NullDistortion);
+    invalidateBearingLookupTable();
   };
   /// @}
 
@@ -595,6 +736,7 @@ class Camera : public Sensor {
   void setParameters(const Eigen::VectorXd& params) {
     CHECK_EQ(getParameterSize(), params.size());
     intrinsics_ = params;
+    invalidateBearingLookupTable();
   }
 
   /// Function to check whether the given intrinsic parameters are valid for
@@ -603,6 +745,42 @@ class Camera : public Sensor {
 
   /// @}
 
+  //////////////////////////////////////////////////////////////
+  /// \name Methods to use a lookup table of bearing vectors.
+  /// @{
+
+  /// \brief Enable or disable the bearing vector lookup table used by
+  ///        getNormalizedBearingVectors. The table is built lazily on the first call and
+  ///        rebuilt if the intrinsics, the distortion or the image size changed.
+  ///        See \ref BearingLookupTable for the accuracy of the lookup.
+  void setBearingLookupTableEnabled(bool enabled);
+
+  /// Is the bearing vector lookup table enabled?
+  bool isBearingLookupTableEnabled() const {
+    return use_bearing_lookup_table_;
+  }
+
+  /// \brief Get the bearing vector lookup table for the current calibration, it is built
+  ///        if necessary. The table must be enabled.
+  std::shared_ptr<const BearingLookupTable> getBearingLookupTable() const;
+
+  /// \brief Use a prebuilt bearing vector lookup table, e.g. restored from a calibration
+  ///        cache, instead of building it. Enables the table. The table must have been built
+  ///        for the current calibration of this camera.
+  void setBearingLookupTable(const std::shared_ptr<const BearingLookupTable>& table);
+
+  /// \brief Compute the normalized bearing vectors of a list of keypoints. Interpolates
+  ///        the bearing vectors from the lookup table if enabled, otherwise
+  ///        back-projects the keypoints with backProject3Vectorized.
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_bearings  Normalized bearing vectors.
+  /// @param[out] out_success   Were the back-projections successful?
+  void getNormalizedBearingVectors(
+      const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints, Eigen::Matrix3Xd* out_bearings,
+      std::vector<unsigned char>* out_success) const;
+
+  /// @}
+
   //////////////////////////////////////////////////////////////
   /// \name Methods to access the mask.
   /// @{
@@ -632,6 +810,20 @@ class Camera : public Sensor {
                                   static_cast<int>(keypoint[0])) == 0);
   }
 
+  /// \brief Batch version of \ref isMasked.
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_is_masked Bit per keypoint: is the keypoint outside of the image or
+  ///                           masked?
+  void areMasked(
+      const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+      std::vector<bool>* out_is_masked) const;
+
+  /// \brief Keep a copy of the mask with one bit per pixel for the batch mask test. The
+  ///        packed mask is an eighth of the size of the mask, so the masks of a camera rig
+  ///        stay in the cache while filtering the projections of many landmarks.
+  void setPackedMaskEnabled(bool enabled);
+  bool isPackedMaskEnabled() const { return use_packed_mask_; }
+
   /// @}
 
   /// \name Factory Methods
@@ -662,6 +854,14 @@ class Camera : public Sensor {
   void saveToYamlNodeImpl(YAML::Node*) const override;
 
  protected:
+  /// Rebuilds the packed mask from the mask, needs to be called whenever the mask changes.
+  void updatePackedMask();
+
+  /// Back-projects a regular grid of (num_steps + 1)^2 pixels that spans the image area,
+  /// from (0, 0) to the outer edge (width, height), stored row by row. The rays are
+  /// normalized. Returns false if a pixel can not be back-projected.
+  bool sampleImageRays(int num_steps, Eigen::Matrix3Xd* out_rays) const;
+
   /// The delay per scanline for a rolling shutter camera in nanoseconds.
   uint64_t line_delay_nanoseconds_;
   /// The width of the image.
@@ -670,6 +870,11 @@ class Camera : public Sensor {
   uint32_t image_height_;
   /// The image mask.
   cv::Mat_<uint8_t> mask_;
+  /// Is the packed mask used?
+  bool use_packed_mask_;
+  /// Rows of the mask packed into 64 bit words, a set bit marks a valid pixel.
+  std::vector<uint64_t> packed_mask_;
+  size_t packed_mask_words_per_row_;
   /// Has compressed images.
   bool is_compressed_;
 
@@ -681,6 +886,32 @@ class Camera : public Sensor {
 
   /// \brief The distortion for this camera.
   aslam::Distortion::UniquePtr distortion_;
+
+ private:
+  /// Drops the bearing vector lookup table, it is rebuilt on the next lookup.
+  void invalidateBearingLookupTable();
+
+  /// Bounding cone together with the calibration it was computed for.
+  struct BoundingCone {
+    Eigen::VectorXd intrinsics;
+    Distortion::Type distortion_type;
+    Eigen::VectorXd distortion_parameters;
+    uint32_t image_width;
+    uint32_t image_height;
+    Eigen::Vector3d axis;
+    double cos_half_angle;
+  };
+  /// Is the cone computed for the current calibration of this camera?
+  bool isBoundingConeValid(const BoundingCone& cone) const;
+  void computeBoundingCone(Eigen::Vector3d* out_axis, double* out_cos_half_angle) const;
+
+  bool use_bearing_lookup_table_;
+  /// Lazily built bearing vector lookup table, guarded by the mutex.
+  mutable std::shared_ptr<const BearingLookupTable> bearing_lookup_table_;
+  mutable std::mutex bearing_lookup_table_mutex_;
+  /// Lazily computed bounding cone, guarded by the mutex.
+  mutable std::unique_ptr<const BoundingCone> bounding_cone_;
+  mutable std::mutex bounding_cone_mutex_;
 };
 }  // namespace aslam
 #include "camera-inl.h"
@@ -145,6 +145,8 @@ class FisheyeDistortion : public aslam::Cloneable<Distortion, FisheyeDistortion>
   static double getMinValidW() {return kMinValidW; }
   /// Get the max valid w. W is valid in range [kMinValidW, kMaxValidW].
   static double getMaxValidW() { return kMaxValidW; }
+  /// Get the max angle r_d * w up to which a point can be undistorted.
+  static double getMaxValidAngle() { return kMaxValidAngle; }
  private:
   static constexpr double kMaxValidAngle = (89.0 * M_PI / 180.0);
   static constexpr double kMinValidW = 0.5;
@@ -121,6 +121,14 @@ class NullDistortion : public aslam::Cloneable<Distortion, NullDistortion> {
       const Eigen::VectorXd& /*dist_coeffs*/,
       Eigen::Vector2d* /*point*/) const {}
 
+  /// \brief Undistortion of a batch of points is a no-op for the null distortion.
+  virtual void undistortUsingExternalCoefficientsVectorized(
+      const Eigen::VectorXd& /*dist_coeffs*/,
+      Eigen::Matrix2Xd* /*points*/) const {}
+  virtual void undistortUsingExternalCoefficientsVectorized(
+      const Eigen::VectorXd& /*dist_coeffs*/,
+      Eigen::Matrix2Xf* /*points*/) const {}
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -86,6 +86,18 @@ class RadTanDistortion : public aslam::Cloneable<Distortion, RadTanDistortion> {
   virtual void undistortUsingExternalCoefficients(const Eigen::VectorXd& dist_coeffs,
                                                   Eigen::Vector2d* point) const;
 
+  /// \brief Apply undistortion to a batch of points using provided distortion coefficients.
+  /// @param[in]      dist_coeffs  Vector containing the coefficients for the distortion model.
+  /// @param[in,out]  points       The distorted points (one per column). After the function,
+  ///                              the points are in the normalized image plane.
+  virtual void undistortUsingExternalCoefficientsVectorized(const Eigen::VectorXd& dist_coeffs,
+                                                            Eigen::Matrix2Xd* points) const;
+
+  /// \brief Single precision version of the batch undistortion, the iteration runs in
+  ///        single precision as well.
+  virtual void undistortUsingExternalCoefficientsVectorized(const Eigen::VectorXd& dist_coeffs,
+                                                            Eigen::Matrix2Xf* points) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
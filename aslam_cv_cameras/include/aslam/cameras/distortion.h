@@ -135,6 +135,28 @@ class Distortion {
   virtual void undistortUsingExternalCoefficients(const Eigen::VectorXd& dist_coeffs,
                                                   Eigen::Vector2d* point) const = 0;
 
+  /// \brief Apply undistortion to a batch of points in the normalized image plane.
+  /// @param[in,out] points The distorted points (one per column). After the function, the
+  ///                       points are in the normalized image plane.
+  void undistortVectorized(Eigen::Matrix2Xd* points) const;
+
+  /// \brief Apply undistortion to a batch of points using provided distortion coefficients.
+  ///        The default implementation undistorts the points one by one, iterative models
+  ///        override it to amortize the per-call overhead over the batch.
+  /// @param[in]     dist_coeffs  Vector containing the coefficients for the distortion model.
+  /// @param[in,out] points       The distorted points (one per column). After the function,
+  ///                             the points are in the normalized image plane.
+  virtual void undistortUsingExternalCoefficientsVectorized(const Eigen::VectorXd& dist_coeffs,
+                                                            Eigen::Matrix2Xd* points) const;
+
+  /// \brief Single precision versions of the batch undistortion. The default implementation
+  ///        undistorts every point in double precision. Models that override it iterate in
+  ///        single precision: the points are then accurate to a few 1e-7 relative to their
+  ///        norm, far below a pixel for any focal length used in practice.
+  void undistortVectorized(Eigen::Matrix2Xf* points) const;
+  virtual void undistortUsingExternalCoefficientsVectorized(const Eigen::VectorXd& dist_coeffs,
+                                                            Eigen::Matrix2Xf* points) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
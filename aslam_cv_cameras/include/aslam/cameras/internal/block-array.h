@@ -0,0 +1,22 @@
+#ifndef ASLAM_CAMERAS_INTERNAL_BLOCK_ARRAY_H_
+#define ASLAM_CAMERAS_INTERNAL_BLOCK_ARRAY_H_
+
+#include <Eigen/Core>
+
+namespace aslam {
+namespace internal {
+
+// Number of points processed at once by the vectorized projection functions. The
+// temporaries of a block live on the stack and stay in the L1 cache.
+constexpr int kProjectionBlockSize = 256;
+
+// One coordinate of a block of points in structure-of-arrays layout.
+template <typename Scalar>
+using BlockArrayT =
+    Eigen::Array<Scalar, Eigen::Dynamic, 1, Eigen::ColMajor, kProjectionBlockSize, 1>;
+typedef BlockArrayT<double> BlockArray;
+
+}  // namespace internal
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_INTERNAL_BLOCK_ARRAY_H_
@@ -0,0 +1,56 @@
+#ifndef ASLAM_CAMERAS_INTERNAL_RADTAN_KERNEL_H_
+#define ASLAM_CAMERAS_INTERNAL_RADTAN_KERNEL_H_
+
+#include <Eigen/Core>
+
+namespace aslam {
+namespace internal {
+
+// Radial-tangential distortion coefficients unpacked once for a batch of points.
+struct RadTanCoefficients {
+  double k1 = 0.0;
+  double k2 = 0.0;
+  double p1 = 0.0;
+  double p2 = 0.0;
+};
+
+// Same arithmetic as RadTanDistortion::distortUsingExternalCoefficients and
+// RadTanDistortion::distortParameterJacobian without the virtual dispatch and the checks.
+// The Jacobians are skipped if nullptr.
+inline void distortRadTan(
+    const RadTanCoefficients& coefficients, Eigen::Vector2d* point,
+    Eigen::Matrix2d* out_jacobian_point, Eigen::Matrix<double, 2, 4>* out_jacobian_params) {
+  const double k1 = coefficients.k1;
+  const double k2 = coefficients.k2;
+  const double p1 = coefficients.p1;
+  const double p2 = coefficients.p2;
+  const double x = (*point)(0);
+  const double y = (*point)(1);
+
+  const double mx2_u = x * x;
+  const double my2_u = y * y;
+  const double mxy_u = x * y;
+  const double rho2_u = mx2_u + my2_u;
+  const double rho4_u = rho2_u * rho2_u;
+  const double rad_dist_u = k1 * rho2_u + k2 * rho4_u;
+
+  if (out_jacobian_point) {
+    const double radial_derivative = 2.0 * k1 + 4.0 * k2 * rho2_u;
+    const double duf_dv = radial_derivative * mxy_u + 2.0 * p1 * x + 2.0 * p2 * y;
+    (*out_jacobian_point) <<
+        1.0 + rad_dist_u + radial_derivative * mx2_u + 2.0 * p1 * y + 6.0 * p2 * x, duf_dv,
+        duf_dv, 1.0 + rad_dist_u + radial_derivative * my2_u + 2.0 * p2 * x + 6.0 * p1 * y;
+  }
+  if (out_jacobian_params) {
+    (*out_jacobian_params) << x * rho2_u, x * rho4_u, 2.0 * mxy_u, rho2_u + 2.0 * mx2_u,
+                              y * rho2_u, y * rho4_u, rho2_u + 2.0 * my2_u, 2.0 * mxy_u;
+  }
+
+  (*point)(0) = x + x * rad_dist_u + 2.0 * p1 * mxy_u + p2 * (rho2_u + 2.0 * mx2_u);
+  (*point)(1) = y + y * rad_dist_u + 2.0 * p2 * mxy_u + p1 * (rho2_u + 2.0 * my2_u);
+}
+
+}  // namespace internal
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_INTERNAL_RADTAN_KERNEL_H_
@@ -6,7 +6,9 @@
 #include <unordered_map>
 #include <vector>
 
+#include <Eigen/Core>
 #include <aslam/common/macros.h>
+#include <aslam/common/parallel-process.h>
 #include <aslam/common/pose-types.h>
 #include <aslam/common/sensor.h>
 #include <aslam/common/unique-id.h>
@@ -171,6 +173,26 @@ class NCamera : public Sensor {
   /// NCamera and all contained cameras.
   aslam::NCamera::Ptr cloneRigWithoutDistortion() const;
 
+  /// \brief Find the cameras that see each landmark and the keypoints of the landmarks.
+  ///
+  /// Every camera first discards the landmarks outside of its bounding cone
+  /// (\ref Camera::getBoundingCone), projects the remaining landmarks in one batch and drops
+  /// the keypoints that are outside of the image or masked. The cameras are processed in
+  /// parallel. The observations are returned as parallel arrays, sorted by camera and then
+  /// by landmark.
+  /// @param[in]  T_G_B                 Pose of the rig body frame in the global frame.
+  /// @param[in]  G_landmarks           The landmarks in the global frame.
+  /// @param[out] out_landmark_indices  Landmark index (column in G_landmarks) of every
+  ///                                   observation.
+  /// @param[out] out_camera_indices    Camera index of every observation.
+  /// @param[out] out_keypoints         Keypoint of every observation.
+  /// @param[in]  num_threads           Number of threads, at most one per camera is used.
+  void getVisibleLandmarks(
+      const Transformation& T_G_B, const Eigen::Ref<const Eigen::Matrix3Xd>& G_landmarks,
+      std::vector<int>* out_landmark_indices, std::vector<int>* out_camera_indices,
+      Eigen::Matrix2Xd* out_keypoints,
+      size_t num_threads = common::getNumHardwareThreads()) const;
+
  private:
   bool isValidImpl() const override;
 
@@ -0,0 +1,116 @@
+#include <aslam/cameras/bearing-lookup-table.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <aslam/cameras/camera.h>
+#include <aslam/common/parallel-process.h>
+#include <glog/logging.h>
+
+namespace aslam {
+
+BearingLookupTable::BearingLookupTable(const Camera& camera)
+    : num_cols_(static_cast<int>(camera.imageWidth()) + 1),
+      num_rows_(static_cast<int>(camera.imageHeight()) + 1),
+      intrinsics_(camera.getParameters()),
+      distortion_type_(camera.getDistortion().getType()),
+      distortion_parameters_(camera.getDistortion().getParameters()) {
+  CHECK_GT(camera.imageWidth(), 0u);
+  CHECK_GT(camera.imageHeight(), 0u);
+  bearings_.resize(Eigen::NoChange, num_cols_ * num_rows_);
+  is_valid_.resize(bearings_.cols(), false);
+
+  // Rows are handed to other threads in blocks of at least this many nodes.
+  constexpr int kMinNumNodesPerBlock = 4096;
+  const int num_cols = num_cols_;
+  aslam::common::parallelProcess(
+      num_rows_, aslam::common::getNumHardwareThreads(),
+      [this, &camera, num_cols](size_t row_begin, size_t row_end) {
+        const int num_nodes = static_cast<int>(row_end - row_begin) * num_cols;
+        const int first_node = static_cast<int>(row_begin) * num_cols;
+        Eigen::Matrix2Xd keypoints(2, num_nodes);
+        for (int node = 0; node < num_nodes; ++node) {
+          keypoints(0, node) = (first_node + node) % num_cols;
+          keypoints(1, node) = (first_node + node) / num_cols;
+        }
+        Eigen::Matrix3Xd points_3d;
+        std::vector<unsigned char> success;
+        camera.backProject3Vectorized(keypoints, &points_3d, &success);
+        for (int node = 0; node < num_nodes; ++node) {
+          const double norm = points_3d.col(node).norm();
+          is_valid_[first_node + node] = success[node] && std::isfinite(norm) && norm > 0.0;
+          bearings_.col(first_node + node) = (points_3d.col(node) / norm).cast<float>();
+        }
+      },
+      static_cast<size_t>(std::max(1, kMinNumNodesPerBlock / num_cols)));
+}
+
+BearingLookupTable::BearingLookupTable(
+    const Camera& camera, const Eigen::Matrix3Xf& bearings,
+    const std::vector<unsigned char>& is_valid)
+    : num_cols_(static_cast<int>(camera.imageWidth()) + 1),
+      num_rows_(static_cast<int>(camera.imageHeight()) + 1),
+      bearings_(bearings),
+      is_valid_(is_valid),
+      intrinsics_(camera.getParameters()),
+      distortion_type_(camera.getDistortion().getType()),
+      distortion_parameters_(camera.getDistortion().getParameters()) {
+  CHECK_EQ(bearings_.cols(), num_cols_ * num_rows_);
+  CHECK_EQ(is_valid_.size(), static_cast<size_t>(bearings_.cols()));
+}
+
+bool BearingLookupTable::isValidFor(const Camera& camera) const {
+  const Distortion& distortion = camera.getDistortion();
+  return num_cols_ == static_cast<int>(camera.imageWidth()) + 1 &&
+         num_rows_ == static_cast<int>(camera.imageHeight()) + 1 &&
+         distortion_type_ == distortion.getType() &&
+         intrinsics_.size() == camera.getParameters().size() &&
+         intrinsics_ == camera.getParameters() &&
+         distortion_parameters_.size() == distortion.getParameters().size() &&
+         distortion_parameters_ == distortion.getParameters();
+}
+
+void BearingLookupTable::getNormalizedBearingVectors(
+    const Camera& camera, const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+    Eigen::Matrix3Xd* out_bearings, std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_bearings);
+  CHECK_NOTNULL(out_success);
+  const int num_keypoints = static_cast<int>(keypoints.cols());
+  out_bearings->resize(Eigen::NoChange, num_keypoints);
+  out_success->resize(num_keypoints);
+
+  const double max_u = static_cast<double>(num_cols_ - 1);
+  const double max_v = static_cast<double>(num_rows_ - 1);
+  Eigen::Vector3d point_3d;
+  for (int i = 0; i < num_keypoints; ++i) {
+    const double u = keypoints(0, i);
+    const double v = keypoints(1, i);
+    // The negated comparisons also catch NaNs.
+    if (!(u >= 0.0 && u <= max_u && v >= 0.0 && v <= max_v)) {
+      (*out_success)[i] = camera.backProject3(keypoints.col(i), &point_3d);
+      out_bearings->col(i) = point_3d.normalized();
+      continue;
+    }
+    // Keypoints on the right or bottom border use the last cell.
+    const int col = std::min(static_cast<int>(u), num_cols_ - 2);
+    const int row = std::min(static_cast<int>(v), num_rows_ - 2);
+    const int node = row * num_cols_ + col;
+    if (!(is_valid_[node] && is_valid_[node + 1] && is_valid_[node + num_cols_] &&
+          is_valid_[node + num_cols_ + 1])) {
+      (*out_success)[i] = camera.backProject3(keypoints.col(i), &point_3d);
+      out_bearings->col(i) = point_3d.normalized();
+      continue;
+    }
+    const double a = u - col;
+    const double b = v - row;
+    const Eigen::Vector3d bearing =
+        (1.0 - b) * ((1.0 - a) * bearings_.col(node).cast<double>() +
+                     a * bearings_.col(node + 1).cast<double>()) +
+        b * ((1.0 - a) * bearings_.col(node + num_cols_).cast<double>() +
+             a * bearings_.col(node + num_cols_ + 1).cast<double>());
+    out_bearings->col(i) = bearing.normalized();
+    (*out_success)[i] = true;
+  }
+}
+
+}  // namespace aslam
@@ -1,14 +1,22 @@
 #include "aslam/cameras/camera-3d-lidar.h"
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <utility>
 
 #include <aslam/cameras/camera-factory.h>
+#include <aslam/common/parallel-process.h>
 #include <aslam/common/types.h>
 
 #include "aslam/cameras/random-camera-generator.h"
 
 namespace aslam {
+namespace {
+// Smaller point clouds are rasterized on the calling thread only.
+constexpr size_t kMinNumPointsPerThread = 4096u;
+}  // namespace
+
 std::ostream& operator<<(std::ostream& out, const Camera3DLidar& camera) {
   camera.printParameters(out, std::string(""));
   return out;
@@ -73,6 +81,144 @@ const ProjectionResult Camera3DLidar::project3Functional(
       point_3d, *intrinsics, dummy_distortion_coefficients, out_keypoint);
 }
 
+void Camera3DLidar::rasterizeRangeImage(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d, Eigen::MatrixXd* out_range_image,
+    Eigen::MatrixXi* out_index_image, std::vector<int64_t>* out_column_delays_nanoseconds,
+    size_t num_threads) const {
+  CHECK_NOTNULL(out_range_image);
+  CHECK_NOTNULL(out_index_image);
+  CHECK_GT(num_threads, 0u);
+  const int width = static_cast<int>(imageWidth());
+  const int height = static_cast<int>(imageHeight());
+  const int num_points = static_cast<int>(points_3d.cols());
+  out_range_image->setZero(height, width);
+  out_index_image->setConstant(height, width, -1);
+  if (out_column_delays_nanoseconds != nullptr) {
+    out_column_delays_nanoseconds->resize(width);
+    for (int col = 0; col < width; ++col) {
+      (*out_column_delays_nanoseconds)[col] =
+          rollingShutterDelayNanoSeconds(Eigen::Vector2d(col, 0.0));
+    }
+  }
+  if (num_points == 0 || width == 0 || height == 0) {
+    return;
+  }
+
+  num_threads = std::max<size_t>(
+      1u, std::min(num_threads, static_cast<size_t>(num_points) / kMinNumPointsPerThread));
+  const size_t num_point_blocks =
+      std::min(num_threads, static_cast<size_t>(num_points));
+  const size_t num_column_blocks = std::min(num_threads, static_cast<size_t>(width));
+  auto point_block_begin = [&](size_t block_idx) {
+    return static_cast<int>(num_points * block_idx / num_point_blocks);
+  };
+  auto column_block_begin = [&](size_t block_idx) {
+    return static_cast<int>(width * block_idx / num_column_blocks);
+  };
+
+  // Project the points and count the points per column block. Same model as
+  // project3Functional, the pixel index is -1 for points that are not visible.
+  const double horizontal_resolution = horizontalResolution();
+  const double vertical_resolution = verticalResolution();
+  const double horizontal_center = horizontalCenter();
+  const double vertical_center = verticalCenter();
+  std::vector<int> pixel_index(num_points);
+  std::vector<double> ranges(num_points);
+  std::vector<std::vector<size_t>> block_counts(
+      num_point_blocks, std::vector<size_t>(num_column_blocks, 0u));
+  common::parallelProcess(num_point_blocks, num_threads, [&](size_t begin, size_t end) {
+    for (size_t block_idx = begin; block_idx < end; ++block_idx) {
+      std::vector<size_t>& counts = block_counts[block_idx];
+      size_t column_block = 0u;
+      for (int i = point_block_begin(block_idx); i < point_block_begin(block_idx + 1u); ++i) {
+        pixel_index[i] = -1;
+        const double range = points_3d.col(i).norm();
+        ranges[i] = range;
+        if (range < 1e-6 || range * range <= kSquaredMinimumDepth) {
+          continue;
+        }
+        double u = (std::atan2(points_3d(0, i), points_3d(2, i)) + horizontal_center) /
+                   horizontal_resolution;
+        if (u < 0.0) {
+          u += width;
+        }
+        const double v =
+            (std::asin(points_3d(1, i) / range) + vertical_center) / vertical_resolution;
+        // Like project3, this rejects points on the seam of the sweep whose wrapped u rounds
+        // to the image width.
+        if (!(u >= 0.0 && v >= 0.0 && u < width && v < height)) {
+          continue;
+        }
+        const int col = static_cast<int>(u);
+        const int row = static_cast<int>(v);
+        pixel_index[i] = col * height + row;
+
+        // Points are mostly sorted by azimuth, start the search at the last block.
+        while (col < column_block_begin(column_block)) {
+          --column_block;
+        }
+        while (col >= column_block_begin(column_block + 1u)) {
+          ++column_block;
+        }
+        ++counts[column_block];
+      }
+    }
+  });
+
+  // Prefix sum over column blocks and point blocks, afterwards block_counts holds the
+  // position of the first point of every point block in every column block.
+  std::vector<size_t> column_block_offsets(num_column_blocks + 1u, 0u);
+  size_t offset = 0u;
+  for (size_t column_block = 0u; column_block < num_column_blocks; ++column_block) {
+    column_block_offsets[column_block] = offset;
+    for (std::vector<size_t>& counts : block_counts) {
+      const size_t count = counts[column_block];
+      counts[column_block] = offset;
+      offset += count;
+    }
+  }
+  column_block_offsets[num_column_blocks] = offset;
+
+  // Scatter the visible points into their column blocks, stable in the point index.
+  std::vector<int> sorted_points(offset);
+  common::parallelProcess(num_point_blocks, num_threads, [&](size_t begin, size_t end) {
+    for (size_t block_idx = begin; block_idx < end; ++block_idx) {
+      std::vector<size_t>& positions = block_counts[block_idx];
+      size_t column_block = 0u;
+      for (int i = point_block_begin(block_idx); i < point_block_begin(block_idx + 1u); ++i) {
+        if (pixel_index[i] < 0) {
+          continue;
+        }
+        const int col = pixel_index[i] / height;
+        while (col < column_block_begin(column_block)) {
+          --column_block;
+        }
+        while (col >= column_block_begin(column_block + 1u)) {
+          ++column_block;
+        }
+        sorted_points[positions[column_block]++] = i;
+      }
+    }
+  });
+
+  // Z-buffer, every column block is owned by one thread.
+  double* range_data = out_range_image->data();
+  int* index_data = out_index_image->data();
+  common::parallelProcess(num_column_blocks, num_threads, [&](size_t begin, size_t end) {
+    for (size_t column_block = begin; column_block < end; ++column_block) {
+      for (size_t k = column_block_offsets[column_block];
+           k < column_block_offsets[column_block + 1u]; ++k) {
+        const int i = sorted_points[k];
+        const int pixel = pixel_index[i];
+        if (index_data[pixel] < 0 || ranges[i] < range_data[pixel]) {
+          range_data[pixel] = ranges[i];
+          index_data[pixel] = i;
+        }
+      }
+    }
+  });
+}
+
 Eigen::Vector2d Camera3DLidar::createRandomKeypoint() const {
   Eigen::Vector2d out;
   out.setRandom();
@@ -98,6 +244,17 @@ Eigen::Vector3d Camera3DLidar::createRandomVisiblePoint(double depth) const {
   return point_3d * depth;
 }
 
+void Camera3DLidar::getBoundingCone(
+    Eigen::Vector3d* out_axis, double* out_cos_half_angle) const {
+  *CHECK_NOTNULL(out_axis) = Eigen::Vector3d::UnitZ();
+  *CHECK_NOTNULL(out_cos_half_angle) = -1.0;
+}
+
+bool Camera3DLidar::getBoundingFrustum(
+    Eigen::Matrix<double, 4, 3>* /*out_plane_normals*/) const {
+  return false;
+}
+
 void Camera3DLidar::getBorderRays(Eigen::MatrixXd& rays) const {
   rays.resize(4, 8);
   Eigen::Vector4d ray;
@@ -152,6 +309,7 @@ void Camera3DLidar::setRandomImpl() {
   image_width_ = test_camera->image_width_;
   image_height_ = test_camera->image_height_;
   mask_ = test_camera->mask_;
+  updatePackedMask();
   intrinsics_ = test_camera->intrinsics_;
   camera_type_ = test_camera->camera_type_;
   if (test_camera->distortion_) {
@@ -1,14 +1,72 @@
+#include <algorithm>
 #include <memory>
 #include <utility>
 
 #include <aslam/cameras/camera-pinhole.h>
 
 #include <aslam/cameras/camera-factory.h>
+#include <aslam/cameras/internal/block-array.h>
+#include <aslam/cameras/internal/radtan-kernel.h>
 #include <aslam/common/types.h>
 
 #include "aslam/cameras/random-camera-generator.h"
 
 namespace aslam {
+namespace {
+using internal::BlockArrayT;
+using internal::kProjectionBlockSize;
+
+// Same arithmetic as RadTanDistortion::distortUsingExternalCoefficients.
+template <typename Scalar>
+void distortRadTanBlock(
+    const Eigen::VectorXd& dist_coeffs, BlockArrayT<Scalar>* x, BlockArrayT<Scalar>* y) {
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  typedef BlockArrayT<Scalar> BlockArray;
+  const Scalar k1 = static_cast<Scalar>(dist_coeffs(0));
+  const Scalar k2 = static_cast<Scalar>(dist_coeffs(1));
+  const Scalar p1 = static_cast<Scalar>(dist_coeffs(2));
+  const Scalar p2 = static_cast<Scalar>(dist_coeffs(3));
+  const Scalar two(2);
+
+  const BlockArray mx2_u = x->square();
+  const BlockArray my2_u = y->square();
+  const BlockArray mxy_u = *x * *y;
+  const BlockArray rho2_u = mx2_u + my2_u;
+  const BlockArray rad_dist_u = k1 * rho2_u + k2 * rho2_u * rho2_u;
+
+  *x += *x * rad_dist_u + two * p1 * mxy_u + p2 * (rho2_u + two * mx2_u);
+  *y += *y * rad_dist_u + two * p2 * mxy_u + p1 * (rho2_u + two * my2_u);
+}
+
+// Same arithmetic as EquidistantDistortion::distortUsingExternalCoefficients.
+template <typename Scalar>
+void distortEquidistantBlock(
+    const Eigen::VectorXd& dist_coeffs, BlockArrayT<Scalar>* x, BlockArrayT<Scalar>* y) {
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  typedef BlockArrayT<Scalar> BlockArray;
+  const Scalar k1 = static_cast<Scalar>(dist_coeffs(0));
+  const Scalar k2 = static_cast<Scalar>(dist_coeffs(1));
+  const Scalar k3 = static_cast<Scalar>(dist_coeffs(2));
+  const Scalar k4 = static_cast<Scalar>(dist_coeffs(3));
+
+  const BlockArray r = (x->square() + y->square()).sqrt();
+  const BlockArray theta = r.atan();
+  const BlockArray theta2 = theta * theta;
+  const BlockArray theta4 = theta2 * theta2;
+  const BlockArray theta6 = theta2 * theta4;
+  const BlockArray theta8 = theta4 * theta4;
+  const BlockArray thetad =
+      theta * (Scalar(1) + k1 * theta2 + k2 * theta4 + k3 * theta6 + k4 * theta8);
+  // Points around the image center remain unchanged, same threshold as
+  // EquidistantDistortion::distortUsingExternalCoefficients.
+  const BlockArray scaling = (r < Scalar(1e-10)).select(Scalar(1), thetad / r);
+  *x *= scaling;
+  *y *= scaling;
+}
+}  // namespace
+
 std::ostream& operator<<(std::ostream& out, const PinholeCamera& camera) {
   camera.printParameters(out, std::string(""));
   return out;
@@ -62,6 +120,48 @@ bool PinholeCamera::backProject3(const Eigen::Ref<const Eigen::Vector2d>& keypoi
   return true;
 }
 
+void PinholeCamera::backProject3Vectorized(const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+                                           Eigen::Matrix3Xd* out_points_3d,
+                                           std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+
+  Eigen::Matrix2Xd normalized_points(2, keypoints.cols());
+  normalized_points.row(0) = (keypoints.row(0).array() - cu()) / fu();
+  normalized_points.row(1) = (keypoints.row(1).array() - cv()) / fv();
+
+  distortion_->undistortVectorized(&normalized_points);
+
+  out_points_3d->resize(Eigen::NoChange, keypoints.cols());
+  out_points_3d->topRows<2>() = normalized_points;
+  out_points_3d->row(2).setOnes();
+
+  // Always valid for the pinhole model.
+  out_success->assign(keypoints.cols(), true);
+}
+
+void PinholeCamera::backProject3VectorizedFloat(
+    const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints, Eigen::Matrix3Xf* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+
+  Eigen::Matrix2Xf normalized_points(2, keypoints.cols());
+  normalized_points.row(0) =
+      (keypoints.row(0).array() - static_cast<float>(cu())) / static_cast<float>(fu());
+  normalized_points.row(1) =
+      (keypoints.row(1).array() - static_cast<float>(cv())) / static_cast<float>(fv());
+
+  distortion_->undistortVectorized(&normalized_points);
+
+  out_points_3d->resize(Eigen::NoChange, keypoints.cols());
+  out_points_3d->topRows<2>() = normalized_points;
+  out_points_3d->row(2).setOnes();
+
+  // Always valid for the pinhole model.
+  out_success->assign(keypoints.cols(), true);
+}
+
 const ProjectionResult PinholeCamera::project3Functional(
     const Eigen::Ref<const Eigen::Vector3d>& point_3d,
     const Eigen::VectorXd* intrinsics_external,
@@ -163,6 +263,204 @@ const ProjectionResult PinholeCamera::project3Functional(
   return evaluateProjectionResult(*out_keypoint, point_3d);
 }
 
+template <typename Scalar>
+void PinholeCamera::project3VectorizedImpl(
+    const Eigen::Ref<const Eigen::Matrix<Scalar, 3, Eigen::Dynamic>>& points_3d,
+    Eigen::Matrix<Scalar, 2, Eigen::Dynamic>* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  typedef BlockArrayT<Scalar> BlockArray;
+
+  const Distortion::Type distortion_type = getDistortion().getType();
+  CHECK(distortion_type == Distortion::Type::kNoDistortion ||
+        distortion_type == Distortion::Type::kRadTan ||
+        distortion_type == Distortion::Type::kEquidistant);
+  const Eigen::VectorXd& distortion_coefficients = getDistortion().getParameters();
+  const Scalar fu = static_cast<Scalar>(this->fu());
+  const Scalar fv = static_cast<Scalar>(this->fv());
+  const Scalar cu = static_cast<Scalar>(this->cu());
+  const Scalar cv = static_cast<Scalar>(this->cv());
+
+  const int num_points = static_cast<int>(points_3d.cols());
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  out_results->resize(num_points, ProjectionResult::Status::UNINITIALIZED);
+
+  BlockArray x, y, z;
+  for (int block_start = 0; block_start < num_points; block_start += kProjectionBlockSize) {
+    const int block_size = std::min(kProjectionBlockSize, num_points - block_start);
+
+    // Transpose the block to structure of arrays and project onto the normalized image plane.
+    z = points_3d.row(2).segment(block_start, block_size).transpose();
+    const BlockArray rz = z.inverse();
+    x = points_3d.row(0).segment(block_start, block_size).transpose().array() * rz;
+    y = points_3d.row(1).segment(block_start, block_size).transpose().array() * rz;
+
+    switch (distortion_type) {
+      case Distortion::Type::kRadTan:
+        distortRadTanBlock(distortion_coefficients, &x, &y);
+        break;
+      case Distortion::Type::kEquidistant:
+        distortEquidistantBlock(distortion_coefficients, &x, &y);
+        break;
+      default:
+        break;
+    }
+
+    // Normalized image plane to camera plane.
+    x = fu * x + cu;
+    y = fv * y + cv;
+    out_keypoints->row(0).segment(block_start, block_size) = x.matrix().transpose();
+    out_keypoints->row(1).segment(block_start, block_size) = y.matrix().transpose();
+
+    // Same decision as evaluateProjectionResult.
+    for (int i = 0; i < block_size; ++i) {
+      const bool is_visible = x(i) >= Scalar(0) && y(i) >= Scalar(0) &&
+                              x(i) < static_cast<Scalar>(imageWidth()) &&
+                              y(i) < static_cast<Scalar>(imageHeight());
+      ProjectionResult::Status status;
+      if (z(i) > kMinimumDepth) {
+        status = is_visible ? ProjectionResult::Status::KEYPOINT_VISIBLE
+                            : ProjectionResult::Status::KEYPOINT_OUTSIDE_IMAGE_BOX;
+      } else if (z(i) < Scalar(0)) {
+        status = ProjectionResult::Status::POINT_BEHIND_CAMERA;
+      } else {
+        status = ProjectionResult::Status::PROJECTION_INVALID;
+      }
+      (*out_results)[block_start + i] = ProjectionResult(status);
+    }
+  }
+}
+
+void PinholeCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d, Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  const Distortion::Type distortion_type = getDistortion().getType();
+  if (distortion_type != Distortion::Type::kNoDistortion &&
+      distortion_type != Distortion::Type::kRadTan &&
+      distortion_type != Distortion::Type::kEquidistant) {
+    Camera::project3Vectorized(points_3d, out_keypoints, out_results);
+    return;
+  }
+  project3VectorizedImpl<double>(points_3d, out_keypoints, out_results);
+}
+
+void PinholeCamera::project3VectorizedFloat(
+    const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d, Eigen::Matrix2Xf* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  const Distortion::Type distortion_type = getDistortion().getType();
+  if (distortion_type != Distortion::Type::kNoDistortion &&
+      distortion_type != Distortion::Type::kRadTan &&
+      distortion_type != Distortion::Type::kEquidistant) {
+    Camera::project3VectorizedFloat(points_3d, out_keypoints, out_results);
+    return;
+  }
+  project3VectorizedImpl<float>(points_3d, out_keypoints, out_results);
+}
+
+void PinholeCamera::project3VectorizedWithJacobians(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+    std::vector<ProjectionResult>* out_results) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+
+  const Distortion::Type distortion_type = getDistortion().getType();
+  if (distortion_type != Distortion::Type::kNoDistortion &&
+      distortion_type != Distortion::Type::kRadTan) {
+    Camera::project3VectorizedWithJacobians(
+        points_3d, out_keypoints, out_jacobians_point, out_jacobians_intrinsics,
+        out_jacobians_distortion, out_results);
+    return;
+  }
+  const bool is_radtan = distortion_type == Distortion::Type::kRadTan;
+  internal::RadTanCoefficients radtan_coefficients;
+  if (is_radtan) {
+    const Eigen::VectorXd& distortion_coefficients = getDistortion().getParameters();
+    radtan_coefficients.k1 = distortion_coefficients(0);
+    radtan_coefficients.k2 = distortion_coefficients(1);
+    radtan_coefficients.p1 = distortion_coefficients(2);
+    radtan_coefficients.p2 = distortion_coefficients(3);
+  }
+  const int num_distortion_params = is_radtan ? 4 : 0;
+
+  const int num_points = static_cast<int>(points_3d.cols());
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  out_results->resize(num_points, ProjectionResult::Status::UNINITIALIZED);
+  if (out_jacobians_point) {
+    out_jacobians_point->resize(Eigen::NoChange, 3 * num_points);
+  }
+  if (out_jacobians_intrinsics) {
+    out_jacobians_intrinsics->resize(Eigen::NoChange, kNumOfParams * num_points);
+  }
+  if (out_jacobians_distortion) {
+    out_jacobians_distortion->resize(Eigen::NoChange, num_distortion_params * num_points);
+  }
+
+  const double fu = this->fu();
+  const double fv = this->fv();
+  const double cu = this->cu();
+  const double cv = this->cv();
+  Eigen::Vector2d keypoint;
+  Eigen::Matrix2d J_distortion;
+  Eigen::Matrix<double, 2, 4> J_distortion_params;
+  for (int i = 0; i < num_points; ++i) {
+    const double x = points_3d(0, i);
+    const double y = points_3d(1, i);
+    const double z = points_3d(2, i);
+    const double rz = 1.0 / z;
+    keypoint << x * rz, y * rz;
+
+    J_distortion.setIdentity();
+    if (is_radtan) {
+      internal::distortRadTan(
+          radtan_coefficients, &keypoint, out_jacobians_point ? &J_distortion : nullptr,
+          out_jacobians_distortion ? &J_distortion_params : nullptr);
+    }
+
+    if (out_jacobians_point) {
+      const double rz2 = rz * rz;
+      out_jacobians_point->middleCols<3>(3 * i) <<
+          fu * J_distortion(0, 0) * rz, fu * J_distortion(0, 1) * rz,
+          -fu * (x * J_distortion(0, 0) + y * J_distortion(0, 1)) * rz2,
+          fv * J_distortion(1, 0) * rz, fv * J_distortion(1, 1) * rz,
+          -fv * (x * J_distortion(1, 0) + y * J_distortion(1, 1)) * rz2;
+    }
+    if (out_jacobians_intrinsics) {
+      out_jacobians_intrinsics->middleCols<kNumOfParams>(kNumOfParams * i) <<
+          keypoint[0], 0.0, 1.0, 0.0,
+          0.0, keypoint[1], 0.0, 1.0;
+    }
+    if (out_jacobians_distortion && is_radtan) {
+      J_distortion_params.row(0) *= fu;
+      J_distortion_params.row(1) *= fv;
+      out_jacobians_distortion->middleCols<4>(4 * i) = J_distortion_params;
+    }
+
+    // Normalized image plane to camera plane.
+    keypoint[0] = fu * keypoint[0] + cu;
+    keypoint[1] = fv * keypoint[1] + cv;
+    out_keypoints->col(i) = keypoint;
+
+    (*out_results)[i] = evaluateProjectionResult(keypoint, points_3d.col(i));
+    if ((*out_results)[i].getDetailedStatus() == ProjectionResult::Status::PROJECTION_INVALID) {
+      if (out_jacobians_point) {
+        out_jacobians_point->middleCols<3>(3 * i).setZero();
+      }
+      if (out_jacobians_intrinsics) {
+        out_jacobians_intrinsics->middleCols<kNumOfParams>(kNumOfParams * i).setZero();
+      }
+      if (out_jacobians_distortion) {
+        out_jacobians_distortion->middleCols(
+            num_distortion_params * i, num_distortion_params).setZero();
+      }
+    }
+  }
+}
+
 Eigen::Vector2d PinholeCamera::createRandomKeypoint() const {
   Eigen::Vector2d out;
   out.setRandom();
@@ -244,6 +542,7 @@ void PinholeCamera::setRandomImpl() {
   image_width_ = test_camera->image_width_;
   image_height_ = test_camera->image_height_;
   mask_= test_camera->mask_;
+  updatePackedMask();
   intrinsics_ = test_camera->intrinsics_;
   camera_type_ = test_camera->camera_type_;
   if (test_camera->distortion_) {
@@ -1,9 +1,14 @@
+#include <algorithm>
+#include <cmath>
 #include <memory>
 
 #include <aslam/cameras/camera-unified-projection.h>
 
 #include <aslam/cameras/camera-factory.h>
 #include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/internal/block-array.h>
+#include <aslam/cameras/internal/radtan-kernel.h>
 #include <aslam/common/types.h>
 
 #include "aslam/cameras/random-camera-generator.h"
@@ -197,23 +202,269 @@ const ProjectionResult UnifiedProjectionCamera::project3Functional(
   return evaluateProjectionResult(*out_keypoint, point_3d);
 }
 
-inline const ProjectionResult UnifiedProjectionCamera::evaluateProjectionResult(
-    const Eigen::Ref<const Eigen::Vector2d>& keypoint,
-    const Eigen::Vector3d& point_3d) const {
+void UnifiedProjectionCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d, Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  using internal::BlockArray;
+  using internal::kProjectionBlockSize;
+
+  const Distortion::Type distortion_type = getDistortion().getType();
+  if (distortion_type != Distortion::Type::kNoDistortion &&
+      distortion_type != Distortion::Type::kFisheye) {
+    Camera::project3Vectorized(points_3d, out_keypoints, out_results);
+    return;
+  }
+  // Same arithmetic as FisheyeDistortion::distortUsingExternalCoefficients, which is the
+  // identity in the limit w -> 0.
+  const double w = distortion_type == Distortion::Type::kFisheye
+                       ? getDistortion().getParameters()(0)
+                       : 0.0;
+  const bool apply_fisheye = w * w >= 1e-5;
+  const double mul2tanwby2 = 2.0 * std::tan(w / 2.0);
+
+  const int num_points = static_cast<int>(points_3d.cols());
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  out_results->resize(num_points, ProjectionResult::Status::UNINITIALIZED);
+
+  const double xi = this->xi();
+  const double fov_parameter = this->fov_parameter(xi);
+  const double min_depth2 = kMinimumDepth * kMinimumDepth;
+  BlockArray x, y, z, d2, d, u, v;
+  for (int block_start = 0; block_start < num_points; block_start += kProjectionBlockSize) {
+    const int block_size = std::min(kProjectionBlockSize, num_points - block_start);
+
+    // Transpose the block to structure of arrays and project onto the normalized image plane.
+    x = points_3d.row(0).segment(block_start, block_size).transpose();
+    y = points_3d.row(1).segment(block_start, block_size).transpose();
+    z = points_3d.row(2).segment(block_start, block_size).transpose();
+    d2 = x.square() + y.square() + z.square();
+    d = d2.sqrt();
+    const BlockArray rz = (z + xi * d).inverse();
+    u = x * rz;
+    v = y * rz;
+
+    if (apply_fisheye) {
+      const BlockArray r_u = (u.square() + v.square()).sqrt();
+      const BlockArray r_rd = (r_u.square() < 1e-5)
+                                  .select(mul2tanwby2 / w, (mul2tanwby2 * r_u).atan() / (r_u * w));
+      u *= r_rd;
+      v *= r_rd;
+    }
 
-  const bool visibility = isKeypointVisible(keypoint);
+    // Normalized image plane to camera plane.
+    u = fu() * u + cu();
+    v = fv() * v + cv();
+    out_keypoints->row(0).segment(block_start, block_size) = u.matrix().transpose();
+    out_keypoints->row(1).segment(block_start, block_size) = v.matrix().transpose();
+
+    // Same decision as project3Functional and evaluateProjectionResult.
+    for (int i = 0; i < block_size; ++i) {
+      ProjectionResult::Status status;
+      if (!(z(i) > -(fov_parameter * d(i)))) {
+        out_keypoints->col(block_start + i).setZero();
+        status = ProjectionResult::Status::PROJECTION_INVALID;
+      } else if (d2(i) > min_depth2) {
+        const bool is_visible = u(i) >= 0.0 && v(i) >= 0.0 &&
+                                u(i) < static_cast<double>(imageWidth()) &&
+                                v(i) < static_cast<double>(imageHeight());
+        status = is_visible ? ProjectionResult::Status::KEYPOINT_VISIBLE
+                            : ProjectionResult::Status::KEYPOINT_OUTSIDE_IMAGE_BOX;
+      } else {
+        status = ProjectionResult::Status::PROJECTION_INVALID;
+      }
+      (*out_results)[block_start + i] = ProjectionResult(status);
+    }
+  }
+}
 
-  const double d2 = point_3d.squaredNorm();
-  const double minDepth2 = kMinimumDepth*kMinimumDepth;
+void UnifiedProjectionCamera::project3VectorizedWithJacobians(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+    std::vector<ProjectionResult>* out_results) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+
+  const Distortion::Type distortion_type = getDistortion().getType();
+  if (distortion_type != Distortion::Type::kNoDistortion &&
+      distortion_type != Distortion::Type::kRadTan) {
+    Camera::project3VectorizedWithJacobians(
+        points_3d, out_keypoints, out_jacobians_point, out_jacobians_intrinsics,
+        out_jacobians_distortion, out_results);
+    return;
+  }
+  const bool is_radtan = distortion_type == Distortion::Type::kRadTan;
+  internal::RadTanCoefficients radtan_coefficients;
+  if (is_radtan) {
+    const Eigen::VectorXd& distortion_coefficients = getDistortion().getParameters();
+    radtan_coefficients.k1 = distortion_coefficients(0);
+    radtan_coefficients.k2 = distortion_coefficients(1);
+    radtan_coefficients.p1 = distortion_coefficients(2);
+    radtan_coefficients.p2 = distortion_coefficients(3);
+  }
+  const int num_distortion_params = is_radtan ? 4 : 0;
 
-  if (visibility && (d2 > minDepth2))
-    return ProjectionResult(ProjectionResult::Status::KEYPOINT_VISIBLE);
-  else if (!visibility && (d2 > minDepth2))
-    return ProjectionResult(ProjectionResult::Status::KEYPOINT_OUTSIDE_IMAGE_BOX);
-  else if (d2 <= minDepth2)
-    return ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+  const int num_points = static_cast<int>(points_3d.cols());
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  out_results->resize(num_points, ProjectionResult::Status::UNINITIALIZED);
+  if (out_jacobians_point) {
+    out_jacobians_point->resize(Eigen::NoChange, 3 * num_points);
+  }
+  if (out_jacobians_intrinsics) {
+    out_jacobians_intrinsics->resize(Eigen::NoChange, kNumOfParams * num_points);
+  }
+  if (out_jacobians_distortion) {
+    out_jacobians_distortion->resize(Eigen::NoChange, num_distortion_params * num_points);
+  }
 
-  return ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+  const double xi = this->xi();
+  const double fu = this->fu();
+  const double fv = this->fv();
+  const double cu = this->cu();
+  const double cv = this->cv();
+  const double fov_parameter = this->fov_parameter(xi);
+  const bool need_distortion_jacobian = out_jacobians_point || out_jacobians_intrinsics;
+  const auto set_jacobians_zero = [&](int i) {
+    if (out_jacobians_point) {
+      out_jacobians_point->middleCols<3>(3 * i).setZero();
+    }
+    if (out_jacobians_intrinsics) {
+      out_jacobians_intrinsics->middleCols<kNumOfParams>(kNumOfParams * i).setZero();
+    }
+    if (out_jacobians_distortion) {
+      out_jacobians_distortion->middleCols(
+          num_distortion_params * i, num_distortion_params).setZero();
+    }
+  };
+
+  Eigen::Vector2d keypoint;
+  Eigen::Matrix2d J_distortion;
+  Eigen::Matrix<double, 2, 4> J_distortion_params;
+  Eigen::Matrix<double, 2, 3> J_projection;
+  Eigen::Matrix<double, 2, kNumOfParams> J_intrinsics;
+  for (int i = 0; i < num_points; ++i) {
+    const double x = points_3d(0, i);
+    const double y = points_3d(1, i);
+    const double z = points_3d(2, i);
+    const double d = points_3d.col(i).norm();
+
+    // Same check and outputs as project3Functional for invalid projections.
+    if (!(z > -(fov_parameter * d))) {
+      out_keypoints->col(i).setZero();
+      set_jacobians_zero(i);
+      (*out_results)[i] = ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+      continue;
+    }
+
+    const double rz = 1.0 / (z + xi * d);
+    keypoint << x * rz, y * rz;
+
+    J_distortion.setIdentity();
+    if (is_radtan) {
+      internal::distortRadTan(
+          radtan_coefficients, &keypoint, need_distortion_jacobian ? &J_distortion : nullptr,
+          out_jacobians_distortion ? &J_distortion_params : nullptr);
+    }
+    // Scale the distortion Jacobian to the camera plane.
+    J_distortion.row(0) *= fu;
+    J_distortion.row(1) *= fv;
+
+    if (out_jacobians_point) {
+      const double rz2 = rz * rz / d;
+      const double J_xy = -rz2 * xi * x * y;
+      const double J_z = rz2 * (-xi * z - d);
+      J_projection << rz2 * (d * z + xi * (y * y + z * z)), J_xy, x * J_z,
+                      J_xy, rz2 * (d * z + xi * (x * x + z * z)), y * J_z;
+      out_jacobians_point->middleCols<3>(3 * i).noalias() = J_distortion * J_projection;
+    }
+    if (out_jacobians_intrinsics) {
+      const Eigen::Vector2d J_xi(-x * rz * d * rz, -y * rz * d * rz);
+      J_intrinsics.setZero();
+      J_intrinsics.col(0) = J_distortion * J_xi;
+      J_intrinsics(0, 1) = keypoint[0];
+      J_intrinsics(0, 3) = 1.0;
+      J_intrinsics(1, 2) = keypoint[1];
+      J_intrinsics(1, 4) = 1.0;
+      out_jacobians_intrinsics->middleCols<kNumOfParams>(kNumOfParams * i) = J_intrinsics;
+    }
+    if (out_jacobians_distortion && is_radtan) {
+      J_distortion_params.row(0) *= fu;
+      J_distortion_params.row(1) *= fv;
+      out_jacobians_distortion->middleCols<4>(4 * i) = J_distortion_params;
+    }
+
+    // Normalized image plane to camera plane.
+    keypoint[0] = fu * keypoint[0] + cu;
+    keypoint[1] = fv * keypoint[1] + cv;
+    out_keypoints->col(i) = keypoint;
+    (*out_results)[i] = evaluateProjectionResult(keypoint, points_3d.col(i));
+    if ((*out_results)[i].getDetailedStatus() == ProjectionResult::Status::PROJECTION_INVALID) {
+      set_jacobians_zero(i);
+    }
+  }
+}
+
+void UnifiedProjectionCamera::backProject3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints, Eigen::Matrix3Xd* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+  using internal::BlockArray;
+  using internal::kProjectionBlockSize;
+
+  const Distortion::Type distortion_type = getDistortion().getType();
+  if (distortion_type != Distortion::Type::kNoDistortion &&
+      distortion_type != Distortion::Type::kFisheye) {
+    Camera::backProject3Vectorized(keypoints, out_points_3d, out_success);
+    return;
+  }
+  // Same arithmetic as FisheyeDistortion::undistortUsingExternalCoefficients, which leaves
+  // the points unchanged for w == 0, on the optical axis and beyond the max valid angle.
+  const double w = distortion_type == Distortion::Type::kFisheye
+                       ? getDistortion().getParameters()(0)
+                       : 0.0;
+  const double mul2tanwby2 = std::tan(w / 2.0) * 2.0;
+  const bool apply_fisheye = mul2tanwby2 != 0.0;
+  const double max_valid_angle = FisheyeDistortion::getMaxValidAngle();
+
+  const int num_points = static_cast<int>(keypoints.cols());
+  out_points_3d->resize(Eigen::NoChange, num_points);
+  out_success->resize(num_points, false);
+
+  const double xi = this->xi();
+  BlockArray u, v;
+  for (int block_start = 0; block_start < num_points; block_start += kProjectionBlockSize) {
+    const int block_size = std::min(kProjectionBlockSize, num_points - block_start);
+
+    // Camera plane to normalized image plane.
+    u = (keypoints.row(0).segment(block_start, block_size).transpose().array() - cu()) / fu();
+    v = (keypoints.row(1).segment(block_start, block_size).transpose().array() - cv()) / fv();
+
+    if (apply_fisheye) {
+      const BlockArray r_d = (u.square() + v.square()).sqrt();
+      const BlockArray angle = r_d * w;
+      const BlockArray r_u = (r_d == 0.0 || angle.abs() > max_valid_angle)
+                                 .select(1.0, angle.tan() / (r_d * mul2tanwby2));
+      u *= r_u;
+      v *= r_u;
+    }
+
+    // Lift onto the unit sphere.
+    const BlockArray rho2_d = u.square() + v.square();
+    const BlockArray tmpD = (1.0 + (1.0 - xi * xi) * rho2_d).max(0.0);
+    out_points_3d->row(0).segment(block_start, block_size) = u.matrix().transpose();
+    out_points_3d->row(1).segment(block_start, block_size) = v.matrix().transpose();
+    out_points_3d->row(2).segment(block_start, block_size) =
+        (1.0 - xi * (rho2_d + 1.0) / (xi + tmpD.sqrt())).matrix().transpose();
+
+    for (int i = 0; i < block_size; ++i) {
+      (*out_success)[block_start + i] = isUndistortedKeypointValid(rho2_d(i), xi);
+    }
+  }
 }
 
 inline bool UnifiedProjectionCamera::isUndistortedKeypointValid(const double& rho2_d,
@@ -330,6 +581,7 @@ void UnifiedProjectionCamera::setRandomImpl() {
   image_width_ = test_camera->image_width_;
   image_height_ = test_camera->image_height_;
   mask_= test_camera->mask_;
+  updatePackedMask();
   intrinsics_ = test_camera->intrinsics_;
   camera_type_ = test_camera->camera_type_;
   if (test_camera->distortion_) {
@@ -1,7 +1,11 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <memory>
 
 #include <glog/logging.h>
 
+#include <aslam/cameras/bearing-lookup-table.h>
 #include <aslam/cameras/camera.h>
 #include <aslam/cameras/distortion-equidistant.h>
 #include <aslam/cameras/distortion-fisheye.h>
@@ -13,6 +17,16 @@
 //#include <sm/PropertyTree.hpp>
 namespace aslam {
 
+namespace {
+// Number of grid steps per image side of the pixels that bound the field of view.
+constexpr int kNumBoundingSampleSteps = 16;
+
+// Angle between two unit vectors, robust to rounding of the dot product.
+double angleBetween(const Eigen::Vector3d& a, const Eigen::Vector3d& b) {
+  return std::acos(std::max(-1.0, std::min(1.0, a.dot(b))));
+}
+}  // namespace
+
 std::ostream& operator<<(std::ostream& out, const ProjectionResult& state) {
   std::string enum_str;
   typedef ProjectionResult::Status Status;
@@ -45,10 +59,13 @@ Camera::Camera(
     : line_delay_nanoseconds_(0),
       image_width_(image_width),
       image_height_(image_height),
+      use_packed_mask_(false),
+      packed_mask_words_per_row_(0u),
       is_compressed_(false),
       intrinsics_(intrinsics),
       camera_type_(camera_type),
-      distortion_(std::move(distortion)) {
+      distortion_(std::move(distortion)),
+      use_bearing_lookup_table_(false) {
   CHECK_NOTNULL(distortion_.get());
 }
 
@@ -59,10 +76,13 @@ Camera::Camera(
     : line_delay_nanoseconds_(0),
       image_width_(image_width),
       image_height_(image_height),
+      use_packed_mask_(false),
+      packed_mask_words_per_row_(0u),
       is_compressed_(false),
       intrinsics_(intrinsics),
       camera_type_(camera_type),
-      distortion_(new NullDistortion()) {}
+      distortion_(new NullDistortion()),
+      use_bearing_lookup_table_(false) {}
 
 void Camera::printParameters(std::ostream& out, const std::string& text) const {
   if (text.size() > 0) {
@@ -395,6 +415,127 @@ bool Camera::isProjectable4(const Eigen::Ref<const Eigen::Vector4d>& ph) const {
   return ret.isKeypointVisible();
 }
 
+bool Camera::sampleImageRays(int num_steps, Eigen::Matrix3Xd* out_rays) const {
+  CHECK_GT(num_steps, 0);
+  CHECK_NOTNULL(out_rays);
+  const double max_u = static_cast<double>(image_width_);
+  const double max_v = static_cast<double>(image_height_);
+  out_rays->resize(Eigen::NoChange, (num_steps + 1) * (num_steps + 1));
+  Eigen::Vector3d ray;
+  for (int row = 0; row <= num_steps; ++row) {
+    for (int col = 0; col <= num_steps; ++col) {
+      const Eigen::Vector2d keypoint(max_u * col / num_steps, max_v * row / num_steps);
+      if (!backProject3(keypoint, &ray)) {
+        return false;
+      }
+      out_rays->col(row * (num_steps + 1) + col) = ray.normalized();
+    }
+  }
+  return true;
+}
+
+void Camera::getBoundingCone(Eigen::Vector3d* out_axis, double* out_cos_half_angle) const {
+  CHECK_NOTNULL(out_axis);
+  CHECK_NOTNULL(out_cos_half_angle);
+  std::lock_guard<std::mutex> lock(bounding_cone_mutex_);
+  if (!bounding_cone_ || !isBoundingConeValid(*bounding_cone_)) {
+    std::unique_ptr<BoundingCone> cone(new BoundingCone);
+    cone->intrinsics = intrinsics_;
+    cone->distortion_type = getDistortion().getType();
+    cone->distortion_parameters = getDistortion().getParameters();
+    cone->image_width = image_width_;
+    cone->image_height = image_height_;
+    computeBoundingCone(&cone->axis, &cone->cos_half_angle);
+    bounding_cone_ = std::move(cone);
+  }
+  *out_axis = bounding_cone_->axis;
+  *out_cos_half_angle = bounding_cone_->cos_half_angle;
+}
+
+bool Camera::isBoundingConeValid(const BoundingCone& cone) const {
+  const Distortion& distortion = getDistortion();
+  return cone.image_width == image_width_ && cone.image_height == image_height_ &&
+         cone.distortion_type == distortion.getType() &&
+         cone.intrinsics.size() == intrinsics_.size() && cone.intrinsics == intrinsics_ &&
+         cone.distortion_parameters.size() == distortion.getParameters().size() &&
+         cone.distortion_parameters == distortion.getParameters();
+}
+
+void Camera::computeBoundingCone(Eigen::Vector3d* out_axis, double* out_cos_half_angle) const {
+  CHECK_NOTNULL(out_axis);
+  CHECK_NOTNULL(out_cos_half_angle);
+  *out_axis = Eigen::Vector3d::UnitZ();
+  *out_cos_half_angle = -1.0;
+
+  Eigen::Matrix3Xd rays;
+  if (!sampleImageRays(kNumBoundingSampleSteps, &rays)) {
+    return;
+  }
+  const Eigen::Vector3d axis = rays.rowwise().sum();
+  if (axis.norm() < 1e-6 * rays.cols()) {
+    return;
+  }
+  const Eigen::Vector3d unit_axis = axis.normalized();
+  const int num_cols = kNumBoundingSampleSteps + 1;
+  double max_angle = 0.0;
+  double max_sample_angle = 0.0;
+  for (int row = 0; row < num_cols; ++row) {
+    for (int col = 0; col < num_cols; ++col) {
+      const int i = row * num_cols + col;
+      max_angle = std::max(max_angle, angleBetween(unit_axis, rays.col(i)));
+      if (col + 1 < num_cols) {
+        max_sample_angle = std::max(max_sample_angle, angleBetween(rays.col(i), rays.col(i + 1)));
+      }
+      if (row + 1 < num_cols) {
+        max_sample_angle =
+            std::max(max_sample_angle, angleBetween(rays.col(i), rays.col(i + num_cols)));
+      }
+    }
+  }
+  const double half_angle = max_angle + max_sample_angle;
+  if (half_angle < M_PI) {
+    *out_axis = unit_axis;
+    *out_cos_half_angle = std::cos(half_angle);
+  }
+}
+
+bool Camera::getBoundingFrustum(Eigen::Matrix<double, 4, 3>* out_plane_normals) const {
+  CHECK_NOTNULL(out_plane_normals);
+  Eigen::Matrix3Xd rays;
+  if (!sampleImageRays(kNumBoundingSampleSteps, &rays)) {
+    return false;
+  }
+  const int num_rays = static_cast<int>(rays.cols());
+  Eigen::Matrix2Xd normalized_points(2, num_rays);
+  for (int i = 0; i < num_rays; ++i) {
+    if (!(rays(2, i) > 0.0)) {
+      return false;
+    }
+    normalized_points.col(i) = rays.col(i).head<2>() / rays(2, i);
+  }
+  const int num_cols = kNumBoundingSampleSteps + 1;
+  double margin = 0.0;
+  for (int row = 0; row < num_cols; ++row) {
+    for (int col = 0; col < num_cols; ++col) {
+      const int i = row * num_cols + col;
+      if (col + 1 < num_cols) {
+        margin = std::max(margin, (normalized_points.col(i + 1) - normalized_points.col(i)).norm());
+      }
+      if (row + 1 < num_cols) {
+        margin = std::max(
+            margin, (normalized_points.col(i + num_cols) - normalized_points.col(i)).norm());
+      }
+    }
+  }
+  const Eigen::Vector2d min_point = normalized_points.rowwise().minCoeff().array() - margin;
+  const Eigen::Vector2d max_point = normalized_points.rowwise().maxCoeff().array() + margin;
+  *out_plane_normals << 1.0, 0.0, -min_point[0],
+                        -1.0, 0.0, max_point[0],
+                        0.0, 1.0, -min_point[1],
+                        0.0, -1.0, max_point[1];
+  return true;
+}
+
 void Camera::project3Vectorized(
     const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
     Eigen::Matrix2Xd* out_keypoints,
@@ -411,6 +552,61 @@ void Camera::project3Vectorized(
   }
 }
 
+void Camera::project3VectorizedWithJacobians(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+    std::vector<ProjectionResult>* out_results) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  const int num_points = static_cast<int>(points_3d.cols());
+  const int num_intrinsics = getParameterSize();
+  const int num_distortion_params = getDistortion().getParameterSize();
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  out_results->resize(num_points, ProjectionResult::Status::UNINITIALIZED);
+  if (out_jacobians_point) {
+    out_jacobians_point->resize(Eigen::NoChange, 3 * num_points);
+  }
+  if (out_jacobians_intrinsics) {
+    out_jacobians_intrinsics->resize(Eigen::NoChange, num_intrinsics * num_points);
+  }
+  if (out_jacobians_distortion) {
+    out_jacobians_distortion->resize(Eigen::NoChange, num_distortion_params * num_points);
+  }
+
+  Eigen::Vector2d keypoint;
+  Eigen::Matrix<double, 2, 3> jacobian_point;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> jacobian_intrinsics;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> jacobian_distortion;
+  for (int i = 0; i < num_points; ++i) {
+    (*out_results)[i] = project3Functional(
+        points_3d.col(i), nullptr, nullptr, &keypoint,
+        out_jacobians_point ? &jacobian_point : nullptr,
+        out_jacobians_intrinsics ? &jacobian_intrinsics : nullptr,
+        out_jacobians_distortion ? &jacobian_distortion : nullptr);
+    out_keypoints->col(i) = keypoint;
+    if ((*out_results)[i].getDetailedStatus() ==
+        ProjectionResult::Status::PROJECTION_INVALID) {
+      jacobian_point.setZero();
+      jacobian_intrinsics.setZero(2, num_intrinsics);
+      jacobian_distortion.setZero(2, num_distortion_params);
+    }
+    if (out_jacobians_point) {
+      out_jacobians_point->middleCols<3>(3 * i) = jacobian_point;
+    }
+    if (out_jacobians_intrinsics) {
+      out_jacobians_intrinsics->middleCols(num_intrinsics * i, num_intrinsics) =
+          jacobian_intrinsics;
+    }
+    if (out_jacobians_distortion) {
+      out_jacobians_distortion->middleCols(
+          num_distortion_params * i, num_distortion_params) = jacobian_distortion;
+    }
+  }
+}
+
 void Camera::backProject3Vectorized(
     const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
     Eigen::Matrix3Xd* out_points_3d,
@@ -426,15 +622,188 @@ void Camera::backProject3Vectorized(
   }
 }
 
+void Camera::project3VectorizedFloat(
+    const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+    Eigen::Matrix2Xf* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  CHECK_NOTNULL(out_keypoints);
+  Eigen::Matrix2Xd keypoints;
+  project3Vectorized(points_3d.cast<double>(), &keypoints, out_results);
+  *out_keypoints = keypoints.cast<float>();
+}
+
+void Camera::backProject3VectorizedFloat(
+    const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+    Eigen::Matrix3Xf* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  Eigen::Matrix3Xd points_3d;
+  backProject3Vectorized(keypoints.cast<double>(), &points_3d, out_success);
+  *out_points_3d = points_3d.cast<float>();
+}
+
+void Camera::project3RollingShutterVectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d, const RollingShutterMotion& motion,
+    Eigen::Matrix2Xd* out_keypoints, std::vector<ProjectionResult>* out_results,
+    RollingShutterProjectionReport* out_report, int max_iterations,
+    double tolerance_lines) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  CHECK_GT(max_iterations, 0);
+  CHECK_GT(tolerance_lines, 0.0);
+  const int num_points = static_cast<int>(points_3d.cols());
+  RollingShutterProjectionReport report;
+
+  // First iteration: all points at the time of the first line.
+  project3Vectorized(points_3d, out_keypoints, out_results);
+  report.num_iterations = 1;
+  auto has_failed = [](const ProjectionResult& result) {
+    return result.getDetailedStatus() == ProjectionResult::Status::POINT_BEHIND_CAMERA ||
+           result.getDetailedStatus() == ProjectionResult::Status::PROJECTION_INVALID;
+  };
+  const bool is_global_shutter = line_delay_nanoseconds_ == 0u || getNumberOfLines() <= 1u;
+  const int line_axis = (getLineDelayMode() == LineDelayMode::kRows) ? 1 : 0;
+  std::vector<int> active_indices;
+  active_indices.reserve(num_points);
+  Eigen::VectorXd lines(num_points);
+  for (int i = 0; i < num_points; ++i) {
+    if (has_failed((*out_results)[i])) {
+      ++report.num_failed;
+    } else if (is_global_shutter) {
+      ++report.num_converged;
+    } else {
+      active_indices.push_back(i);
+      lines[i] = (*out_keypoints)(line_axis, i);
+    }
+  }
+
+  const double line_delay_seconds = static_cast<double>(line_delay_nanoseconds_) * 1e-9;
+  const double angular_speed = motion.angular_velocity.norm();
+  const Eigen::Vector3d rotation_axis =
+      (angular_speed > 0.0) ? Eigen::Vector3d(motion.angular_velocity / angular_speed)
+                            : Eigen::Vector3d::UnitZ();
+  Eigen::Matrix3Xd moved_points;
+  Eigen::Matrix2Xd keypoints;
+  std::vector<ProjectionResult> results;
+  std::vector<double> line_changes;
+  while (!active_indices.empty() && report.num_iterations < max_iterations) {
+    ++report.num_iterations;
+    // Transform the points into the camera frame at the capture time of their line.
+    const int num_active = static_cast<int>(active_indices.size());
+    moved_points.resize(Eigen::NoChange, num_active);
+    for (int k = 0; k < num_active; ++k) {
+      const int i = active_indices[k];
+      const double time_seconds = lines[i] * line_delay_seconds;
+      const Eigen::Matrix3d R_C0_Ct =
+          Eigen::AngleAxisd(time_seconds * angular_speed, rotation_axis).toRotationMatrix();
+      moved_points.col(k) =
+          R_C0_Ct.transpose() * (points_3d.col(i) - time_seconds * motion.linear_velocity);
+    }
+    project3Vectorized(moved_points, &keypoints, &results);
+
+    // Keep iterating the points whose line still moves.
+    line_changes.clear();
+    int num_still_active = 0;
+    for (int k = 0; k < num_active; ++k) {
+      const int i = active_indices[k];
+      out_keypoints->col(i) = keypoints.col(k);
+      (*out_results)[i] = results[k];
+      if (has_failed(results[k])) {
+        ++report.num_failed;
+        continue;
+      }
+      const double line_change = std::abs(keypoints(line_axis, k) - lines[i]);
+      lines[i] = keypoints(line_axis, k);
+      if (line_change < tolerance_lines) {
+        ++report.num_converged;
+        continue;
+      }
+      active_indices[num_still_active++] = i;
+      line_changes.push_back(line_change);
+    }
+    active_indices.resize(num_still_active);
+  }
+
+  report.num_not_converged = static_cast<int>(active_indices.size());
+  if (report.num_not_converged > 0) {
+    report.max_line_change = (report.num_iterations > 1)
+        ? *std::max_element(line_changes.begin(), line_changes.end())
+        : std::numeric_limits<double>::infinity();
+  }
+  if (out_report != nullptr) {
+    *out_report = report;
+  }
+}
+
 void Camera::setMask(const cv::Mat& mask) {
   CHECK_EQ(image_height_, static_cast<size_t>(mask.rows));
   CHECK_EQ(image_width_, static_cast<size_t>(mask.cols));
   CHECK_EQ(mask.type(), CV_8UC1);
   mask_ = mask;
+  updatePackedMask();
 }
 
 void Camera::clearMask() {
   mask_ = cv::Mat();
+  updatePackedMask();
+}
+
+void Camera::setPackedMaskEnabled(bool enabled) {
+  use_packed_mask_ = enabled;
+  updatePackedMask();
+}
+
+void Camera::updatePackedMask() {
+  packed_mask_.clear();
+  packed_mask_words_per_row_ = 0u;
+  if (!use_packed_mask_ || mask_.empty()) {
+    return;
+  }
+  const int num_rows = mask_.rows;
+  const int num_cols = mask_.cols;
+  packed_mask_words_per_row_ = (static_cast<size_t>(num_cols) + 63u) / 64u;
+  packed_mask_.assign(num_rows * packed_mask_words_per_row_, 0u);
+  for (int row = 0; row < num_rows; ++row) {
+    const uint8_t* mask_row = mask_.ptr<uint8_t>(row);
+    uint64_t* packed_row = &packed_mask_[row * packed_mask_words_per_row_];
+    for (int col = 0; col < num_cols; ++col) {
+      if (mask_row[col] != 0u) {
+        packed_row[col >> 6] |= uint64_t{1} << (col & 63);
+      }
+    }
+  }
+}
+
+void Camera::areMasked(
+    const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+    std::vector<bool>* out_is_masked) const {
+  CHECK_NOTNULL(out_is_masked);
+  const int num_keypoints = static_cast<int>(keypoints.cols());
+  out_is_masked->assign(num_keypoints, true);
+  const double width = static_cast<double>(image_width_);
+  const double height = static_cast<double>(image_height_);
+  const bool has_mask = !mask_.empty();
+  const bool use_packed_mask = has_mask && !packed_mask_.empty();
+  for (int i = 0; i < num_keypoints; ++i) {
+    const double u = keypoints(0, i);
+    const double v = keypoints(1, i);
+    // Written such that NaN keypoints are masked.
+    if (!(u >= 0.0 && u < width && v >= 0.0 && v < height)) {
+      continue;
+    }
+    if (!has_mask) {
+      (*out_is_masked)[i] = false;
+      continue;
+    }
+    const int col = static_cast<int>(u);
+    const int row = static_cast<int>(v);
+    if (use_packed_mask) {
+      const uint64_t word = packed_mask_[row * packed_mask_words_per_row_ + (col >> 6)];
+      (*out_is_masked)[i] = ((word >> (col & 63)) & 1u) == 0u;
+    } else {
+      (*out_is_masked)[i] = mask_.at<uint8_t>(row, col) == 0u;
+    }
+  }
 }
 
 bool Camera::hasMask() const {
@@ -445,6 +814,53 @@ const cv::Mat& Camera::getMask() const {
   return mask_;
 }
 
+void Camera::setBearingLookupTableEnabled(bool enabled) {
+  use_bearing_lookup_table_ = enabled;
+  if (!enabled) {
+    invalidateBearingLookupTable();
+  }
+}
+
+void Camera::invalidateBearingLookupTable() {
+  std::lock_guard<std::mutex> lock(bearing_lookup_table_mutex_);
+  bearing_lookup_table_.reset();
+}
+
+void Camera::getNormalizedBearingVectors(
+    const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints, Eigen::Matrix3Xd* out_bearings,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_bearings);
+  CHECK_NOTNULL(out_success);
+  if (!use_bearing_lookup_table_) {
+    backProject3Vectorized(keypoints, out_bearings, out_success);
+    out_bearings->colwise().normalize();
+    return;
+  }
+
+  getBearingLookupTable()->getNormalizedBearingVectors(
+      *this, keypoints, out_bearings, out_success);
+}
+
+std::shared_ptr<const BearingLookupTable> Camera::getBearingLookupTable() const {
+  CHECK(use_bearing_lookup_table_) << "The bearing vector lookup table is not enabled.";
+  // Mutations through getParametersMutable or getDistortionMutable bypass the
+  // invalidation, so the table is checked against the calibration on every call.
+  std::lock_guard<std::mutex> lock(bearing_lookup_table_mutex_);
+  if (!bearing_lookup_table_ || !bearing_lookup_table_->isValidFor(*this)) {
+    bearing_lookup_table_.reset(new BearingLookupTable(*this));
+  }
+  return bearing_lookup_table_;
+}
+
+void Camera::setBearingLookupTable(const std::shared_ptr<const BearingLookupTable>& table) {
+  CHECK(table);
+  CHECK(table->isValidFor(*this)) << "The bearing vector lookup table was built for a "
+                                  << "different calibration.";
+  use_bearing_lookup_table_ = true;
+  std::lock_guard<std::mutex> lock(bearing_lookup_table_mutex_);
+  bearing_lookup_table_ = table;
+}
+
 ProjectionResult::Status ProjectionResult::KEYPOINT_VISIBLE =
     ProjectionResult::Status::KEYPOINT_VISIBLE;
 ProjectionResult::Status ProjectionResult::KEYPOINT_OUTSIDE_IMAGE_BOX =
@@ -1,6 +1,62 @@
 #include <aslam/cameras/distortion-equidistant.h>
 
+#include <cmath>
+
 namespace aslam {
+namespace {
+// Solves distort(x) = point for x and overwrites the point with it. The distortion only
+// scales the radius, so it suffices to invert thetad(theta) with a scalar Newton iteration.
+template <typename Scalar>
+void undistortEquidistant(Scalar k1, Scalar k2, Scalar k3, Scalar k4, Scalar tolerance,
+                          Eigen::Matrix<Scalar, 2, 1>* point) {
+  const int n = 30;  // Max. number of iterations
+
+  // Handle special case around image center.
+  const Scalar rd2 = point->squaredNorm();
+  if (rd2 < Scalar(1e-6))
+    return; // Point remains unchanged.
+
+  const Scalar rd = std::sqrt(rd2);
+  Scalar theta = rd;
+  bool converged = false;
+  for (int i = 0; i < n; ++i) {
+    const Scalar theta2 = theta * theta;
+    const Scalar theta4 = theta2 * theta2;
+    const Scalar theta6 = theta2 * theta4;
+    const Scalar theta8 = theta4 * theta4;
+    const Scalar e = rd - theta * (1 + k1 * theta2 + k2 * theta4 + k3 * theta6 + k4 * theta8);
+    const Scalar dthetad_dtheta =
+        1 + 3 * k1 * theta2 + 5 * k2 * theta4 + 7 * k3 * theta6 + 9 * k4 * theta8;
+    if (std::abs(dthetad_dtheta) < Scalar(1e-12)) {
+      break;
+    }
+    theta += e / dthetad_dtheta;
+    if (e * e <= tolerance) {
+      converged = true;
+      break;
+    }
+  }
+  LOG_IF(WARNING, !converged) << "Did not converge with max. iterations.";
+  *point *= std::tan(theta) / rd;
+}
+
+template <typename Scalar>
+void undistortEquidistantVectorized(const Eigen::VectorXd& dist_coeffs,
+                                    Eigen::Matrix<Scalar, 2, Eigen::Dynamic>* points) {
+  const Scalar k1 = static_cast<Scalar>(dist_coeffs(0));
+  const Scalar k2 = static_cast<Scalar>(dist_coeffs(1));
+  const Scalar k3 = static_cast<Scalar>(dist_coeffs(2));
+  const Scalar k4 = static_cast<Scalar>(dist_coeffs(3));
+  const Scalar tolerance = static_cast<Scalar>(FLAGS_acv_inv_distortion_tolerance);
+  Eigen::Matrix<Scalar, 2, 1> point;
+  for (int i = 0; i < points->cols(); ++i) {
+    point = points->col(i);
+    undistortEquidistant(k1, k2, k3, k4, tolerance, &point);
+    points->col(i) = point;
+  }
+}
+}  // namespace
+
 std::ostream& operator<<(std::ostream& out, const EquidistantDistortion& distortion) {
   distortion.printParameters(out, std::string(""));
   return out;
@@ -145,31 +201,22 @@ void EquidistantDistortion::undistortUsingExternalCoefficients(const Eigen::Vect
                                                                Eigen::Vector2d* point) const {
   CHECK_EQ(dist_coeffs.size(), kNumOfParams) << "dist_coeffs: invalid size!";
   CHECK_NOTNULL(point);
+  undistortEquidistant<double>(dist_coeffs(0), dist_coeffs(1), dist_coeffs(2), dist_coeffs(3),
+                               FLAGS_acv_inv_distortion_tolerance, point);
+}
 
-  const int n = 30;  // Max. number of iterations
-
-  Eigen::Vector2d& y = *point;
-  Eigen::Vector2d ybar = y;
-  Eigen::Matrix2d F;
-  Eigen::Vector2d y_tmp;
-
-  // Handle special case around image center.
-  if (y.squaredNorm() < 1e-6)
-    return; // Point remains unchanged.
-
-  int i;
-  for (i = 0; i < n; ++i) {
-    y_tmp = ybar;
-    distortUsingExternalCoefficients(&dist_coeffs, &y_tmp, &F);
-    Eigen::Vector2d e(y - y_tmp);
-    Eigen::Vector2d du = (F.transpose() * F).inverse() * F.transpose() * e;
-    ybar += du;
-    if (e.dot(e) <= FLAGS_acv_inv_distortion_tolerance)
-      break;
-  }
-  LOG_IF(WARNING, i >= n) << "Did not converge with max. iterations.";
+void EquidistantDistortion::undistortUsingExternalCoefficientsVectorized(
+    const Eigen::VectorXd& dist_coeffs, Eigen::Matrix2Xd* points) const {
+  CHECK_EQ(dist_coeffs.size(), kNumOfParams) << "dist_coeffs: invalid size!";
+  CHECK_NOTNULL(points);
+  undistortEquidistantVectorized<double>(dist_coeffs, points);
+}
 
-  y = ybar;
+void EquidistantDistortion::undistortUsingExternalCoefficientsVectorized(
+    const Eigen::VectorXd& dist_coeffs, Eigen::Matrix2Xf* points) const {
+  CHECK_EQ(dist_coeffs.size(), kNumOfParams) << "dist_coeffs: invalid size!";
+  CHECK_NOTNULL(points);
+  undistortEquidistantVectorized<float>(dist_coeffs, points);
 }
 
 bool EquidistantDistortion::areParametersValid(const Eigen::VectorXd& parameters) {
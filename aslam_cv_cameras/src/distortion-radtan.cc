@@ -1,6 +1,76 @@
 #include <aslam/cameras/distortion-radtan.h>
 
+#include <cmath>
+
 namespace aslam {
+namespace {
+// Solves distort(x) = point for x and overwrites the point with it.
+template <typename Scalar>
+void undistortRadTan(Scalar k1, Scalar k2, Scalar p1, Scalar p2, Scalar tolerance,
+                     Eigen::Matrix<Scalar, 2, 1>* point) {
+  const int n = 30;  // Max. number of iterations
+
+  const Scalar y0 = (*point)(0);
+  const Scalar y1 = (*point)(1);
+
+  // Invert the dominant radial term at the distorted radius as initial guess.
+  const Scalar rho2_d = y0 * y0 + y1 * y1;
+  const Scalar rad_d = 1 + k1 * rho2_d + k2 * rho2_d * rho2_d;
+  const Scalar scale = rad_d > Scalar(0.5) ? 1 / rad_d : Scalar(1);
+  Scalar x = y0 * scale;
+  Scalar y = y1 * scale;
+
+  // Gauss-Newton on the residual; the Jacobian is square, so every step is a 2x2 solve.
+  bool converged = false;
+  for (int i = 0; i < n; ++i) {
+    const Scalar mx2_u = x * x;
+    const Scalar my2_u = y * y;
+    const Scalar mxy_u = x * y;
+    const Scalar rho2_u = mx2_u + my2_u;
+    const Scalar rad_dist_u = k1 * rho2_u + k2 * rho2_u * rho2_u;
+
+    const Scalar e0 = y0 - (x + x * rad_dist_u + 2 * p1 * mxy_u + p2 * (rho2_u + 2 * mx2_u));
+    const Scalar e1 = y1 - (y + y * rad_dist_u + 2 * p2 * mxy_u + p1 * (rho2_u + 2 * my2_u));
+
+    const Scalar radial_derivative = 2 * k1 + 4 * k2 * rho2_u;
+    const Scalar duf_du = 1 + rad_dist_u + radial_derivative * mx2_u + 2 * p1 * y
+                          + 6 * p2 * x;
+    const Scalar duf_dv = radial_derivative * mxy_u + 2 * p1 * x + 2 * p2 * y;
+    const Scalar dvf_dv = 1 + rad_dist_u + radial_derivative * my2_u + 2 * p2 * x
+                          + 6 * p1 * y;
+
+    const Scalar determinant = duf_du * dvf_dv - duf_dv * duf_dv;
+    if (std::abs(determinant) < Scalar(1e-12)) {
+      break;
+    }
+    x += (dvf_dv * e0 - duf_dv * e1) / determinant;
+    y += (duf_du * e1 - duf_dv * e0) / determinant;
+    if (e0 * e0 + e1 * e1 <= tolerance) {
+      converged = true;
+      break;
+    }
+  }
+  LOG_IF(WARNING, !converged) << "Did not converge with max. iterations.";
+  (*point) << x, y;
+}
+
+template <typename Scalar>
+void undistortRadTanVectorized(const Eigen::VectorXd& dist_coeffs,
+                               Eigen::Matrix<Scalar, 2, Eigen::Dynamic>* points) {
+  const Scalar k1 = static_cast<Scalar>(dist_coeffs(0));
+  const Scalar k2 = static_cast<Scalar>(dist_coeffs(1));
+  const Scalar p1 = static_cast<Scalar>(dist_coeffs(2));
+  const Scalar p2 = static_cast<Scalar>(dist_coeffs(3));
+  const Scalar tolerance = static_cast<Scalar>(FLAGS_acv_inv_distortion_tolerance);
+  Eigen::Matrix<Scalar, 2, 1> point;
+  for (int i = 0; i < points->cols(); ++i) {
+    point = points->col(i);
+    undistortRadTan(k1, k2, p1, p2, tolerance, &point);
+    points->col(i) = point;
+  }
+}
+}  // namespace
+
 std::ostream& operator<<(std::ostream& out, const RadTanDistortion& distortion) {
   distortion.printParameters(out, std::string(""));
   return out;
@@ -94,27 +164,22 @@ void RadTanDistortion::undistortUsingExternalCoefficients(const Eigen::VectorXd&
                                                           Eigen::Vector2d* point) const {
   CHECK_EQ(dist_coeffs.size(), kNumOfParams) << "dist_coeffs: invalid size!";
   CHECK_NOTNULL(point);
+  undistortRadTan<double>(dist_coeffs(0), dist_coeffs(1), dist_coeffs(2), dist_coeffs(3),
+                          FLAGS_acv_inv_distortion_tolerance, point);
+}
 
-  const int n = 30;  // Max. number of iterations
-
-  Eigen::Vector2d& y = *point;
-  Eigen::Vector2d ybar = y;
-  Eigen::Matrix2d F;
-  Eigen::Vector2d y_tmp;
-
-  int i;
-  for (i = 0; i < n; ++i) {
-    y_tmp = ybar;
-    distortUsingExternalCoefficients(&dist_coeffs, &y_tmp, &F);
-    Eigen::Vector2d e(y - y_tmp);
-    Eigen::Vector2d du = (F.transpose() * F).inverse() * F.transpose() * e;
-    ybar += du;
-    if (e.dot(e) <= FLAGS_acv_inv_distortion_tolerance)
-      break;
-  }
-  LOG_IF(WARNING, i >= n) << "Did not converge with max. iterations.";
+void RadTanDistortion::undistortUsingExternalCoefficientsVectorized(
+    const Eigen::VectorXd& dist_coeffs, Eigen::Matrix2Xd* points) const {
+  CHECK_EQ(dist_coeffs.size(), kNumOfParams) << "dist_coeffs: invalid size!";
+  CHECK_NOTNULL(points);
+  undistortRadTanVectorized<double>(dist_coeffs, points);
+}
 
-  y = ybar;
+void RadTanDistortion::undistortUsingExternalCoefficientsVectorized(
+    const Eigen::VectorXd& dist_coeffs, Eigen::Matrix2Xf* points) const {
+  CHECK_EQ(dist_coeffs.size(), kNumOfParams) << "dist_coeffs: invalid size!";
+  CHECK_NOTNULL(points);
+  undistortRadTanVectorized<float>(dist_coeffs, points);
 }
 
 bool RadTanDistortion::areParametersValid(const Eigen::VectorXd& parameters) {
@@ -62,6 +62,38 @@ void Distortion::undistort(const Eigen::Vector2d& point,
   undistortUsingExternalCoefficients(distortion_coefficients_, out_point);
 }
 
+void Distortion::undistortVectorized(Eigen::Matrix2Xd* points) const {
+  CHECK_NOTNULL(points);
+  undistortUsingExternalCoefficientsVectorized(distortion_coefficients_, points);
+}
+
+void Distortion::undistortUsingExternalCoefficientsVectorized(
+    const Eigen::VectorXd& dist_coeffs, Eigen::Matrix2Xd* points) const {
+  CHECK_NOTNULL(points);
+  Eigen::Vector2d point;
+  for (int i = 0; i < points->cols(); ++i) {
+    point = points->col(i);
+    undistortUsingExternalCoefficients(dist_coeffs, &point);
+    points->col(i) = point;
+  }
+}
+
+void Distortion::undistortVectorized(Eigen::Matrix2Xf* points) const {
+  CHECK_NOTNULL(points);
+  undistortUsingExternalCoefficientsVectorized(distortion_coefficients_, points);
+}
+
+void Distortion::undistortUsingExternalCoefficientsVectorized(
+    const Eigen::VectorXd& dist_coeffs, Eigen::Matrix2Xf* points) const {
+  CHECK_NOTNULL(points);
+  Eigen::Vector2d point;
+  for (int i = 0; i < points->cols(); ++i) {
+    point = points->col(i).cast<double>();
+    undistortUsingExternalCoefficients(dist_coeffs, &point);
+    points->col(i) = point.cast<float>();
+  }
+}
+
 void Distortion::setParameters(const Eigen::VectorXd& dist_coeffs) {
   CHECK(distortionParametersValid(dist_coeffs)) << "Distortion parameters invalid!";
   distortion_coefficients_ = dist_coeffs;
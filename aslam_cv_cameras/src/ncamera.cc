@@ -1,5 +1,6 @@
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -345,6 +346,93 @@ aslam::NCamera::Ptr NCamera::cloneRigWithoutDistortion() const {
   return rig_without_distortion;
 }
 
+void NCamera::getVisibleLandmarks(
+    const Transformation& T_G_B, const Eigen::Ref<const Eigen::Matrix3Xd>& G_landmarks,
+    std::vector<int>* out_landmark_indices, std::vector<int>* out_camera_indices,
+    Eigen::Matrix2Xd* out_keypoints, size_t num_threads) const {
+  CHECK_NOTNULL(out_landmark_indices);
+  CHECK_NOTNULL(out_camera_indices);
+  CHECK_NOTNULL(out_keypoints);
+  const size_t num_cameras = cameras_.size();
+  const int num_landmarks = static_cast<int>(G_landmarks.cols());
+  const Transformation T_B_G = T_G_B.inverse();
+
+  // Few landmarks are not worth handing the cameras to other threads.
+  constexpr int kMinNumLandmarksForThreads = 1024;
+  if (num_landmarks < kMinNumLandmarksForThreads) {
+    num_threads = 1u;
+  }
+
+  std::vector<std::vector<int>> landmark_indices(num_cameras);
+  std::vector<Eigen::Matrix2Xd> keypoints(num_cameras);
+  common::parallelProcess(num_cameras, num_threads, [&](size_t begin, size_t end) {
+    Eigen::Matrix3Xd C_landmarks(3, num_landmarks);
+    std::vector<int> candidates;
+    candidates.reserve(num_landmarks);
+    Eigen::Matrix2Xd candidate_keypoints;
+    std::vector<ProjectionResult> projection_results;
+    std::vector<bool> is_masked;
+    for (size_t camera_idx = begin; camera_idx < end; ++camera_idx) {
+      const Camera& camera = *CHECK_NOTNULL(cameras_[camera_idx].get());
+      const Transformation T_C_G = T_C_B_[camera_idx] * T_B_G;
+      const Eigen::Matrix3d R_C_G = T_C_G.getRotationMatrix();
+      const Eigen::Vector3d C_p_G = T_C_G.getPosition();
+
+      // Keep the landmarks inside of the bounding cone of the camera.
+      Eigen::Vector3d cone_axis;
+      double cos_half_angle;
+      camera.getBoundingCone(&cone_axis, &cos_half_angle);
+      const bool has_cone = cos_half_angle > -1.0;
+      candidates.clear();
+      for (int i = 0; i < num_landmarks; ++i) {
+        const Eigen::Vector3d C_landmark = R_C_G * G_landmarks.col(i) + C_p_G;
+        if (has_cone && cone_axis.dot(C_landmark) < cos_half_angle * C_landmark.norm()) {
+          continue;
+        }
+        C_landmarks.col(candidates.size()) = C_landmark;
+        candidates.push_back(i);
+      }
+
+      const int num_candidates = static_cast<int>(candidates.size());
+      camera.project3Vectorized(
+          C_landmarks.leftCols(num_candidates), &candidate_keypoints, &projection_results);
+      camera.areMasked(candidate_keypoints, &is_masked);
+
+      std::vector<int>& camera_landmark_indices = landmark_indices[camera_idx];
+      Eigen::Matrix2Xd& camera_keypoints = keypoints[camera_idx];
+      camera_keypoints.resize(Eigen::NoChange, num_candidates);
+      for (int i = 0; i < num_candidates; ++i) {
+        if (projection_results[i].isKeypointVisible() && !is_masked[i]) {
+          camera_keypoints.col(camera_landmark_indices.size()) = candidate_keypoints.col(i);
+          camera_landmark_indices.push_back(candidates[i]);
+        }
+      }
+      camera_keypoints.conservativeResize(Eigen::NoChange, camera_landmark_indices.size());
+    }
+  });
+
+  size_t num_observations = 0u;
+  for (const std::vector<int>& camera_landmark_indices : landmark_indices) {
+    num_observations += camera_landmark_indices.size();
+  }
+  out_landmark_indices->clear();
+  out_landmark_indices->reserve(num_observations);
+  out_camera_indices->clear();
+  out_camera_indices->reserve(num_observations);
+  out_keypoints->resize(Eigen::NoChange, num_observations);
+  for (size_t camera_idx = 0u; camera_idx < num_cameras; ++camera_idx) {
+    const std::vector<int>& camera_landmark_indices = landmark_indices[camera_idx];
+    out_keypoints->middleCols(out_landmark_indices->size(), camera_landmark_indices.size()) =
+        keypoints[camera_idx];
+    out_landmark_indices->insert(
+        out_landmark_indices->end(), camera_landmark_indices.begin(),
+        camera_landmark_indices.end());
+    out_camera_indices->insert(
+        out_camera_indices->end(), camera_landmark_indices.size(),
+        static_cast<int>(camera_idx));
+  }
+}
+
 bool NCamera::isValidImpl() const {
   for (const aslam::Camera::Ptr& camera : cameras_) {
     CHECK(camera);
@@ -0,0 +1,162 @@
+#include <Eigen/Core>
+#include <eigen-checks/gtest.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/bearing-lookup-table.h>
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/camera-unified-projection.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-null.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+
+template<typename Camera, typename Distortion>
+struct CameraDistortion {
+  typedef Camera CameraType;
+  typedef Distortion DistortionType;
+};
+
+using testing::Types;
+typedef Types<CameraDistortion<aslam::PinholeCamera, aslam::RadTanDistortion>,
+    CameraDistortion<aslam::PinholeCamera, aslam::EquidistantDistortion>,
+    CameraDistortion<aslam::PinholeCamera, aslam::NullDistortion>,
+    CameraDistortion<aslam::UnifiedProjectionCamera, aslam::FisheyeDistortion>,
+    CameraDistortion<aslam::UnifiedProjectionCamera, aslam::RadTanDistortion>>
+    Implementations;
+
+template <class CameraDistortion>
+class TestBearingLookupTable : public testing::Test {
+ public:
+  typedef typename CameraDistortion::CameraType CameraType;
+  typedef typename CameraDistortion::DistortionType DistortionType;
+ protected:
+  TestBearingLookupTable()
+      : camera_(CameraType::template createTestCamera<DistortionType>()) {}
+  virtual ~TestBearingLookupTable() {}
+
+  // Random keypoints in the image including the corners and the border.
+  Eigen::Matrix2Xd createKeypointsInImage(int num_keypoints) const {
+    const Eigen::Array2d image_size(camera_->imageWidth(), camera_->imageHeight());
+    Eigen::Matrix2Xd keypoints =
+        ((Eigen::Array2Xd::Random(2, num_keypoints) + 1.0) * 0.5).colwise() * image_size;
+    keypoints.col(0) << 0.0, 0.0;
+    keypoints.col(1) = image_size;
+    keypoints.col(2) << image_size(0), 0.0;
+    keypoints.col(3) << 17.0, 23.0;
+    return keypoints;
+  }
+
+  void expectExactBearingVectors(const Eigen::Matrix2Xd& keypoints,
+                                 const Eigen::Matrix3Xd& bearings,
+                                 const std::vector<unsigned char>& success,
+                                 double max_angle) const {
+    ASSERT_EQ(bearings.cols(), keypoints.cols());
+    ASSERT_EQ(static_cast<int>(success.size()), keypoints.cols());
+    for (int i = 0; i < keypoints.cols(); ++i) {
+      Eigen::Vector3d point_3d;
+      const bool expected_success = camera_->backProject3(keypoints.col(i), &point_3d);
+      EXPECT_EQ(static_cast<bool>(success[i]), expected_success);
+      if (expected_success) {
+        EXPECT_NEAR(bearings.col(i).norm(), 1.0, 1e-12);
+        EXPECT_LT(bearings.col(i).cross(point_3d.normalized()).norm(), max_angle)
+            << "keypoint: " << keypoints.col(i).transpose();
+      }
+    }
+  }
+
+  typename CameraType::Ptr camera_;
+};
+
+TYPED_TEST_CASE(TestBearingLookupTable, Implementations);
+
+TYPED_TEST(TestBearingLookupTable, MatchesBackProjection) {
+  const Eigen::Matrix2Xd keypoints = this->createKeypointsInImage(10000);
+  this->camera_->setBearingLookupTableEnabled(true);
+  ASSERT_TRUE(this->camera_->isBearingLookupTableEnabled());
+  Eigen::Matrix3Xd bearings;
+  std::vector<unsigned char> success;
+  this->camera_->getNormalizedBearingVectors(keypoints, &bearings, &success);
+  this->expectExactBearingVectors(keypoints, bearings, success, 1e-5);
+}
+
+TYPED_TEST(TestBearingLookupTable, DisabledBackProjectsExactly) {
+  const Eigen::Matrix2Xd keypoints = this->createKeypointsInImage(1000);
+  ASSERT_FALSE(this->camera_->isBearingLookupTableEnabled());
+  Eigen::Matrix3Xd bearings;
+  std::vector<unsigned char> success;
+  this->camera_->getNormalizedBearingVectors(keypoints, &bearings, &success);
+  this->expectExactBearingVectors(keypoints, bearings, success, 1e-12);
+}
+
+TYPED_TEST(TestBearingLookupTable, KeypointsOutsideImageBackProjectExactly) {
+  const double width = this->camera_->imageWidth();
+  const double height = this->camera_->imageHeight();
+  Eigen::Matrix2Xd keypoints(2, 4);
+  keypoints << -0.5, width + 0.5, 10.0, 20.0,
+               10.0, 20.0, -2.0, height + 1.0;
+  this->camera_->setBearingLookupTableEnabled(true);
+  Eigen::Matrix3Xd bearings;
+  std::vector<unsigned char> success;
+  this->camera_->getNormalizedBearingVectors(keypoints, &bearings, &success);
+  this->expectExactBearingVectors(keypoints, bearings, success, 1e-12);
+}
+
+TYPED_TEST(TestBearingLookupTable, RebuiltAfterCalibrationChange) {
+  const Eigen::Matrix2Xd keypoints = this->createKeypointsInImage(1000);
+  this->camera_->setBearingLookupTableEnabled(true);
+  Eigen::Matrix3Xd bearings;
+  std::vector<unsigned char> success;
+  this->camera_->getNormalizedBearingVectors(keypoints, &bearings, &success);
+
+  Eigen::VectorXd intrinsics = this->camera_->getParameters();
+  intrinsics.tail<4>() *= 1.1;
+  this->camera_->setParameters(intrinsics);
+  this->camera_->getNormalizedBearingVectors(keypoints, &bearings, &success);
+  this->expectExactBearingVectors(keypoints, bearings, success, 1e-5);
+
+  // Changes through the mutable accessors are detected as well.
+  this->camera_->getParametersMutable()[intrinsics.size() - 1] += 5.0;
+  this->camera_->getNormalizedBearingVectors(keypoints, &bearings, &success);
+  this->expectExactBearingVectors(keypoints, bearings, success, 1e-5);
+
+  aslam::Distortion::UniquePtr distortion(new aslam::NullDistortion);
+  this->camera_->setDistortion(distortion);
+  this->camera_->getNormalizedBearingVectors(keypoints, &bearings, &success);
+  this->expectExactBearingVectors(keypoints, bearings, success, 1e-5);
+}
+
+TYPED_TEST(TestBearingLookupTable, RestoredFromStoredNodes) {
+  const Eigen::Matrix2Xd keypoints = this->createKeypointsInImage(1000);
+  this->camera_->setBearingLookupTableEnabled(true);
+  std::shared_ptr<const aslam::BearingLookupTable> table =
+      this->camera_->getBearingLookupTable();
+  ASSERT_TRUE(table != nullptr);
+  Eigen::Matrix3Xd bearings;
+  std::vector<unsigned char> success;
+  this->camera_->getNormalizedBearingVectors(keypoints, &bearings, &success);
+
+  // A copy of the camera uses a table restored from the nodes of the first one.
+  aslam::Camera::Ptr camera_copy(this->camera_->clone());
+  camera_copy->setBearingLookupTableEnabled(false);
+  std::shared_ptr<const aslam::BearingLookupTable> restored_table(
+      new aslam::BearingLookupTable(
+          *camera_copy, table->getBearings(), table->getNodeValidity()));
+  camera_copy->setBearingLookupTable(restored_table);
+  EXPECT_TRUE(camera_copy->isBearingLookupTableEnabled());
+  EXPECT_EQ(camera_copy->getBearingLookupTable(), restored_table);
+  Eigen::Matrix3Xd restored_bearings;
+  std::vector<unsigned char> restored_success;
+  camera_copy->getNormalizedBearingVectors(keypoints, &restored_bearings, &restored_success);
+  EXPECT_TRUE(EIGEN_MATRIX_EQUAL(bearings, restored_bearings));
+  EXPECT_EQ(success, restored_success);
+
+  // The table is not accepted for a different calibration.
+  Eigen::VectorXd intrinsics = camera_copy->getParameters();
+  intrinsics.tail<4>() *= 1.1;
+  camera_copy->setParameters(intrinsics);
+  EXPECT_DEATH(camera_copy->setBearingLookupTable(restored_table), "calibration");
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
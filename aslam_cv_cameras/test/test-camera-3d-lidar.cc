@@ -2,9 +2,12 @@
 #include <eigen-checks/gtest.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <typeinfo>
+#include <vector>
 
 #include <aslam/cameras/camera-3d-lidar.h>
+#include <aslam/cameras/camera-dispatch.h>
 #include <aslam/cameras/camera-factory.h>
 #include <aslam/cameras/camera-pinhole.h>
 #include <aslam/cameras/camera-unified-projection.h>
@@ -259,4 +262,105 @@ TYPED_TEST(TestCameras, YamlSerialization) {
   EXPECT_TRUE(camera->isEqual(*this->camera_.get(), true));
 }
 
+TYPED_TEST(TestCameras, BoundingConeContainsAllDirections) {
+  Eigen::Vector3d cone_axis;
+  double cos_half_angle;
+  this->camera_->getBoundingCone(&cone_axis, &cos_half_angle);
+  EXPECT_EQ(cos_half_angle, -1.0);
+  Eigen::Matrix<double, 4, 3> plane_normals;
+  EXPECT_FALSE(this->camera_->getBoundingFrustum(&plane_normals));
+}
+
+TYPED_TEST(TestCameras, RasterizeRangeImageMatchesProjection) {
+  const int kNumPoints = 20000;
+  const int width = static_cast<int>(this->camera_->imageWidth());
+  const int height = static_cast<int>(this->camera_->imageHeight());
+  this->camera_->setLineDelayNanoSeconds(100u);
+  Eigen::Matrix3Xd points(3, kNumPoints);
+  for (int i = 0; i < kNumPoints; ++i) {
+    points.col(i) = this->camera_->createRandomVisiblePoint(1.0 + i % 50);
+  }
+  // Occluded point behind the first point, a duplicate of the first point (the lower index
+  // wins), points that are not visible and a point on the seam of the sweep.
+  points.col(1) = 2.0 * points.col(0);
+  points.col(2) = points.col(0);
+  points.col(3) << 0.0, 0.0, 0.0;
+  points.col(4) << 0.0, 10.0, 0.1;
+  points.col(5) << -1e-17, 0.0, 10.0;
+
+  // Reference: sequential z-buffer on top of project3.
+  Eigen::MatrixXd expected_range_image = Eigen::MatrixXd::Zero(height, width);
+  Eigen::MatrixXi expected_index_image = Eigen::MatrixXi::Constant(height, width, -1);
+  Eigen::Vector2d keypoint;
+  for (int i = 0; i < kNumPoints; ++i) {
+    const aslam::ProjectionResult result = this->camera_->project3(points.col(i), &keypoint);
+    if (i == 5) {
+      // Projects exactly onto the image width, which is outside of the image.
+      EXPECT_EQ(width, keypoint(0));
+      EXPECT_EQ(aslam::ProjectionResult::Status::KEYPOINT_OUTSIDE_IMAGE_BOX,
+                result.getDetailedStatus());
+    }
+    if (!result.isKeypointVisible()) {
+      continue;
+    }
+    const int col = static_cast<int>(keypoint(0));
+    const int row = static_cast<int>(keypoint(1));
+    const double range = points.col(i).norm();
+    if (expected_index_image(row, col) < 0 || range < expected_range_image(row, col)) {
+      expected_range_image(row, col) = range;
+      expected_index_image(row, col) = i;
+    }
+  }
+
+  for (const size_t num_threads : {1u, 3u, 8u}) {
+    Eigen::MatrixXd range_image;
+    Eigen::MatrixXi index_image;
+    std::vector<int64_t> column_delays;
+    this->camera_->rasterizeRangeImage(
+        points, &range_image, &index_image, &column_delays, num_threads);
+    ASSERT_EQ(height, range_image.rows());
+    ASSERT_EQ(width, range_image.cols());
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(range_image, expected_range_image, 1e-12));
+    EXPECT_TRUE(index_image == expected_index_image) << "Threads: " << num_threads;
+    EXPECT_EQ(0, std::count(index_image.data(), index_image.data() + index_image.size(), 1));
+    EXPECT_EQ(0, std::count(index_image.data(), index_image.data() + index_image.size(), 2));
+    EXPECT_EQ(0, std::count(index_image.data(), index_image.data() + index_image.size(), 5));
+
+    ASSERT_EQ(static_cast<size_t>(width), column_delays.size());
+    for (int col = 0; col < width; ++col) {
+      EXPECT_EQ(this->camera_->rollingShutterDelayNanoSeconds(Eigen::Vector2d(col + 0.5, 0.0)),
+                column_delays[col]);
+    }
+  }
+
+  Eigen::MatrixXd range_image;
+  Eigen::MatrixXi index_image;
+  this->camera_->rasterizeRangeImage(Eigen::Matrix3Xd(3, 0), &range_image, &index_image);
+  EXPECT_TRUE(range_image.isZero());
+  EXPECT_TRUE((index_image.array() == -1).all());
+}
+
+TYPED_TEST(TestCameras, DispatchedProjectionMatchesProject3) {
+  const int kNumPoints = 1000;
+  Eigen::Matrix3Xd points(3, kNumPoints);
+  for (int i = 0; i < kNumPoints; ++i) {
+    points.col(i) = this->camera_->createRandomVisiblePoint(1.0 + i % 50);
+  }
+  points.col(0).setZero();
+  points.col(1) << 0.0, 10.0, 0.1;
+
+  int num_calls = 0;
+  aslam::applyProjectionKernel(
+      *this->camera_, points,
+      [&](int index, const Eigen::Vector2d& keypoint, const aslam::ProjectionResult& result) {
+        ++num_calls;
+        Eigen::Vector2d expected_keypoint;
+        const aslam::ProjectionResult expected_result =
+            this->camera_->project3(points.col(index), &expected_keypoint);
+        EXPECT_EQ(expected_result.getDetailedStatus(), result.getDetailedStatus());
+        EXPECT_TRUE(EIGEN_MATRIX_NEAR(expected_keypoint, keypoint, 1e-12));
+      });
+  EXPECT_EQ(kNumPoints, num_calls);
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
@@ -1,3 +1,8 @@
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
 #include <Eigen/Core>
 #include <eigen-checks/gtest.h>
 #include <glog/logging.h>
@@ -5,6 +10,7 @@
 #include <typeinfo>
 
 #include <aslam/cameras/camera.h>
+#include <aslam/cameras/camera-dispatch.h>
 #include <aslam/cameras/camera-factory.h>
 #include <aslam/cameras/camera-pinhole.h>
 #include <aslam/cameras/camera-unified-projection.h>
@@ -267,6 +273,46 @@ TYPED_TEST(TestCameras, isProjectable) {
   EXPECT_FALSE(this->camera_->isProjectable3(Eigen::Vector3d(0, 0, -1)));     // Behind, center.
 }
 
+TYPED_TEST(TestCameras, BoundingConeAndFrustumContainImage) {
+  Eigen::Vector3d cone_axis;
+  double cos_half_angle;
+  this->camera_->getBoundingCone(&cone_axis, &cos_half_angle);
+  EXPECT_NEAR(cone_axis.norm(), 1.0, 1e-12);
+  ASSERT_GT(cos_half_angle, -1.0);
+  Eigen::Matrix<double, 4, 3> plane_normals;
+  const bool has_frustum = this->camera_->getBoundingFrustum(&plane_normals);
+
+  // The rays of a grid of pixels up to the outer image edge are inside of the bounds.
+  constexpr int kNumSteps = 100;
+  const double max_u = this->camera_->imageWidth();
+  const double max_v = this->camera_->imageHeight();
+  Eigen::Vector3d ray;
+  for (int i = 0; i <= kNumSteps; ++i) {
+    for (int j = 0; j <= kNumSteps; ++j) {
+      const Eigen::Vector2d keypoint(max_u * i / kNumSteps, max_v * j / kNumSteps);
+      if (!this->camera_->backProject3(keypoint, &ray)) {
+        continue;
+      }
+      EXPECT_GE(cone_axis.dot(ray), cos_half_angle * ray.norm()) << keypoint.transpose();
+      if (has_frustum) {
+        EXPECT_GE((plane_normals * ray).minCoeff(), 0.0) << keypoint.transpose();
+      }
+    }
+  }
+
+  // The point behind the camera is culled.
+  const Eigen::Vector3d point_behind(0.0, 0.0, -1.0);
+  EXPECT_LT(cone_axis.dot(point_behind), cos_half_angle * point_behind.norm());
+  if (has_frustum) {
+    EXPECT_LT((plane_normals * point_behind).minCoeff(), 0.0);
+  }
+  // The cached cone follows changes of the calibration.
+  this->camera_->setImageWidth(this->camera_->imageWidth() / 2u);
+  double narrow_cos_half_angle;
+  this->camera_->getBoundingCone(&cone_axis, &narrow_cos_half_angle);
+  EXPECT_GT(narrow_cos_half_angle, cos_half_angle);
+}
+
 TYPED_TEST(TestCameras, CameraTest_isInvertible) {
   const int N = 100;
   const double depth = 10.0;
@@ -310,6 +356,421 @@ TYPED_TEST(TestCameras, CameraTest_isInvertible) {
   EXPECT_TRUE(EIGEN_MATRIX_NEAR(points1, points3, 1e-2));
 }
 
+TYPED_TEST(TestCameras, VectorizedProjectionMatchesScalar) {
+  const size_t kNumVisiblePoints = 1000u;
+  const size_t kNumPoints = kNumVisiblePoints + 4u;
+  Eigen::Matrix3Xd points(3, kNumPoints);
+  for (size_t n = 0u; n < kNumVisiblePoints; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(1.0 + n % 10);
+  }
+  // Points on the optical axis, outside of the image, behind the camera and on the
+  // camera plane.
+  points.col(kNumVisiblePoints) << 0.0, 0.0, 1.0;
+  points.col(kNumVisiblePoints + 1u) << 10.0, -10.0, 1.0;
+  points.col(kNumVisiblePoints + 2u) << 0.1, 0.2, -1.0;
+  points.col(kNumVisiblePoints + 3u) << 0.1, 0.2, 0.0;
+
+  Eigen::Matrix2Xd keypoints;
+  std::vector<aslam::ProjectionResult> results;
+  this->camera_->project3Vectorized(points, &keypoints, &results);
+  ASSERT_EQ(kNumPoints, static_cast<size_t>(keypoints.cols()));
+  ASSERT_EQ(kNumPoints, results.size());
+
+  Eigen::Vector2d keypoint;
+  for (size_t n = 0u; n < kNumPoints; ++n) {
+    const aslam::ProjectionResult result = this->camera_->project3(points.col(n), &keypoint);
+    EXPECT_EQ(result.getDetailedStatus(), results[n].getDetailedStatus()) << "Point " << n;
+    if (result.getDetailedStatus() == aslam::ProjectionResult::Status::KEYPOINT_VISIBLE ||
+        result.getDetailedStatus() ==
+            aslam::ProjectionResult::Status::KEYPOINT_OUTSIDE_IMAGE_BOX) {
+      EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoints.col(n), 1e-9)) << "Point " << n;
+    }
+  }
+}
+
+TYPED_TEST(TestCameras, VectorizedBackProjectionMatchesScalar) {
+  const size_t kNumRandomKeypoints = 1000u;
+  const size_t kNumKeypoints = kNumRandomKeypoints + 3u;
+  Eigen::Matrix2Xd keypoints(2, kNumKeypoints);
+  for (size_t n = 0u; n < kNumRandomKeypoints; ++n) {
+    keypoints.col(n) = this->camera_->createRandomKeypoint();
+  }
+  // The principal point, the image corner and a keypoint far outside of the image.
+  const Eigen::VectorXd& intrinsics = this->camera_->getParameters();
+  keypoints.col(kNumRandomKeypoints) = intrinsics.tail<2>();
+  keypoints.col(kNumRandomKeypoints + 1u) << 0.0, 0.0;
+  keypoints.col(kNumRandomKeypoints + 2u) << -1e4, 1e4;
+
+  Eigen::Matrix3Xd points;
+  std::vector<unsigned char> success;
+  this->camera_->backProject3Vectorized(keypoints, &points, &success);
+  ASSERT_EQ(kNumKeypoints, static_cast<size_t>(points.cols()));
+  ASSERT_EQ(kNumKeypoints, success.size());
+
+  Eigen::Vector3d point;
+  for (size_t n = 0u; n < kNumKeypoints; ++n) {
+    const bool scalar_success = this->camera_->backProject3(keypoints.col(n), &point);
+    EXPECT_EQ(scalar_success, static_cast<bool>(success[n])) << "Keypoint " << n;
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(point, points.col(n), 1e-9)) << "Keypoint " << n;
+  }
+}
+
+TYPED_TEST(TestCameras, VectorizedFloatMatchesDouble) {
+  const size_t kNumPoints = 1000u;
+  Eigen::Matrix3Xd points(3, kNumPoints);
+  for (size_t n = 0u; n < kNumPoints; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(1.0 + n % 10);
+  }
+
+  Eigen::Matrix2Xd keypoints;
+  std::vector<aslam::ProjectionResult> results;
+  this->camera_->project3Vectorized(points, &keypoints, &results);
+  Eigen::Matrix2Xf keypoints_float;
+  std::vector<aslam::ProjectionResult> results_float;
+  this->camera_->project3VectorizedFloat(points.cast<float>(), &keypoints_float, &results_float);
+  ASSERT_EQ(kNumPoints, static_cast<size_t>(keypoints_float.cols()));
+  ASSERT_EQ(kNumPoints, results_float.size());
+  for (size_t n = 0u; n < kNumPoints; ++n) {
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoints.col(n), keypoints_float.col(n).cast<double>(), 1e-3))
+        << "Point " << n;
+    EXPECT_EQ(results[n].getDetailedStatus(), results_float[n].getDetailedStatus())
+        << "Point " << n;
+  }
+
+  Eigen::Matrix3Xd bearings;
+  std::vector<unsigned char> success;
+  this->camera_->backProject3Vectorized(keypoints, &bearings, &success);
+  Eigen::Matrix3Xf bearings_float;
+  std::vector<unsigned char> success_float;
+  this->camera_->backProject3VectorizedFloat(
+      keypoints.cast<float>(), &bearings_float, &success_float);
+  ASSERT_EQ(kNumPoints, static_cast<size_t>(bearings_float.cols()));
+  ASSERT_EQ(kNumPoints, success_float.size());
+  for (size_t n = 0u; n < kNumPoints; ++n) {
+    EXPECT_EQ(success[n], success_float[n]) << "Keypoint " << n;
+    if (!success[n]) {
+      continue;
+    }
+    const Eigen::Vector3d bearing = bearings.col(n).normalized();
+    const Eigen::Vector3d bearing_float = bearings_float.col(n).cast<double>().normalized();
+    EXPECT_LT(std::acos(std::min(1.0, bearing.dot(bearing_float))), 1e-5) << "Keypoint " << n;
+  }
+}
+
+TYPED_TEST(TestCameras, VectorizedJacobiansMatchScalar) {
+  const size_t kNumVisiblePoints = 1000u;
+  const size_t kNumPoints = kNumVisiblePoints + 4u;
+  Eigen::Matrix3Xd points(3, kNumPoints);
+  for (size_t n = 0u; n < kNumVisiblePoints; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(1.0 + n % 10);
+  }
+  // Points outside of the image, behind the camera, on the camera plane and at the
+  // camera center.
+  points.col(kNumVisiblePoints) << 10.0, -10.0, 1.0;
+  points.col(kNumVisiblePoints + 1u) << 0.1, 0.2, -1.0;
+  points.col(kNumVisiblePoints + 2u) << 0.1, 0.2, 0.0;
+  points.col(kNumVisiblePoints + 3u) << 0.0, 0.0, 0.0;
+
+  const int num_intrinsics = this->camera_->getParameterSize();
+  const int num_distortion_params = this->camera_->getDistortion().getParameterSize();
+  Eigen::Matrix2Xd keypoints;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_point, J_intrinsics, J_distortion;
+  std::vector<aslam::ProjectionResult> results;
+  this->camera_->project3VectorizedWithJacobians(
+      points, &keypoints, &J_point, &J_intrinsics, &J_distortion, &results);
+  ASSERT_EQ(kNumPoints, static_cast<size_t>(keypoints.cols()));
+  ASSERT_EQ(kNumPoints, results.size());
+  ASSERT_EQ(3 * kNumPoints, static_cast<size_t>(J_point.cols()));
+  ASSERT_EQ(num_intrinsics * kNumPoints, static_cast<size_t>(J_intrinsics.cols()));
+  ASSERT_EQ(num_distortion_params * kNumPoints, static_cast<size_t>(J_distortion.cols()));
+
+  Eigen::Vector2d keypoint;
+  Eigen::Matrix<double, 2, 3> expected_J_point;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> expected_J_intrinsics, expected_J_distortion;
+  for (size_t n = 0u; n < kNumPoints; ++n) {
+    const aslam::ProjectionResult result = this->camera_->project3Functional(
+        points.col(n), nullptr, nullptr, &keypoint, &expected_J_point,
+        &expected_J_intrinsics, &expected_J_distortion);
+    EXPECT_EQ(result.getDetailedStatus(), results[n].getDetailedStatus()) << "Point " << n;
+    if (result.getDetailedStatus() == aslam::ProjectionResult::Status::PROJECTION_INVALID) {
+      EXPECT_TRUE(J_point.middleCols<3>(3 * n).isZero()) << "Point " << n;
+      EXPECT_TRUE(J_intrinsics.middleCols(num_intrinsics * n, num_intrinsics).isZero());
+      EXPECT_TRUE(J_distortion.middleCols(
+          num_distortion_params * n, num_distortion_params).isZero());
+      continue;
+    }
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoints.col(n), 1e-9)) << "Point " << n;
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+        expected_J_point, J_point.middleCols<3>(3 * n), 1e-9)) << "Point " << n;
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+        expected_J_intrinsics, J_intrinsics.middleCols(num_intrinsics * n, num_intrinsics),
+        1e-9)) << "Point " << n;
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+        expected_J_distortion,
+        J_distortion.middleCols(num_distortion_params * n, num_distortion_params), 1e-9))
+        << "Point " << n;
+  }
+
+  // Jacobians that are not requested are skipped.
+  Eigen::Matrix2Xd keypoints_without_jacobians;
+  this->camera_->project3VectorizedWithJacobians(
+      points, &keypoints_without_jacobians, nullptr, &J_intrinsics, nullptr, &results);
+  for (size_t n = 0u; n < kNumVisiblePoints; ++n) {
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+        keypoints.col(n), keypoints_without_jacobians.col(n), 1e-12)) << "Point " << n;
+  }
+}
+
+TYPED_TEST(TestCameras, DispatchedProjectionMatchesProject3) {
+  const size_t kNumVisiblePoints = 1000u;
+  const size_t kNumPoints = kNumVisiblePoints + 4u;
+  Eigen::Matrix3Xd points(3, kNumPoints);
+  for (size_t n = 0u; n < kNumVisiblePoints; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(1.0 + n % 10);
+  }
+  points.col(kNumVisiblePoints) << 10.0, -10.0, 1.0;
+  points.col(kNumVisiblePoints + 1u) << 0.1, 0.2, -1.0;
+  points.col(kNumVisiblePoints + 2u) << 0.1, 0.2, 0.0;
+  points.col(kNumVisiblePoints + 3u) << 0.0, 0.0, 0.0;
+
+  bool visited = false;
+  aslam::visitProjectionKernel(*this->camera_, [&](const auto& kernel) {
+    typedef typename std::decay<decltype(kernel)>::type KernelType;
+    EXPECT_TRUE((std::is_same<typename KernelType::CameraType,
+                              typename TestFixture::CameraType>::value));
+    EXPECT_EQ(static_cast<const aslam::Camera*>(&kernel.camera()),
+              static_cast<const aslam::Camera*>(this->camera_.get()));
+    visited = true;
+  });
+  EXPECT_TRUE(visited);
+
+  size_t num_calls = 0u;
+  aslam::applyProjectionKernel(
+      *this->camera_, points,
+      [&](int index, const Eigen::Vector2d& keypoint, const aslam::ProjectionResult& result) {
+        ASSERT_EQ(static_cast<int>(num_calls), index);
+        ++num_calls;
+        Eigen::Vector2d expected_keypoint;
+        const aslam::ProjectionResult expected_result =
+            this->camera_->project3(points.col(index), &expected_keypoint);
+        EXPECT_EQ(expected_result.getDetailedStatus(), result.getDetailedStatus())
+            << "Point " << index;
+        if (expected_result.getDetailedStatus() !=
+            aslam::ProjectionResult::Status::PROJECTION_INVALID) {
+          EXPECT_TRUE(EIGEN_MATRIX_NEAR(expected_keypoint, keypoint, 1e-12))
+              << "Point " << index;
+        }
+      });
+  EXPECT_EQ(kNumPoints, num_calls);
+}
+
+// Benchmark of the batched projection and back-projection against the scalar loops. Disabled
+// so that it does not run with the unit tests, run it with --gtest_also_run_disabled_tests.
+TYPED_TEST(TestCameras, DISABLED_VectorizedProjectionBenchmark) {
+  const size_t kNumPoints = 10000u;
+  const size_t kNumRepetitions = 10u;
+  Eigen::Matrix3Xd points(3, kNumPoints);
+  for (size_t n = 0u; n < kNumPoints; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(1.0 + n % 10);
+  }
+  Eigen::Matrix2Xd keypoints(2, kNumPoints);
+  std::vector<aslam::ProjectionResult> results(kNumPoints);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t repetition = 0u; repetition < kNumRepetitions; ++repetition) {
+    Eigen::Vector2d keypoint;
+    for (size_t n = 0u; n < kNumPoints; ++n) {
+      results[n] = this->camera_->project3(points.col(n), &keypoint);
+      keypoints.col(n) = keypoint;
+    }
+  }
+  const double scalar_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for (size_t repetition = 0u; repetition < kNumRepetitions; ++repetition) {
+    this->camera_->project3Vectorized(points, &keypoints, &results);
+  }
+  const double vectorized_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  Eigen::Matrix3Xd back_projected_points(3, kNumPoints);
+  std::vector<unsigned char> success(kNumPoints);
+  start = std::chrono::steady_clock::now();
+  for (size_t repetition = 0u; repetition < kNumRepetitions; ++repetition) {
+    Eigen::Vector3d point;
+    for (size_t n = 0u; n < kNumPoints; ++n) {
+      success[n] = this->camera_->backProject3(keypoints.col(n), &point);
+      back_projected_points.col(n) = point;
+    }
+  }
+  const double scalar_back_projection_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for (size_t repetition = 0u; repetition < kNumRepetitions; ++repetition) {
+    this->camera_->backProject3Vectorized(keypoints, &back_projected_points, &success);
+  }
+  const double vectorized_back_projection_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  LOG(INFO) << typeid(typename TestFixture::CameraType).name() << " with "
+            << typeid(typename TestFixture::DistortionType).name() << ": "
+            << kNumPoints * kNumRepetitions / scalar_seconds / 1e6
+            << " million scalar projections/s, "
+            << kNumPoints * kNumRepetitions / vectorized_seconds / 1e6
+            << " million vectorized projections/s, speedup "
+            << scalar_seconds / vectorized_seconds << "; back-projection speedup "
+            << scalar_back_projection_seconds / vectorized_back_projection_seconds;
+}
+
+// Rolling shutter projection of a single point with the scalar projection: iterates on the
+// capture time of the row of the keypoint, like the batched version.
+aslam::ProjectionResult projectRollingShutterScalar(
+    const aslam::Camera& camera, const Eigen::Vector3d& point,
+    const aslam::RollingShutterMotion& motion, int max_iterations, double tolerance_lines,
+    Eigen::Vector2d* keypoint) {
+  aslam::ProjectionResult result = camera.project3(point, keypoint);
+  const double line_delay_seconds = camera.getLineDelayNanoSeconds() * 1e-9;
+  double line = (*keypoint)[1];
+  for (int iteration = 1; iteration < max_iterations; ++iteration) {
+    const double time_seconds = line * line_delay_seconds;
+    const Eigen::Vector3d rotation_vector = time_seconds * motion.angular_velocity;
+    const double angle = rotation_vector.norm();
+    const Eigen::Matrix3d R_C0_Ct = (angle > 0.0)
+        ? Eigen::AngleAxisd(angle, rotation_vector / angle).toRotationMatrix()
+        : Eigen::Matrix3d::Identity();
+    result = camera.project3(
+        R_C0_Ct.transpose() * (point - time_seconds * motion.linear_velocity), keypoint);
+    const double line_change = std::abs((*keypoint)[1] - line);
+    line = (*keypoint)[1];
+    if (line_change < tolerance_lines) {
+      break;
+    }
+  }
+  return result;
+}
+
+TYPED_TEST(TestCameras, RollingShutterProjectionGlobalShutter) {
+  const size_t kNumPoints = 1000u;
+  Eigen::Matrix3Xd points(3, kNumPoints);
+  for (size_t n = 0u; n < kNumPoints; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(1.0 + n % 10);
+  }
+  points.col(0) << 0.0, 0.0, -1.0;
+  aslam::RollingShutterMotion motion;
+  motion.linear_velocity << 1.0, 2.0, 3.0;
+  motion.angular_velocity << 0.5, -0.5, 1.0;
+
+  ASSERT_EQ(this->camera_->getLineDelayNanoSeconds(), 0u);
+  Eigen::Matrix2Xd keypoints;
+  std::vector<aslam::ProjectionResult> results;
+  aslam::RollingShutterProjectionReport report;
+  this->camera_->project3RollingShutterVectorized(
+      points, motion, &keypoints, &results, &report);
+  Eigen::Matrix2Xd expected_keypoints;
+  std::vector<aslam::ProjectionResult> expected_results;
+  this->camera_->project3Vectorized(points, &expected_keypoints, &expected_results);
+
+  EXPECT_TRUE(EIGEN_MATRIX_EQUAL(keypoints, expected_keypoints));
+  EXPECT_EQ(results, expected_results);
+  EXPECT_EQ(report.num_iterations, 1);
+  EXPECT_EQ(report.num_converged, static_cast<int>(kNumPoints) - 1);
+  EXPECT_EQ(report.num_failed, 1);
+  EXPECT_EQ(report.num_not_converged, 0);
+}
+
+TYPED_TEST(TestCameras, RollingShutterProjectionMatchesScalar) {
+  const size_t kNumPoints = 1000u;
+  const int kMaxIterations = 10;
+  const double kToleranceLines = 1e-4;
+  Eigen::Matrix3Xd points(3, kNumPoints);
+  for (size_t n = 0u; n < kNumPoints; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(2.0 + n % 10);
+  }
+  aslam::RollingShutterMotion motion;
+  motion.linear_velocity << 1.0, -0.5, 2.0;
+  motion.angular_velocity << 0.2, -0.3, 0.5;
+  this->camera_->setLineDelayNanoSeconds(20000u);
+
+  Eigen::Matrix2Xd keypoints;
+  std::vector<aslam::ProjectionResult> results;
+  aslam::RollingShutterProjectionReport report;
+  this->camera_->project3RollingShutterVectorized(
+      points, motion, &keypoints, &results, &report, kMaxIterations, kToleranceLines);
+  EXPECT_EQ(report.num_converged, static_cast<int>(kNumPoints));
+  EXPECT_EQ(report.num_not_converged, 0);
+  EXPECT_EQ(report.num_failed, 0);
+  EXPECT_GT(report.num_iterations, 2);
+  EXPECT_LE(report.num_iterations, kMaxIterations);
+  EXPECT_EQ(report.max_line_change, 0.0);
+
+  // The motion during the readout moves the keypoints.
+  Eigen::Matrix2Xd global_shutter_keypoints;
+  std::vector<aslam::ProjectionResult> global_shutter_results;
+  this->camera_->project3Vectorized(points, &global_shutter_keypoints, &global_shutter_results);
+  EXPECT_GT((keypoints - global_shutter_keypoints).colwise().norm().maxCoeff(), 1.0);
+
+  for (size_t n = 0u; n < kNumPoints; ++n) {
+    Eigen::Vector2d keypoint;
+    const aslam::ProjectionResult result = projectRollingShutterScalar(
+        *this->camera_, points.col(n), motion, kMaxIterations, kToleranceLines, &keypoint);
+    EXPECT_EQ(results[n], result);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoints.col(n), keypoint, 1e-3));
+  }
+}
+
+// Benchmark of the batched rolling shutter projection against the scalar iteration. Disabled so
+// that it does not run with the unit tests, run it with --gtest_also_run_disabled_tests.
+TYPED_TEST(TestCameras, DISABLED_RollingShutterProjectionBenchmark) {
+  const size_t kNumPoints = 10000u;
+  const size_t kNumRepetitions = 10u;
+  const int kMaxIterations = 10;
+  const double kToleranceLines = 1e-3;
+  Eigen::Matrix3Xd points(3, kNumPoints);
+  for (size_t n = 0u; n < kNumPoints; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(2.0 + n % 10);
+  }
+  aslam::RollingShutterMotion motion;
+  motion.linear_velocity << 1.0, -0.5, 2.0;
+  motion.angular_velocity << 0.2, -0.3, 0.5;
+  this->camera_->setLineDelayNanoSeconds(20000u);
+  Eigen::Matrix2Xd keypoints(2, kNumPoints);
+  std::vector<aslam::ProjectionResult> results(kNumPoints);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t repetition = 0u; repetition < kNumRepetitions; ++repetition) {
+    Eigen::Vector2d keypoint;
+    for (size_t n = 0u; n < kNumPoints; ++n) {
+      results[n] = projectRollingShutterScalar(
+          *this->camera_, points.col(n), motion, kMaxIterations, kToleranceLines, &keypoint);
+      keypoints.col(n) = keypoint;
+    }
+  }
+  const double scalar_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  aslam::RollingShutterProjectionReport report;
+  start = std::chrono::steady_clock::now();
+  for (size_t repetition = 0u; repetition < kNumRepetitions; ++repetition) {
+    this->camera_->project3RollingShutterVectorized(
+        points, motion, &keypoints, &results, &report, kMaxIterations, kToleranceLines);
+  }
+  const double vectorized_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  LOG(INFO) << typeid(typename TestFixture::CameraType).name() << " with "
+            << typeid(typename TestFixture::DistortionType).name() << ": "
+            << kNumPoints * kNumRepetitions / scalar_seconds / 1e6
+            << " million scalar rolling shutter projections/s, "
+            << kNumPoints * kNumRepetitions / vectorized_seconds / 1e6
+            << " million vectorized rolling shutter projections/s, speedup "
+            << scalar_seconds / vectorized_seconds << "; " << report.num_iterations
+            << " iterations, " << report.num_converged << " converged, "
+            << report.num_not_converged << " not converged, " << report.num_failed
+            << " failed";
+}
+
 TYPED_TEST(TestCameras, TestClone) {
   aslam::Camera::Ptr cam1(this->camera_->clone());
 
@@ -369,6 +830,58 @@ TYPED_TEST(TestCameras, validMaskTest) {
   EXPECT_TRUE(this->camera_->isMasked(Vec2(10.5, 20.5)));
 }
 
+TYPED_TEST(TestCameras, BatchMaskTestMatchesIsMasked) {
+  const int width = static_cast<int>(this->camera_->imageWidth());
+  const int height = static_cast<int>(this->camera_->imageHeight());
+  const int kNumKeypoints = 5000;
+  Eigen::Matrix2Xd keypoints(2, kNumKeypoints);
+  keypoints.row(0).setRandom();
+  keypoints.row(1).setRandom();
+  // Spread the keypoints over the image and a border around it.
+  keypoints.row(0) = (keypoints.row(0).array() + 1.0) * 0.6 * width - 0.1 * width;
+  keypoints.row(1) = (keypoints.row(1).array() + 1.0) * 0.6 * height - 0.1 * height;
+  keypoints.col(0) << std::numeric_limits<double>::quiet_NaN(), 1.0;
+  keypoints.col(1) << width - 1e-9, height - 1e-9;
+
+  auto expect_matches_is_masked = [&]() {
+    std::vector<bool> is_masked;
+    this->camera_->areMasked(keypoints, &is_masked);
+    ASSERT_EQ(static_cast<size_t>(kNumKeypoints), is_masked.size());
+    EXPECT_TRUE(is_masked[0]);
+    for (int i = 1; i < kNumKeypoints; ++i) {
+      EXPECT_EQ(this->camera_->isMasked(keypoints.col(i)), is_masked[i]) << "Keypoint " << i;
+    }
+  };
+
+  // Without a mask only the image box counts.
+  expect_matches_is_masked();
+
+  cv::Mat mask(height, width, CV_8UC1);
+  for (int row = 0; row < height; ++row) {
+    for (int col = 0; col < width; ++col) {
+      mask.at<uint8_t>(row, col) = (row * 7 + col * 13) % 5 == 0 ? 0u : 255u;
+    }
+  }
+  this->camera_->setMask(mask);
+  expect_matches_is_masked();
+
+  this->camera_->setPackedMaskEnabled(true);
+  EXPECT_TRUE(this->camera_->isPackedMaskEnabled());
+  expect_matches_is_masked();
+
+  // The packed mask follows the mask.
+  mask = cv::Mat::ones(height, width, CV_8UC1);
+  mask.at<uint8_t>(height - 1, width - 1) = 0u;
+  this->camera_->setMask(mask);
+  expect_matches_is_masked();
+  std::vector<bool> is_masked;
+  this->camera_->areMasked(keypoints.col(1), &is_masked);
+  EXPECT_TRUE(is_masked[0]);
+
+  this->camera_->clearMask();
+  expect_matches_is_masked();
+}
+
 TYPED_TEST(TestCameras, YamlSerialization){
   ASSERT_NE(this->camera_, nullptr);
   this->camera_->serializeToFile("test.yaml");
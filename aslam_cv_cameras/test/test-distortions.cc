@@ -113,6 +113,54 @@ TYPED_TEST(TestDistortions, DistortAndUndistortImageCenter) {
   EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint2, keypoint, 1e-12));
 }
 
+TYPED_TEST(TestDistortions, UndistortVectorizedMatchesScalar) {
+  const int kNumSamples = 1e4;
+  Eigen::Matrix2Xd keypoints = 5.0 * Eigen::Matrix2Xd::Random(2, kNumSamples);
+  keypoints.col(0).setZero();
+  Eigen::Matrix2Xd distorted_keypoints = keypoints;
+  for (int i = 0; i < kNumSamples; ++i) {
+    Eigen::Vector2d keypoint = keypoints.col(i);
+    this->distortion_->distort(&keypoint);
+    distorted_keypoints.col(i) = keypoint;
+  }
+
+  Eigen::Matrix2Xd undistorted_keypoints = distorted_keypoints;
+  this->distortion_->undistortVectorized(&undistorted_keypoints);
+  ASSERT_EQ(undistorted_keypoints.cols(), kNumSamples);
+  for (int i = 0; i < kNumSamples; ++i) {
+    Eigen::Vector2d keypoint = distorted_keypoints.col(i);
+    this->distortion_->undistort(&keypoint);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(undistorted_keypoints.col(i), keypoint, 1e-12));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(undistorted_keypoints.col(i), keypoints.col(i), 1e-5));
+  }
+
+  Eigen::Matrix2Xd no_keypoints(2, 0);
+  this->distortion_->undistortVectorized(&no_keypoints);
+  EXPECT_EQ(no_keypoints.cols(), 0);
+}
+
+TYPED_TEST(TestDistortions, UndistortVectorizedFloatMatchesDouble) {
+  const int kNumSamples = 1e4;
+  Eigen::Matrix2Xd keypoints = Eigen::Matrix2Xd::Random(2, kNumSamples);
+  keypoints.col(0).setZero();
+  Eigen::Matrix2Xd distorted_keypoints = keypoints;
+  for (int i = 0; i < kNumSamples; ++i) {
+    Eigen::Vector2d keypoint = keypoints.col(i);
+    this->distortion_->distort(&keypoint);
+    distorted_keypoints.col(i) = keypoint;
+  }
+
+  Eigen::Matrix2Xd undistorted_keypoints = distorted_keypoints;
+  this->distortion_->undistortVectorized(&undistorted_keypoints);
+  Eigen::Matrix2Xf undistorted_keypoints_float = distorted_keypoints.cast<float>();
+  this->distortion_->undistortVectorized(&undistorted_keypoints_float);
+  ASSERT_EQ(undistorted_keypoints_float.cols(), kNumSamples);
+  for (int i = 0; i < kNumSamples; ++i) {
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(undistorted_keypoints_float.col(i).cast<double>(),
+                                  undistorted_keypoints.col(i), 1e-5));
+  }
+}
+
 
 /// Wrapper that brings the distortion function to the form needed by the differentiator.
 struct Point3dJacobianFunctor : public aslam::common::NumDiffFunctor<2, 2> {
@@ -99,4 +99,69 @@ TEST(TestNCamera, testCloneRigWithoutDistortion) {
   }
 }
 
+TEST(TestNCamera, testGetVisibleLandmarks) {
+  aslam::NCamera::Ptr ncamera = aslam::createSurroundViewTestNCamera();
+  ASSERT_TRUE(ncamera.get() != nullptr);
+  const size_t num_cameras = ncamera->getNumCameras();
+
+  // Mask the left half of the first camera.
+  aslam::Camera& masked_camera = ncamera->getCameraMutable(0u);
+  cv::Mat mask = cv::Mat::ones(
+      cv::Size2i(masked_camera.imageWidth(), masked_camera.imageHeight()), CV_8UC1);
+  for (int row = 0; row < mask.rows; ++row) {
+    for (int col = 0; col < mask.cols / 2; ++col) {
+      mask.at<uint8_t>(row, col) = 0u;
+    }
+  }
+  masked_camera.setMask(mask);
+
+  aslam::Transformation T_G_B;
+  T_G_B.setRandom();
+  constexpr int kNumLandmarks = 5000;
+  const Eigen::Matrix3Xd G_landmarks =
+      10.0 * Eigen::Matrix3Xd::Random(3, kNumLandmarks) +
+      T_G_B.getPosition().replicate(1, kNumLandmarks);
+
+  std::vector<int> landmark_indices;
+  std::vector<int> camera_indices;
+  Eigen::Matrix2Xd keypoints;
+  ncamera->getVisibleLandmarks(
+      T_G_B, G_landmarks, &landmark_indices, &camera_indices, &keypoints);
+  ASSERT_EQ(landmark_indices.size(), camera_indices.size());
+  ASSERT_EQ(static_cast<int>(landmark_indices.size()), keypoints.cols());
+
+  // Compare with projecting every landmark into every camera.
+  int observation_idx = 0;
+  for (size_t camera_idx = 0u; camera_idx < num_cameras; ++camera_idx) {
+    const aslam::Camera& camera = ncamera->getCamera(camera_idx);
+    const aslam::Transformation T_C_G = ncamera->get_T_C_B(camera_idx) * T_G_B.inverse();
+    for (int landmark_idx = 0; landmark_idx < kNumLandmarks; ++landmark_idx) {
+      Eigen::Vector2d keypoint;
+      const aslam::ProjectionResult result = camera.project3(
+          T_C_G.transform(G_landmarks.col(landmark_idx)), &keypoint);
+      if (!result.isKeypointVisible() || camera.isMasked(keypoint)) {
+        continue;
+      }
+      ASSERT_LT(observation_idx, keypoints.cols());
+      EXPECT_EQ(camera_indices[observation_idx], static_cast<int>(camera_idx));
+      EXPECT_EQ(landmark_indices[observation_idx], landmark_idx);
+      EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoints.col(observation_idx), keypoint, 1e-9));
+      ++observation_idx;
+    }
+  }
+  EXPECT_EQ(observation_idx, keypoints.cols());
+  EXPECT_GT(observation_idx, 0);
+
+  // The result does not depend on the number of threads.
+  std::vector<int> landmark_indices_single_thread;
+  std::vector<int> camera_indices_single_thread;
+  Eigen::Matrix2Xd keypoints_single_thread;
+  ncamera->getVisibleLandmarks(
+      T_G_B, G_landmarks, &landmark_indices_single_thread, &camera_indices_single_thread,
+      &keypoints_single_thread, 1u);
+  EXPECT_EQ(landmark_indices, landmark_indices_single_thread);
+  EXPECT_EQ(camera_indices, camera_indices_single_thread);
+  EXPECT_TRUE(EIGEN_MATRIX_EQUAL(keypoints, keypoints_single_thread));
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,42 @@
+#ifndef ASLAM_COMMON_ANMS_H_
+#define ASLAM_COMMON_ANMS_H_
+
+#include <vector>
+
+#include <Eigen/Core>
+#include <opencv2/core/core.hpp>
+
+namespace aslam {
+namespace common {
+
+/// Adaptive non-maximal suppression (ANMS) selects a spatially uniform subset of the strongest
+/// keypoints.
+enum class AnmsMethod {
+  /// Finds the largest suppression radius for which a greedy pass in order of decreasing score
+  /// (a keypoint is kept if no kept keypoint is closer than the radius) still keeps the
+  /// requested number of keypoints. Binary search over the radius with a bucket grid,
+  /// O(n log n).
+  kRadius,
+  /// Keeps the strongest keypoint of every cell of a grid with about as many cells as
+  /// keypoints to select and fills up with the strongest remaining keypoints. O(n log n).
+  kGrid
+};
+
+/// \brief Selects num_keypoints_to_select keypoints spread over the image.
+/// \param[in] keypoints Keypoint coordinates (x, y) as columns.
+/// \param[in] scores Score of every keypoint, higher is better.
+/// \param[out] selected_indices Indices of the selected keypoints sorted by decreasing score.
+///             All keypoints if there are not more than num_keypoints_to_select.
+void selectKeypointsAnms(
+    const Eigen::Matrix2Xd& keypoints, const Eigen::VectorXd& scores,
+    size_t num_keypoints_to_select, AnmsMethod method, std::vector<size_t>* selected_indices);
+
+/// \brief Reduces the keypoints to the selected ones, using the keypoint response as score.
+///        Meant to run between keypoint detection and descriptor extraction.
+void selectKeypointsAnms(
+    size_t num_keypoints_to_select, AnmsMethod method, std::vector<cv::KeyPoint>* keypoints);
+
+}  // namespace common
+}  // namespace aslam
+
+#endif  // ASLAM_COMMON_ANMS_H_
@@ -23,15 +23,26 @@ const std::string NAME##_CHANNEL = #NAME;                                  \
 typedef GET_TYPE(TYPE) NAME##_ChannelValueType;                            \
 typedef Channel<NAME##_ChannelValueType> NAME##_ChannelType;               \
                                                                            \
-NAME##_ChannelValueType& get_##NAME##_Data(                                \
+const NAME##_ChannelValueType& get_##NAME##_Data(                          \
     const ChannelGroup& channel_group) {                                   \
-  std::lock_guard<std::mutex> lock(channel_group.m_channels_);             \
-  const ChannelMap& channels = channel_group.channels_;                    \
-  ChannelMap::const_iterator it = channels.find(NAME##_CHANNEL);           \
-  CHECK(it != channels.end()) << "Channelgroup does not "                  \
+  const ChannelBase* channel = channel_group.getChannel(NAME##_CHANNEL);   \
+  CHECK(channel != nullptr) << "Channelgroup does not "                    \
       "contain channel " << NAME##_CHANNEL;                                \
-  std::shared_ptr<NAME##_ChannelType> derived =                            \
-     std::dynamic_pointer_cast<NAME##_ChannelType>(it->second);            \
+  const NAME##_ChannelType* derived =                                      \
+     dynamic_cast<const NAME##_ChannelType*>(channel);                     \
+  CHECK(derived) << "Channel cast to derived failed " <<                   \
+     "channel: " << NAME##_CHANNEL;                                        \
+  return derived->value_;                                                  \
+}                                                                          \
+                                                                           \
+NAME##_ChannelValueType& get_##NAME##_DataMutable(                         \
+    ChannelGroup* channel_group) {                                         \
+  CHECK_NOTNULL(channel_group);                                            \
+  ChannelBase* channel = channel_group->getChannelMutable(NAME##_CHANNEL); \
+  CHECK(channel != nullptr) << "Channelgroup does not "                    \
+      "contain channel " << NAME##_CHANNEL;                                \
+  NAME##_ChannelType* derived =                                            \
+     dynamic_cast<NAME##_ChannelType*>(channel);                           \
   CHECK(derived) << "Channel cast to derived failed " <<                   \
      "channel: " << NAME##_CHANNEL;                                        \
   return derived->value_;                                                  \
@@ -40,28 +51,19 @@ NAME##_ChannelValueType& get_##NAME##_Data(                                \
 NAME##_ChannelValueType& add_##NAME##_Channel(                             \
     ChannelGroup* channel_group) {                                         \
   CHECK_NOTNULL(channel_group);                                            \
-  std::lock_guard<std::mutex> lock(channel_group->m_channels_);            \
-  ChannelMap* channels = &channel_group->channels_;                        \
-  ChannelMap::iterator it = channels->find(NAME##_CHANNEL);                \
-  CHECK(it == channels->end()) << "Channelgroup already "                  \
-      "contains channel " << NAME##_CHANNEL;                               \
   std::shared_ptr<NAME##_ChannelType> derived(new NAME##_ChannelType);     \
-  (*channels)[NAME##_CHANNEL] = derived;                                   \
+  CHECK(channel_group->addChannel(NAME##_CHANNEL, derived))                \
+      << "Channelgroup already contains channel " << NAME##_CHANNEL;       \
   return derived->value_;                                                  \
 }                                                                          \
                                                                            \
 bool has_##NAME##_Channel(const ChannelGroup& channel_group) {             \
-  std::lock_guard<std::mutex> lock(channel_group.m_channels_);             \
-  const ChannelMap& channels = channel_group.channels_;                    \
-  ChannelMap::const_iterator it = channels.find(NAME##_CHANNEL);           \
-  return it != channels.end();                                             \
+  return channel_group.hasChannel(NAME##_CHANNEL);                         \
 }                                                                          \
                                                                            \
 void remove_##NAME##_Channel(ChannelGroup* channel_group) {                \
   CHECK_NOTNULL(channel_group);                                            \
-  std::lock_guard<std::mutex> lock(channel_group->m_channels_);            \
-  ChannelMap& channels = channel_group->channels_;                         \
-  CHECK_EQ(channels.erase(NAME##_CHANNEL), 1u)                             \
+  CHECK(channel_group->removeChannel(NAME##_CHANNEL))                      \
     << "Channelgroup does not contain channel " << NAME##_CHANNEL;         \
 }                                                                          \
 }                                                                          \
@@ -72,16 +74,32 @@ void remove_##NAME##_Channel(ChannelGroup* channel_group) {                \
 
 namespace aslam {
 namespace channels {
+/// Returns the channel data for reading. Use getChannelDataMutable() for writing, as the data
+/// may be shared with other channel groups (copy-on-write).
 template<typename CHANNEL_DATA_TYPE>
-CHANNEL_DATA_TYPE& getChannelData(const std::string& channel_name,
-                                  const ChannelGroup& channel_group) {
-  std::lock_guard<std::mutex> lock(channel_group.m_channels_);
-  ChannelMap::const_iterator it = channel_group.channels_.find(channel_name);
-  CHECK(it != channel_group.channels_.end()) << "Channelgroup does not "
+const CHANNEL_DATA_TYPE& getChannelData(const std::string& channel_name,
+                                        const ChannelGroup& channel_group) {
+  const ChannelBase* channel = channel_group.getChannel(channel_name);
+  CHECK(channel != nullptr) << "Channelgroup does not "
       "contain channel " << channel_name;
   typedef Channel<CHANNEL_DATA_TYPE> DerivedChannel;
-  std::shared_ptr<DerivedChannel> derived =
-      std::dynamic_pointer_cast < DerivedChannel > (it->second);
+  const DerivedChannel* derived = dynamic_cast<const DerivedChannel*>(channel);
+  CHECK(derived) << "Channel cast to derived failed " <<
+                    "channel: " << channel_name;
+  return derived->value_;
+}
+
+/// Returns the channel data for writing. Detaches the channel first if its data is shared
+/// with another channel group (copy-on-write).
+template<typename CHANNEL_DATA_TYPE>
+CHANNEL_DATA_TYPE& getChannelDataMutable(const std::string& channel_name,
+                                         ChannelGroup* channel_group) {
+  CHECK_NOTNULL(channel_group);
+  ChannelBase* channel = channel_group->getChannelMutable(channel_name);
+  CHECK(channel != nullptr) << "Channelgroup does not "
+      "contain channel " << channel_name;
+  typedef Channel<CHANNEL_DATA_TYPE> DerivedChannel;
+  DerivedChannel* derived = dynamic_cast<DerivedChannel*>(channel);
   CHECK(derived) << "Channel cast to derived failed " <<
                     "channel: " << channel_name;
   return derived->value_;
@@ -89,22 +107,17 @@ CHANNEL_DATA_TYPE& getChannelData(const std::string& channel_name,
 
 inline bool hasChannel(const std::string& channel_name,
                        const ChannelGroup& channel_group) {
-  std::lock_guard<std::mutex> lock(channel_group.m_channels_);
-  ChannelMap::const_iterator it = channel_group.channels_.find(channel_name);
-  return it != channel_group.channels_.end();
+  return channel_group.hasChannel(channel_name);
 }
 
 template<typename CHANNEL_DATA_TYPE>
 CHANNEL_DATA_TYPE& addChannel(const std::string& channel_name,
                               ChannelGroup* channel_group) {
   CHECK_NOTNULL(channel_group);
-  std::lock_guard<std::mutex> lock(channel_group->m_channels_);
-  ChannelMap::iterator it = channel_group->channels_.find(channel_name);
-  CHECK(it == channel_group->channels_.end()) << "Channelgroup already "
-      "contains channel " << channel_name;
   typedef Channel<CHANNEL_DATA_TYPE> DerivedChannel;
   std::shared_ptr < DerivedChannel > derived(new DerivedChannel);
-  channel_group->channels_[channel_name] = derived;
+  CHECK(channel_group->addChannel(channel_name, derived)) << "Channelgroup already "
+      "contains channel " << channel_name;
   return derived->value_;
 }
 }  // namespace channels
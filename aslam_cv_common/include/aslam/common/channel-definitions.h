@@ -35,6 +35,10 @@ DECLARE_CHANNEL(TRACK_IDS, Eigen::VectorXi)
 /// The raw image.
 DECLARE_CHANNEL(RAW_IMAGE, cv::Mat)
 
+/// The encoded (e.g. png, jpeg) raw image as single-channel byte buffer.
+/// Decoded lazily on first access of the raw image.
+DECLARE_CHANNEL(RAW_IMAGE_COMPRESSED, cv::Mat)
+
 DECLARE_CHANNEL(CV_MAT, cv::Mat)
 
 #endif  // ASLAM_CV_COMMON_CHANNEL_DEFINITIONS_H_
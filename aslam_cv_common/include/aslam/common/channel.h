@@ -15,7 +15,11 @@
 /// @}
 /// @}
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <ostream>
 #include <string>
 #include <unordered_map>
 
@@ -120,34 +124,106 @@ bool Channel<TYPE>::operator==(const Channel<TYPE>& other) {
 }
 
 typedef std::unordered_map<std::string, std::shared_ptr<ChannelBase>> ChannelMap;
-struct ChannelGroup {
-  ChannelGroup() = default;
-  ChannelGroup(ChannelGroup& other) {
-    *this = other;
-  }
-  ChannelGroup& operator=(const ChannelGroup& other) {
-    channels_ = other.channels_;
-    return *this;
+
+namespace internal {
+/// \brief Marks the calling thread as reading a published channel map for its lifetime.
+///
+/// Entering and leaving increments and decrements a reader counter. The counters are spread
+/// over cache lines and every thread uses its own line, so readers of the same group do not
+/// contend and never wait. \ref waitForChannelMapReaders waits until all readers that may
+/// still see a superseded map have left.
+class ChannelMapReadSection {
+ public:
+  ChannelMapReadSection();
+  ~ChannelMapReadSection();
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(ChannelMapReadSection);
+
+ private:
+  std::atomic<uint32_t>* num_readers_;
+};
+
+/// Waits until no reader can still access a channel map that was unpublished before the call.
+void waitForChannelMapReaders();
+}  // namespace internal
+
+/// \class ChannelGroup
+/// \brief A set of named channels with a lock-free read path.
+///
+/// The channels are held in an immutable ChannelMap that is published through an atomic
+/// pointer. Lookups load that pointer inside a \ref internal::ChannelMapReadSection and never
+/// take a lock, so concurrent readers of the same group do not contend. Writers serialize on
+/// m_channels_, publish a modified copy of the map and free the previous map once all readers
+/// that may still traverse it have left.
+///
+/// Reading a channel while another thread writes the same channel, removes it or assigns to
+/// the group is not supported, just as with any other container.
+class ChannelGroup {
+ public:
+  ChannelGroup();
+  /// Shares the channels of other (copy-on-write).
+  ChannelGroup(const ChannelGroup& other);
+  explicit ChannelGroup(const ChannelMap& channels);
+  ~ChannelGroup();
+  /// Shares the channels of other (copy-on-write). Invalidates all references into this group.
+  ChannelGroup& operator=(const ChannelGroup& other);
+
+  /// Lock-free lookup of a channel for reading. Returns nullptr if the channel does not exist.
+  inline const ChannelBase* getChannel(const std::string& channel_name) const {
+    internal::ChannelMapReadSection read_section;
+    const ChannelMap* channels = channels_.load();
+    ChannelMap::const_iterator it = channels->find(channel_name);
+    return it == channels->end() ? nullptr : it->second.get();
   }
 
-  void printParameters(std::ostream& out) const {
-    std::lock_guard<std::mutex> lock(m_channels_);
-    if (!channels_.empty()) {
-      out << "  Channels:" << std::endl;
-      ChannelMap::const_iterator it = channels_.begin();
-      for (; it != channels_.end(); ++it) {
-        out << "   - " << it->first << std::endl;
-      }
-    } else {
-      out << "  Channels: empty" << std::endl;
-    }
+  /// Lock-free check whether the channel exists.
+  inline bool hasChannel(const std::string& channel_name) const {
+    return getChannel(channel_name) != nullptr;
   }
 
-  ChannelMap channels_;
+  /// Returns the channel for writing after detaching it from other groups sharing it.
+  /// Returns nullptr if the channel does not exist.
+  ChannelBase* getChannelMutable(const std::string& channel_name);
+
+  /// Adds the channel. Returns false if a channel with this name already exists.
+  bool addChannel(const std::string& channel_name, const std::shared_ptr<ChannelBase>& channel);
+
+  /// Removes the channel. Returns false if there is no channel with this name.
+  bool removeChannel(const std::string& channel_name);
+
+  /// Returns a copy of the channel map; the channels themselves are shared.
+  ChannelMap getChannels() const;
+
+  void printParameters(std::ostream& out) const;
+
+ private:
+  /// The published channel map. Must be called while holding m_channels_.
+  const ChannelMap& getChannelsLocked() const;
+
+  /// Replaces the published channel map and frees the previous one. Must be called while
+  /// holding m_channels_.
+  void publishLocked(std::unique_ptr<const ChannelMap> channels);
+
+  /// Whether the channel is also referenced by other channel groups. Must be called while
+  /// holding m_channels_: the channel can then only be shared further by copying this group,
+  /// which takes the same lock, so a channel found to be unique stays unique while it is
+  /// written.
+  static bool isChannelSharedLocked(const std::shared_ptr<ChannelBase>& channel);
+
+  /// Owned and never null. Every group owns its map and superseded maps are freed before the
+  /// writer returns, so the use count of a channel counts the groups sharing it.
+  std::atomic<const ChannelMap*> channels_;
   mutable std::mutex m_channels_;
 };
 
+/// Deep copy of all channels in the group.
 ChannelGroup cloneChannelGroup(const ChannelGroup& channels);
+
+/// Copy-on-write copy of the group: the returned group shares the channel data with the
+/// passed group until either of them requests mutable access to a channel, at which point
+/// that channel gets detached (cloned) by the mutating group. This makes copying a group
+/// O(#channels) instead of O(data).
+ChannelGroup shareChannelGroup(const ChannelGroup& channels);
+
 bool isChannelGroupEqual(const ChannelGroup& left, const ChannelGroup& right);
 
 }  // namespace channels
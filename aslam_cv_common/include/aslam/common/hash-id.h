@@ -8,6 +8,7 @@
 #include <iostream>
 #include <random>
 #include <mutex>
+#include <thread>
 
 namespace aslam {
 
@@ -121,17 +122,13 @@ class HashId {
   }
 
   /**
-   * Randomizes to ID seeded from the nanosecond time of the first
-   * call of this function
+   * Randomizes to ID. Every thread has its own generator, seeded independently
+   * on the first call of this function in that thread, so no lock is needed.
    */
   inline void randomize(){
-    static std::mt19937_64 rng(time64());
-    static std::mutex m_rng;
-    {
-      std::unique_lock<std::mutex> lock(m_rng);
-      val_.u64[0] = rng();
-      val_.u64[1] = rng();
-    }
+    static thread_local std::mt19937_64 rng(createThreadGenerator());
+    val_.u64[0] = rng();
+    val_.u64[1] = rng();
   }
 
   inline void operator =(const HashId& other) {
@@ -181,6 +178,24 @@ class HashId {
     return duration_cast<nanoseconds>(current).count();
   }
 
+  /**
+   * Generator for the calling thread. The seed mixes a hardware entropy source
+   * with the time and the thread id such that threads starting in the same
+   * nanosecond still get different sequences.
+   */
+  inline static std::mt19937_64 createThreadGenerator() {
+    std::random_device random_device;
+    const uint64_t time = static_cast<uint64_t>(time64());
+    const uint64_t thread_id =
+        std::hash<std::thread::id>()(std::this_thread::get_id());
+    std::seed_seq seed{
+        random_device(), random_device(), static_cast<unsigned int>(time),
+        static_cast<unsigned int>(time >> 32),
+        static_cast<unsigned int>(thread_id),
+        static_cast<unsigned int>(thread_id >> 32)};
+    return std::mt19937_64(seed);
+  }
+
   /**
    * Internal representation
    */
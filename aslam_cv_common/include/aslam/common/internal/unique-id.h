@@ -33,6 +33,8 @@ class UniqueIdHashSeed {
 };
 
 void generateUnique128BitHash(uint64_t hash[2]);
+// Fills hashes[2 * i] and hashes[2 * i + 1] for every i < num_hashes.
+void generateUnique128BitHashes(size_t num_hashes, uint64_t* hashes);
 }  // namespace internal
 }  // namespace aslam
 
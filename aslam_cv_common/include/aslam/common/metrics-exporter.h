@@ -0,0 +1,63 @@
+#ifndef ASLAM_COMMON_METRICS_EXPORTER_H_
+#define ASLAM_COMMON_METRICS_EXPORTER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>  // NOLINT
+#include <string>
+#include <thread>
+
+namespace aslam {
+
+/// \class MetricsExporter
+/// \brief Periodically snapshots all statistics::Statistics and timing::Timing values on a
+///        background thread and writes them to disk.
+///
+/// Each snapshot is written to a temporary file that is then renamed over the target, so a
+/// reader (e.g. a node-exporter textfile collector) never sees a partial file. The hot path
+/// is not stalled: timers are recorded lock-free and the statistics mutex is only taken
+/// per query.
+class MetricsExporter {
+ public:
+  /// \brief Starts the export thread.
+  ///
+  /// \param[in] interval Time between two snapshots.
+  /// \param[in] yaml_path File for the YAML snapshot, empty to disable.
+  /// \param[in] prometheus_path File for the Prometheus text-exposition snapshot, empty to
+  ///            disable.
+  MetricsExporter(const std::chrono::milliseconds& interval, const std::string& yaml_path,
+                  const std::string& prometheus_path);
+  /// Stops the export thread after writing a final snapshot.
+  ~MetricsExporter();
+
+  /// \brief Writes a final snapshot and joins the export thread. Called by the destructor.
+  void stop();
+
+  /// \brief Writes a snapshot from the calling thread. Returns false if a file could not be
+  ///        written.
+  bool exportNow() const;
+
+  /// \brief Writes all statistics and timers as YAML, the statistics under "statistics" and
+  ///        the timers under "timing".
+  static void writeYaml(std::ostream* out);
+  /// \brief Writes all statistics as summaries with p50, p95, p99 and p99.9 quantiles and
+  ///        all timers as summaries in seconds, in the Prometheus text-exposition format.
+  static void writePrometheus(std::ostream* out);
+
+ private:
+  void run();
+
+  const std::chrono::milliseconds interval_;
+  const std::string yaml_path_;
+  const std::string prometheus_path_;
+
+  bool stop_;
+  std::mutex mutex_;
+  std::condition_variable stop_requested_;
+  std::thread thread_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_COMMON_METRICS_EXPORTER_H_
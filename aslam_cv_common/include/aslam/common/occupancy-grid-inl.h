@@ -69,22 +69,28 @@ bool WeightedOccupancyGrid<PointType>::addPointOrReplaceWeakestIfCellFull(
 
   GridCoordinates grid_coordinates = inputToGridCoordinates(point.u_rows, point.v_cols);
   PointList& cell = getGridCell(grid_coordinates);
+  const size_t num_points_before = cell.size();
+  const bool is_in_cell = addToCellOrReplaceWeakest(point, max_points_per_cell, &cell);
+  current_num_points_ += cell.size() - num_points_before;
+  return is_in_cell;
+}
 
+template<typename PointType>
+bool WeightedOccupancyGrid<PointType>::addToCellOrReplaceWeakest(
+    const PointType& point, size_t max_points_per_cell, PointList* cell) {
+  CHECK_NOTNULL(cell);
   // Add point if the cell point count is below the minimum.
-  if (cell.size() < max_points_per_cell) {
-    cell.emplace_back(point);
-    ++current_num_points_;
+  if (cell->size() < max_points_per_cell) {
+    cell->emplace_back(point);
     return true;
   }
 
   // Replace the point with the lowest weight if the cell is full and the
   // added point has a higher weight.
-  if (cell.size() >= max_points_per_cell) {
-    typename PointList::iterator it_min_weight = std::min_element(cell.begin(), cell.end());
-    if (it_min_weight->weight < point.weight) {
-      *it_min_weight = point;
-      return true;
-    }
+  typename PointList::iterator it_min_weight = std::min_element(cell->begin(), cell->end());
+  if (it_min_weight->weight < point.weight) {
+    *it_min_weight = point;
+    return true;
   }
   return false;
 }
@@ -92,6 +98,12 @@ bool WeightedOccupancyGrid<PointType>::addPointOrReplaceWeakestIfCellFull(
 template<typename PointType>
 void WeightedOccupancyGrid<PointType>::addPointOrReplaceWeakestNearestPoints(
     const PointType& point_to_insert, CoordinatesType min_distance) {
+  current_num_points_ += addPointOrReplaceWeakestNearestPointsImpl(point_to_insert, min_distance);
+}
+
+template<typename PointType>
+int WeightedOccupancyGrid<PointType>::addPointOrReplaceWeakestNearestPointsImpl(
+    const PointType& point_to_insert, CoordinatesType min_distance) {
   CHECK_GT(min_distance, static_cast<CoordinatesType>(0.0));
   CHECK_LE(min_distance, static_cast<CoordinatesType>(std::min(cell_size_cols_, cell_size_rows_)))
     << "Distances are only checked in the closest neighboring cells, therefore the min. distance "
@@ -137,11 +149,11 @@ void WeightedOccupancyGrid<PointType>::addPointOrReplaceWeakestNearestPoints(
   // Add the point to the grid cell.
   PointList& input_cell = getGridCell(cell_input_point);
   input_cell.emplace_back(point_to_insert);
-  ++current_num_points_;
+  int num_points_change = 1;
 
   // Return if there are no distance violations to other points.
   if (distance_violating_points.empty()) {
-    return;
+    return num_points_change;
   }
 
   // Otherwise only keep the point with the highest score from the set
@@ -187,7 +199,151 @@ void WeightedOccupancyGrid<PointType>::addPointOrReplaceWeakestNearestPoints(
     PointList reduced_cell =
         aslam::common::eraseIndicesFromVector(cell, indices_to_remove_from_cell);
     cell.swap(reduced_cell);
-    current_num_points_ -= indices_to_remove_from_cell.size();
+    num_points_change -= static_cast<int>(indices_to_remove_from_cell.size());
+  }
+  return num_points_change;
+}
+
+template<typename PointType>
+constexpr size_t WeightedOccupancyGrid<PointType>::kMinNumPointsPerThread;
+
+template<typename PointType>
+size_t WeightedOccupancyGrid<PointType>::getNumThreadsForPoints(
+    size_t num_points, size_t num_threads) {
+  CHECK_GT(num_threads, 0u);
+  return std::max<size_t>(1u, std::min(num_threads, num_points / kMinNumPointsPerThread));
+}
+
+template<typename PointType>
+void WeightedOccupancyGrid<PointType>::sortPointsIntoCells(
+    const PointMatrix& points, size_t num_threads, std::vector<size_t>* cell_offsets,
+    std::vector<size_t>* sorted_point_indices) {
+  CHECK_NOTNULL(cell_offsets);
+  CHECK_NOTNULL(sorted_point_indices);
+  const size_t num_points = static_cast<size_t>(points.cols());
+  const size_t num_cells = num_grid_rows_ * num_grid_cols_;
+  num_threads = std::max<size_t>(1u, std::min(num_threads, num_points));
+
+  // Counting pass: every thread counts the points per cell of its block of points.
+  std::vector<size_t> point_cell_index(num_points);
+  std::vector<std::vector<size_t>> block_cell_counts(num_threads);
+  std::vector<size_t> block_begin(num_threads + 1u, num_points);
+  parallelProcess(num_threads, num_threads, [&](size_t begin, size_t end) {
+    for (size_t block_idx = begin; block_idx < end; ++block_idx) {
+      const size_t point_begin = num_points * block_idx / num_threads;
+      const size_t point_end = num_points * (block_idx + 1u) / num_threads;
+      block_begin[block_idx] = point_begin;
+      std::vector<size_t>& cell_counts = block_cell_counts[block_idx];
+      cell_counts.assign(num_cells, 0u);
+      for (size_t point_idx = point_begin; point_idx < point_end; ++point_idx) {
+        const GridCoordinates grid_coordinates =
+            inputToGridCoordinates(points(0, point_idx), points(1, point_idx));
+        const size_t cell_index =
+            grid_coordinates.i_rows * num_grid_cols_ + grid_coordinates.j_cols;
+        point_cell_index[point_idx] = cell_index;
+        ++cell_counts[cell_index];
+      }
+    }
+  });
+
+  // Prefix sum over cells and blocks, afterwards block_cell_counts holds the position of the
+  // first point of every block in every cell.
+  cell_offsets->assign(num_cells + 1u, 0u);
+  size_t offset = 0u;
+  for (size_t cell_index = 0u; cell_index < num_cells; ++cell_index) {
+    (*cell_offsets)[cell_index] = offset;
+    for (std::vector<size_t>& cell_counts : block_cell_counts) {
+      const size_t count = cell_counts[cell_index];
+      cell_counts[cell_index] = offset;
+      offset += count;
+    }
+  }
+  (*cell_offsets)[num_cells] = offset;
+  CHECK_EQ(offset, num_points);
+
+  // Scatter pass.
+  sorted_point_indices->resize(num_points);
+  parallelProcess(num_threads, num_threads, [&](size_t begin, size_t end) {
+    for (size_t block_idx = begin; block_idx < end; ++block_idx) {
+      std::vector<size_t>& cell_positions = block_cell_counts[block_idx];
+      for (size_t point_idx = block_begin[block_idx]; point_idx < block_begin[block_idx + 1u];
+           ++point_idx) {
+        (*sorted_point_indices)[cell_positions[point_cell_index[point_idx]]++] = point_idx;
+      }
+    }
+  });
+}
+
+template<typename PointType>
+void WeightedOccupancyGrid<PointType>::addPointsOrReplaceWeakestIfCellFull(
+    const PointMatrix& points, const WeightVector& weights, size_t max_points_per_cell,
+    size_t num_threads) {
+  CHECK_EQ(points.cols(), weights.rows());
+  CHECK_GT(max_points_per_cell, 0u);
+  num_threads = getNumThreadsForPoints(static_cast<size_t>(points.cols()), num_threads);
+  std::vector<size_t> cell_offsets;
+  std::vector<size_t> sorted_point_indices;
+  sortPointsIntoCells(points, num_threads, &cell_offsets, &sorted_point_indices);
+
+  // The policy only looks at the cell of the point, so the cells are independent.
+  const size_t num_cells = num_grid_rows_ * num_grid_cols_;
+  std::vector<size_t> num_added_points(num_cells, 0u);
+  parallelProcess(num_cells, num_threads, [&](size_t begin, size_t end) {
+    for (size_t cell_index = begin; cell_index < end; ++cell_index) {
+      PointList& cell = grid_[cell_index / num_grid_cols_][cell_index % num_grid_cols_];
+      const size_t num_points_before = cell.size();
+      for (size_t i = cell_offsets[cell_index]; i < cell_offsets[cell_index + 1u]; ++i) {
+        const size_t point_idx = sorted_point_indices[i];
+        addToCellOrReplaceWeakest(
+            PointType(points(0, point_idx), points(1, point_idx), weights(point_idx),
+                      static_cast<PointId>(point_idx)),
+            max_points_per_cell, &cell);
+      }
+      num_added_points[cell_index] = cell.size() - num_points_before;
+    }
+  });
+  for (const size_t num_added : num_added_points) {
+    current_num_points_ += num_added;
+  }
+}
+
+template<typename PointType>
+void WeightedOccupancyGrid<PointType>::addPointsOrReplaceWeakestNearestPoints(
+    const PointMatrix& points, const WeightVector& weights, CoordinatesType min_distance,
+    size_t num_threads) {
+  CHECK_EQ(points.cols(), weights.rows());
+  num_threads = getNumThreadsForPoints(static_cast<size_t>(points.cols()), num_threads);
+  std::vector<size_t> cell_offsets;
+  std::vector<size_t> sorted_point_indices;
+  sortPointsIntoCells(points, num_threads, &cell_offsets, &sorted_point_indices);
+
+  // Inserting a point modifies its cell and the direct neighbors. Cells whose row and column
+  // indices agree modulo 3 are at least 3 cells apart, so their neighborhoods are disjoint.
+  constexpr size_t kPassStride = 3u;
+  for (size_t pass_row = 0u; pass_row < kPassStride; ++pass_row) {
+    for (size_t pass_col = 0u; pass_col < kPassStride; ++pass_col) {
+      const size_t num_pass_rows = (num_grid_rows_ + kPassStride - 1u - pass_row) / kPassStride;
+      const size_t num_pass_cols = (num_grid_cols_ + kPassStride - 1u - pass_col) / kPassStride;
+      const size_t num_pass_cells = num_pass_rows * num_pass_cols;
+      std::vector<int> num_points_change(num_pass_cells, 0);
+      parallelProcess(num_pass_cells, num_threads, [&](size_t begin, size_t end) {
+        for (size_t pass_cell = begin; pass_cell < end; ++pass_cell) {
+          const size_t i_row = pass_row + kPassStride * (pass_cell / num_pass_cols);
+          const size_t j_col = pass_col + kPassStride * (pass_cell % num_pass_cols);
+          const size_t cell_index = i_row * num_grid_cols_ + j_col;
+          for (size_t i = cell_offsets[cell_index]; i < cell_offsets[cell_index + 1u]; ++i) {
+            const size_t point_idx = sorted_point_indices[i];
+            num_points_change[pass_cell] += addPointOrReplaceWeakestNearestPointsImpl(
+                PointType(points(0, point_idx), points(1, point_idx), weights(point_idx),
+                          static_cast<PointId>(point_idx)),
+                min_distance);
+          }
+        }
+      });
+      for (const int change : num_points_change) {
+        current_num_points_ += change;
+      }
+    }
   }
 }
 
@@ -392,6 +548,142 @@ WeightedOccupancyGrid<PointType>::inputToGridCoordinates(
   return grid_coordinates;
 }
 
+template<typename PointType>
+FixedCapacityOccupancyGrid<PointType>::FixedCapacityOccupancyGrid(
+    CoordinatesType max_input_coordinate_rows,
+    CoordinatesType max_input_coordinate_cols,
+    CoordinatesType cell_size_rows, CoordinatesType cell_size_cols,
+    size_t max_points_per_cell)
+ : max_input_coordinate_rows_(max_input_coordinate_rows),
+   max_input_coordinate_cols_(max_input_coordinate_cols),
+   cell_size_rows_(cell_size_rows),
+   cell_size_cols_(cell_size_cols),
+   max_points_per_cell_(max_points_per_cell),
+   current_num_points_(0u) {
+  CHECK_GT(max_input_coordinate_rows, static_cast<CoordinatesType>(0.0));
+  CHECK_GT(max_input_coordinate_cols, static_cast<CoordinatesType>(0.0));
+  CHECK_GE(max_input_coordinate_rows, cell_size_rows);
+  CHECK_GE(max_input_coordinate_cols, cell_size_cols);
+  CHECK_GT(max_points_per_cell, 0u);
+
+  num_grid_rows_ = static_cast<size_t>(std::ceil(
+      static_cast<double>(max_input_coordinate_rows) / cell_size_rows_));
+  num_grid_cols_ = static_cast<size_t>(std::ceil(
+      static_cast<double>(max_input_coordinate_cols) / cell_size_cols_));
+  CHECK_GT(num_grid_rows_, 0u);
+  CHECK_GT(num_grid_cols_, 0u);
+
+  const size_t num_cells = num_grid_rows_ * num_grid_cols_;
+  points_.assign(num_cells * max_points_per_cell_,
+                 PointType(static_cast<CoordinatesType>(0.0), static_cast<CoordinatesType>(0.0),
+                           static_cast<WeightType>(0.0), PointId()));
+  num_points_in_cell_.assign(num_cells, 0u);
+}
+
+template<typename PointType>
+void FixedCapacityOccupancyGrid<PointType>::reset() {
+  std::fill(num_points_in_cell_.begin(), num_points_in_cell_.end(), 0u);
+  current_num_points_ = 0u;
+}
+
+template<typename PointType>
+bool FixedCapacityOccupancyGrid<PointType>::addPointOrReplaceWeakestIfCellFull(
+    const PointType& point) {
+  const size_t cell_index = inputToCellIndex(point.u_rows, point.v_cols);
+  PointType* cell_begin = &points_[cell_index * max_points_per_cell_];
+  size_t& num_points_in_cell = num_points_in_cell_[cell_index];
+
+  if (num_points_in_cell < max_points_per_cell_) {
+    cell_begin[num_points_in_cell] = point;
+    ++num_points_in_cell;
+    ++current_num_points_;
+    return true;
+  }
+
+  // Replace the point with the lowest weight if the added point has a higher weight.
+  PointType* it_min_weight = std::min_element(cell_begin, cell_begin + num_points_in_cell);
+  if (it_min_weight->weight < point.weight) {
+    *it_min_weight = point;
+    return true;
+  }
+  return false;
+}
+
+template<typename PointType>
+size_t FixedCapacityOccupancyGrid<PointType>::getNumPoints() const {
+  return current_num_points_;
+}
+
+template<typename PointType>
+size_t FixedCapacityOccupancyGrid<PointType>::getAllPointsInGrid(PointList* points) const {
+  CHECK_NOTNULL(points)->clear();
+  points->reserve(current_num_points_);
+  for (size_t cell_index = 0u; cell_index < num_points_in_cell_.size(); ++cell_index) {
+    const typename PointList::const_iterator cell_begin =
+        points_.begin() + cell_index * max_points_per_cell_;
+    points->insert(points->end(), cell_begin, cell_begin + num_points_in_cell_[cell_index]);
+  }
+  CHECK_EQ(points->size(), current_num_points_);
+  return points->size();
+}
+
+template<typename PointType>
+inline typename FixedCapacityOccupancyGrid<PointType>::CellView
+FixedCapacityOccupancyGrid<PointType>::getGridCell(
+    CoordinatesType u_rows, CoordinatesType v_cols) const {
+  const size_t cell_index = inputToCellIndex(u_rows, v_cols);
+  return getGridCell(cell_index / num_grid_cols_, cell_index % num_grid_cols_);
+}
+
+template<typename PointType>
+inline typename FixedCapacityOccupancyGrid<PointType>::CellView
+FixedCapacityOccupancyGrid<PointType>::getGridCell(size_t i_rows, size_t j_cols) const {
+  CHECK_LT(i_rows, num_grid_rows_);
+  CHECK_LT(j_cols, num_grid_cols_);
+  const size_t cell_index = i_rows * num_grid_cols_ + j_cols;
+  const PointType* cell_begin = points_.data() + cell_index * max_points_per_cell_;
+  return CellView(cell_begin, cell_begin + num_points_in_cell_[cell_index]);
+}
+
+template<typename PointType>
+void FixedCapacityOccupancyGrid<PointType>::removePointsFromFullestCellsUntilSize(
+    size_t max_total_num_points) {
+  CHECK_GT(max_total_num_points, 0u);
+  while (current_num_points_ > max_total_num_points) {
+    const size_t fullest_cell_index = static_cast<size_t>(
+        std::max_element(num_points_in_cell_.begin(), num_points_in_cell_.end()) -
+        num_points_in_cell_.begin());
+    PointType* cell_begin = &points_[fullest_cell_index * max_points_per_cell_];
+    size_t& num_points_in_cell = num_points_in_cell_[fullest_cell_index];
+    CHECK_GT(num_points_in_cell, 0u);
+
+    // Move the last point of the cell onto the weakest point.
+    PointType* it_min_weight = std::min_element(cell_begin, cell_begin + num_points_in_cell);
+    *it_min_weight = cell_begin[num_points_in_cell - 1u];
+    --num_points_in_cell;
+    --current_num_points_;
+  }
+}
+
+template<typename PointType>
+inline size_t FixedCapacityOccupancyGrid<PointType>::inputToCellIndex(
+    CoordinatesType u_rows, CoordinatesType v_cols) const {
+  CHECK(isValidInputCoordinate(u_rows, v_cols))
+      << "u_rows: " << u_rows << ", v_cols: " << v_cols;
+  const size_t grid_row = static_cast<size_t>(std::floor(u_rows / cell_size_rows_));
+  const size_t grid_col = static_cast<size_t>(std::floor(v_cols / cell_size_cols_));
+  return grid_row * num_grid_cols_ + grid_col;
+}
+
+template<typename PointType>
+inline bool FixedCapacityOccupancyGrid<PointType>::isValidInputCoordinate(
+    CoordinatesType u_rows, CoordinatesType v_cols) const {
+  return (u_rows >= static_cast<CoordinatesType>(0.0)) &&
+         (v_cols >= static_cast<CoordinatesType>(0.0)) &&
+         (u_rows < max_input_coordinate_rows_) &&
+         (v_cols < max_input_coordinate_cols_);
+}
+
 }  // namespace common
 }  // namespace aslam
 
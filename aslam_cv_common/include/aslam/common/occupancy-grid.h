@@ -4,6 +4,7 @@
 #include <vector>
 
 #include <aslam/common/macros.h>
+#include <aslam/common/parallel-process.h>
 #include <Eigen/Dense>
 #include <glog/logging.h>
 #include <opencv2/core/core.hpp>
@@ -82,8 +83,50 @@ class WeightedOccupancyGrid {
   /// Add point to the grid and replace other points if they are closer than the specified min.
   /// distance and this point has a higher score.
   void addPointOrReplaceWeakestNearestPoints(const PointType& point, CoordinatesType min_distance);
+
+  typedef Eigen::Matrix<CoordinatesType, 2, Eigen::Dynamic> PointMatrix;
+  typedef Eigen::Matrix<WeightType, Eigen::Dynamic, 1> WeightVector;
+
+  /// Bulk version of addPointOrReplaceWeakestIfCellFull. The points are (u_rows, v_cols)
+  /// columns and get their column index as id. They are sorted into cells in parallel and then
+  /// inserted cell by cell across threads; the result is the same as inserting the points one
+  /// by one in column order.
+  void addPointsOrReplaceWeakestIfCellFull(
+      const PointMatrix& points, const WeightVector& weights, size_t max_points_per_cell,
+      size_t num_threads = getNumHardwareThreads());
+
+  /// Bulk version of addPointOrReplaceWeakestNearestPoints, see
+  /// addPointsOrReplaceWeakestIfCellFull. Cells only interact with their direct neighbors, so
+  /// the cells are processed in nine interleaved passes in which no two cells of a pass are
+  /// neighbors. The result equals the sequential insertion ordered by pass, cell and column
+  /// and does not depend on the number of threads.
+  void addPointsOrReplaceWeakestNearestPoints(
+      const PointMatrix& points, const WeightVector& weights, CoordinatesType min_distance,
+      size_t num_threads = getNumHardwareThreads());
   /// @}
 
+ private:
+  /// Smaller bulk inserts are processed on the calling thread only.
+  static constexpr size_t kMinNumPointsPerThread = 1024u;
+
+  /// Returns the number of threads worth using for a bulk insert of num_points points.
+  static size_t getNumThreadsForPoints(size_t num_points, size_t num_threads);
+
+  /// Sorts the point indices by cell (stable), the points of cell (i_rows, j_cols) are
+  /// sorted_point_indices[cell_offsets[k]] to sorted_point_indices[cell_offsets[k + 1] - 1]
+  /// with k = i_rows * num_grid_cols_ + j_cols.
+  void sortPointsIntoCells(
+      const PointMatrix& points, size_t num_threads, std::vector<size_t>* cell_offsets,
+      std::vector<size_t>* sorted_point_indices);
+
+  /// Returns true if the point was added to the cell.
+  static bool addToCellOrReplaceWeakest(
+      const PointType& point, size_t max_points_per_cell, PointList* cell);
+
+  /// Returns the change of the number of points in the grid.
+  int addPointOrReplaceWeakestNearestPointsImpl(
+      const PointType& point, CoordinatesType min_distance);
+
   //////////////////////////////////////////////////////////////
   /// \name Methods to query the grid.
   /// @{
@@ -144,6 +187,86 @@ class WeightedOccupancyGrid {
   std::vector<std::vector<PointList>> grid_;
 };
 
+/// Occupancy grid with a fixed number of points per cell. All cells live in one flat array, so
+/// inserting points and resetting the grid never allocate and the points of a cell are
+/// contiguous in memory. Use this grid for keypoint bucketing with a cap per cell; the
+/// WeightedOccupancyGrid is needed for cells of unbounded size or for min. distance
+/// replacements. PointType has to be constructible from (u_rows, v_cols, weight, id).
+template<typename PointType = WeightedKeypoint<double, double, int>>
+class FixedCapacityOccupancyGrid {
+ public:
+  typedef typename PointType::coordinate_type CoordinatesType;
+  typedef typename PointType::weight_type WeightType;
+  typedef typename PointType::id_type PointId;
+
+  typedef PointType Point;
+  typedef std::vector<PointType> PointList;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  ASLAM_POINTER_TYPEDEFS(FixedCapacityOccupancyGrid);
+
+  /// Read-only view on the points of one cell.
+  class CellView {
+   public:
+    CellView(const PointType* begin, const PointType* end) : begin_(begin), end_(end) {}
+    const PointType* begin() const { return begin_; }
+    const PointType* end() const { return end_; }
+    size_t size() const { return static_cast<size_t>(end_ - begin_); }
+    bool empty() const { return begin_ == end_; }
+    const PointType& operator[](size_t index) const { return begin_[index]; }
+   private:
+    const PointType* begin_;
+    const PointType* end_;
+  };
+
+  FixedCapacityOccupancyGrid(CoordinatesType max_input_coordinate_rows,
+                             CoordinatesType max_input_coordinate_cols,
+                             CoordinatesType cell_size_rows,
+                             CoordinatesType cell_size_cols,
+                             size_t max_points_per_cell);
+
+  /// Removes all points, keeps the memory.
+  void reset();
+
+  /// Add a point to the grid and replace the weakest point in the same cell if the cell is
+  /// full and this point has a higher score.
+  bool addPointOrReplaceWeakestIfCellFull(const PointType& point);
+
+  size_t getNumPoints() const;
+  size_t getMaxPointsPerCell() const { return max_points_per_cell_; }
+  size_t getNumGridRows() const { return num_grid_rows_; }
+  size_t getNumGridCols() const { return num_grid_cols_; }
+  size_t getAllPointsInGrid(PointList* points) const;
+
+  inline CellView getGridCell(CoordinatesType u_rows, CoordinatesType v_cols) const;
+  inline CellView getGridCell(size_t i_rows, size_t j_cols) const;
+
+  /// Remove the weakest point from the fullest cells until the total number of
+  /// points in the grid is met.
+  void removePointsFromFullestCellsUntilSize(size_t max_total_num_points);
+
+ private:
+  inline size_t inputToCellIndex(CoordinatesType u_rows, CoordinatesType v_cols) const;
+  inline bool isValidInputCoordinate(CoordinatesType u_rows, CoordinatesType v_cols) const;
+
+  /// Grid size definitions.
+  const CoordinatesType max_input_coordinate_rows_;
+  const CoordinatesType max_input_coordinate_cols_;
+  const CoordinatesType cell_size_rows_;
+  const CoordinatesType cell_size_cols_;
+  const size_t max_points_per_cell_;
+
+  size_t num_grid_rows_;
+  size_t num_grid_cols_;
+  size_t current_num_points_;
+
+  /// Cell (i_rows, j_cols) owns the points [cell_index * max_points_per_cell_,
+  /// cell_index * max_points_per_cell_ + num_points_in_cell_[cell_index]) with
+  /// cell_index = i_rows * num_grid_cols_ + j_cols.
+  PointList points_;
+  std::vector<size_t> num_points_in_cell_;
+};
+
 }  // namespace common
 }  // namespace aslam
 #include "./occupancy-grid-inl.h"
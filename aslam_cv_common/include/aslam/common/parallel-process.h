@@ -0,0 +1,110 @@
+#ifndef ASLAM_COMMON_PARALLEL_PROCESS_H_
+#define ASLAM_COMMON_PARALLEL_PROCESS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <glog/logging.h>
+
+#include <aslam/common/thread-pool.h>
+
+namespace aslam {
+namespace common {
+
+/// Returns the number of threads to use if the caller does not specify one.
+inline size_t getNumHardwareThreads() {
+  return std::max<size_t>(1u, std::thread::hardware_concurrency());
+}
+
+/// Returns the thread pool that runs the blocks of parallelProcess. The pool is created on
+/// first use with one worker less than getNumHardwareThreads(), the calling thread of
+/// parallelProcess is the remaining one.
+ThreadPool& getParallelProcessThreadPool();
+
+namespace internal {
+// Bookkeeping of one parallelProcess call. Owned by shared pointers because a pool task may
+// only start after all blocks have been processed and the call returned.
+struct ParallelProcessBlocks {
+  explicit ParallelProcessBlocks(size_t _num_blocks)
+      : num_blocks(_num_blocks), next_block(0u), num_finished_blocks(0u) {}
+  const size_t num_blocks;
+  std::atomic<size_t> next_block;
+  size_t num_finished_blocks;
+  std::mutex mutex;
+  std::condition_variable all_blocks_finished;
+};
+
+// Processes blocks until all blocks have been claimed. The functor is only accessed for a
+// claimed block, and the caller of parallelProcess waits for all claimed blocks to finish.
+template <typename Functor>
+void processParallelBlocks(
+    size_t num_items, const Functor& functor, ParallelProcessBlocks* blocks) {
+  CHECK_NOTNULL(blocks);
+  size_t num_processed_blocks = 0u;
+  for (size_t block_idx = blocks->next_block.fetch_add(1u);
+       block_idx < blocks->num_blocks; block_idx = blocks->next_block.fetch_add(1u)) {
+    functor(num_items * block_idx / blocks->num_blocks,
+            num_items * (block_idx + 1u) / blocks->num_blocks);
+    ++num_processed_blocks;
+  }
+  if (num_processed_blocks > 0u) {
+    std::lock_guard<std::mutex> lock(blocks->mutex);
+    blocks->num_finished_blocks += num_processed_blocks;
+    if (blocks->num_finished_blocks == blocks->num_blocks) {
+      blocks->all_blocks_finished.notify_all();
+    }
+  }
+}
+}  // namespace internal
+
+/// \brief Splits the items [0, num_items) into contiguous blocks and calls
+///        functor(block_begin, block_end) for every block, distributed over the calling
+///        thread and the shared thread pool.
+///
+/// The calling thread processes blocks as well and only waits for blocks that are already
+/// running on other threads, so nested calls can not deadlock. With a single block the
+/// functor is called inline for the whole range.
+/// \param[in] num_items Number of items to process.
+/// \param[in] num_threads Maximal number of threads.
+/// \param[in] functor Callable with the signature void(size_t begin, size_t end).
+/// \param[in] min_items_per_block Smallest number of items that is worth handing to another
+///            thread. Fewer items are processed serially.
+template <typename Functor>
+void parallelProcess(
+    size_t num_items, size_t num_threads, const Functor& functor,
+    size_t min_items_per_block = 1u) {
+  CHECK_GT(num_threads, 0u);
+  CHECK_GT(min_items_per_block, 0u);
+  if (num_items == 0u) {
+    return;
+  }
+  const size_t num_blocks = std::max<size_t>(
+      1u, std::min(num_threads, num_items / min_items_per_block));
+  if (num_blocks == 1u) {
+    functor(0u, num_items);
+    return;
+  }
+
+  std::shared_ptr<internal::ParallelProcessBlocks> blocks =
+      std::make_shared<internal::ParallelProcessBlocks>(num_blocks);
+  ThreadPool& thread_pool = getParallelProcessThreadPool();
+  for (size_t block_idx = 1u; block_idx < num_blocks; ++block_idx) {
+    thread_pool.enqueue([blocks, num_items, &functor]() {
+      internal::processParallelBlocks(num_items, functor, blocks.get());
+    });
+  }
+  internal::processParallelBlocks(num_items, functor, blocks.get());
+
+  std::unique_lock<std::mutex> lock(blocks->mutex);
+  blocks->all_blocks_finished.wait(
+      lock, [&blocks]() { return blocks->num_finished_blocks == blocks->num_blocks; });
+}
+
+}  // namespace common
+}  // namespace aslam
+
+#endif  // ASLAM_COMMON_PARALLEL_PROCESS_H_
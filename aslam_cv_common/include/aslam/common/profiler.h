@@ -0,0 +1,90 @@
+#ifndef ASLAM_COMMON_PROFILER_H_
+#define ASLAM_COMMON_PROFILER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>  // NOLINT
+#include <string>
+
+#include <aslam/common/timer.h>
+
+///
+// Hierarchical profiling with nested scopes. Every thread builds its own call tree of the
+// scopes it entered and records one trace event per scope which can be exported in the
+// Chrome trace-event format (chrome://tracing, Perfetto).
+//
+// timing::Profiler::SetEnabled(true);
+// {
+//   static const size_t kProfileHandle = timing::ScopedProfile::RegisterTag("outer");
+//   timing::ScopedProfile outer(kProfileHandle);
+//   {
+//     timing::ScopedProfile inner("inner");
+//     doSomething();
+//   }
+// }
+// timing::Profiler::PrintCallTree(std::cout);
+// timing::Profiler::WriteChromeTrace("/tmp/trace.json");
+///
+
+namespace timing {
+
+/// Times the enclosing scope and records it in the call tree of the calling thread. The
+/// duration is also added to the flat timer of the same tag. Does nothing if profiling is
+/// disabled at construction.
+class ScopedProfile {
+ public:
+  explicit ScopedProfile(size_t handle);
+  explicit ScopedProfile(const std::string& tag);
+  ~ScopedProfile();
+
+  /// Returns the handle of the tag, shared with timing::Timer.
+  static size_t RegisterTag(const std::string& tag) {
+    return Timing::GetHandle(tag);
+  }
+
+ private:
+  ScopedProfile(const ScopedProfile&) = delete;
+  ScopedProfile& operator=(const ScopedProfile&) = delete;
+
+  size_t handle_;
+  bool is_active_;
+  std::chrono::time_point<std::chrono::steady_clock> begin_;
+};
+
+class Profiler {
+ public:
+  /// Profiling is disabled by default. Scopes that were entered while profiling was
+  /// enabled are always closed.
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled();
+
+  /// Names the calling thread in the exported trace. Does not register the thread, a
+  /// thread is only added to the profiler when it enters its first profiled scope.
+  static void SetThreadName(const std::string& name);
+
+  /// Prints the call tree of every thread with the number of calls and the total, mean
+  /// and self time of each scope.
+  static void PrintCallTree(std::ostream& out);  // NOLINT
+  static std::string PrintCallTree();
+
+  /// Writes all recorded scopes as complete ("X") events of the Chrome trace-event
+  /// format. Timestamps are in microseconds since the profiler was first used. Returns
+  /// false if the file could not be written.
+  static bool WriteChromeTrace(const std::string& path);
+  static void WriteChromeTrace(std::ostream& out);  // NOLINT
+
+  /// Clears the call trees and trace events of all threads and drops the profiles of
+  /// threads that have exited. Must not be called while scopes are open.
+  static void Reset();
+
+ private:
+  friend class ScopedProfile;
+  static void EnterScope(size_t handle);
+  static void LeaveScope(
+      size_t handle, const std::chrono::time_point<std::chrono::steady_clock>& begin,
+      const std::chrono::time_point<std::chrono::steady_clock>& end);
+};
+
+}  // namespace timing
+
+#endif  // ASLAM_COMMON_PROFILER_H_
@@ -0,0 +1,58 @@
+#ifndef ASLAM_COMMON_SCALABLE_READER_WRITER_LOCK_H_
+#define ASLAM_COMMON_SCALABLE_READER_WRITER_LOCK_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "aslam/common/reader-writer-lock.h"
+
+namespace aslam {
+
+// Reader-writer mutex with a distributed reader indicator: every thread counts its read locks
+// in one of kNumReaderSlots counters on separate cache lines, so uncontended readers on
+// different cores do not share any written cache line. Writers block new readers through a
+// flag and wait for the sum of the counters to drop to zero. Like ReaderWriterMutex, pending
+// writers and upgrades take precedence over new readers.
+// Costs kNumReaderSlots cache lines per mutex and makes acquiring the write lock linear in
+// kNumReaderSlots, so it pays off for read-mostly data shared by many threads.
+class ScalableReaderWriterMutex : public ReaderWriterMutex {
+ public:
+  static constexpr size_t kNumReaderSlots = 64u;
+
+  ScalableReaderWriterMutex();
+  virtual ~ScalableReaderWriterMutex();
+
+  virtual void acquireReadLock() override;
+  virtual void releaseReadLock() override;
+
+  virtual void acquireWriteLock() override;
+  virtual void releaseWriteLock() override;
+
+  virtual bool upgradeToWriteLock() override;
+
+  virtual bool isInUse() override;
+
+ private:
+  struct alignas(64) ReaderSlot {
+    ReaderSlot() : num_readers(0) {}
+    // Signed because a read lock may be released on another thread than the one that
+    // acquired it, only the sum over all slots is meaningful.
+    std::atomic<int64_t> num_readers;
+  };
+
+  static size_t getReaderSlotIndex();
+  // Must be called with mutex_ held to be consistent with readers_blocked_.
+  int64_t getNumReaders() const;
+  // Wakes up writers and upgrades waiting for the readers to drain.
+  void notifyWaitingWriters();
+  void updateReadersBlocked();
+
+  std::array<ReaderSlot, kNumReaderSlots> reader_slots_;
+  // Set while a writer holds the lock or waits for it, or an upgrade is pending.
+  std::atomic<bool> readers_blocked_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_COMMON_SCALABLE_READER_WRITER_LOCK_H_
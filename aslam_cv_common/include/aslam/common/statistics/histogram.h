@@ -0,0 +1,170 @@
+#ifndef ASLAM_STATISTICS_HISTOGRAM_H_
+#define ASLAM_STATISTICS_HISTOGRAM_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+
+#include <glog/logging.h>
+
+namespace statistics {
+
+// A histogram with logarithmically spaced buckets (HDR-style): every power of two is split
+// into kNumSubBucketsPerOctave linear buckets, so the relative error of a reported
+// percentile is bounded by 1 / (2 * kNumSubBucketsPerOctave) independent of the magnitude
+// of the samples. The buckets are allocated per octave and sign, only for octaves that hold
+// samples, and zero has a counter of its own. Magnitudes below 2^kMinExponent are counted
+// as zero, magnitudes above 2^kMaxExponent fall into the outermost buckets; the exact min
+// and max are tracked separately.
+class LogHistogram {
+ public:
+  static constexpr int kNumSubBucketsPerOctave = 128;
+  static constexpr int kMinExponent = -64;
+  static constexpr int kMaxExponent = 64;
+
+  LogHistogram()
+      : zero_count_(0u),
+        total_count_(0u),
+        min_(std::numeric_limits<double>::max()),
+        max_(std::numeric_limits<double>::lowest()) {}
+
+  void Add(double sample) {
+    int exponent;
+    int sub_bucket;
+    if (!Locate(sample, &exponent, &sub_bucket)) {
+      ++zero_count_;
+    } else if (sample < 0.0) {
+      ++negative_octaves_[exponent][sub_bucket];
+    } else {
+      ++positive_octaves_[exponent][sub_bucket];
+    }
+    total_count_ += 1u;
+    min_ = std::min(min_, sample);
+    max_ = std::max(max_, sample);
+  }
+
+  // Adds all samples of the other histogram.
+  void Merge(const LogHistogram& other) {
+    if (other.total_count_ == 0u) {
+      return;
+    }
+    MergeOctaves(other.negative_octaves_, &negative_octaves_);
+    MergeOctaves(other.positive_octaves_, &positive_octaves_);
+    zero_count_ += other.zero_count_;
+    total_count_ += other.total_count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  // Returns the smallest value such that at least the given percentage of the samples are
+  // less or equal, up to the bucket resolution. Returns 0 if there are no samples.
+  double Percentile(double percentile) const {
+    CHECK_GE(percentile, 0.0);
+    CHECK_LE(percentile, 100.0);
+    if (total_count_ == 0u) {
+      return 0.0;
+    }
+    const uint64_t rank = std::max<uint64_t>(
+        1u, static_cast<uint64_t>(std::ceil(percentile / 100.0 * total_count_)));
+    uint64_t cumulative_count = 0u;
+    // Negative values in ascending order: from the largest magnitude to the smallest.
+    for (OctaveMap::const_reverse_iterator it = negative_octaves_.rbegin();
+         it != negative_octaves_.rend(); ++it) {
+      for (int sub_bucket = kNumSubBucketsPerOctave - 1; sub_bucket >= 0; --sub_bucket) {
+        cumulative_count += it->second[sub_bucket];
+        if (cumulative_count >= rank) {
+          return Clamp(-BucketMagnitude(it->first, sub_bucket));
+        }
+      }
+    }
+    cumulative_count += zero_count_;
+    if (cumulative_count >= rank) {
+      return Clamp(0.0);
+    }
+    for (const OctaveMap::value_type& octave : positive_octaves_) {
+      for (int sub_bucket = 0; sub_bucket < kNumSubBucketsPerOctave; ++sub_bucket) {
+        cumulative_count += octave.second[sub_bucket];
+        if (cumulative_count >= rank) {
+          return Clamp(BucketMagnitude(octave.first, sub_bucket));
+        }
+      }
+    }
+    return max_;
+  }
+
+  uint64_t total_count() const {
+    return total_count_;
+  }
+
+  double min() const {
+    return min_;
+  }
+
+  double max() const {
+    return max_;
+  }
+
+  // Number of octaves with allocated buckets, which bounds the memory of the histogram.
+  size_t num_octaves() const {
+    return negative_octaves_.size() + positive_octaves_.size();
+  }
+
+  void Clear() {
+    *this = LogHistogram();
+  }
+
+ private:
+  typedef std::array<uint64_t, kNumSubBucketsPerOctave> Octave;
+  // Keyed by the binary exponent of the magnitude.
+  typedef std::map<int, Octave> OctaveMap;
+
+  // Returns the octave and the bucket within the octave of the magnitude of the sample, or
+  // false if it is counted as zero.
+  static bool Locate(double sample, int* exponent, int* sub_bucket) {
+    const double magnitude = std::abs(sample);
+    if (!(magnitude >= std::ldexp(0.5, kMinExponent + 1))) {
+      // Also catches NaN.
+      return false;
+    }
+    const double mantissa = std::frexp(magnitude, exponent);
+    *sub_bucket = static_cast<int>((mantissa - 0.5) * 2.0 * kNumSubBucketsPerOctave);
+    if (*exponent > kMaxExponent) {
+      *exponent = kMaxExponent;
+      *sub_bucket = kNumSubBucketsPerOctave - 1;
+    }
+    *sub_bucket = std::min(*sub_bucket, kNumSubBucketsPerOctave - 1);
+    return true;
+  }
+
+  // Returns the center of the bucket.
+  static double BucketMagnitude(int exponent, int sub_bucket) {
+    return std::ldexp(0.5 + (sub_bucket + 0.5) / (2.0 * kNumSubBucketsPerOctave), exponent);
+  }
+
+  static void MergeOctaves(const OctaveMap& source, OctaveMap* destination) {
+    for (const OctaveMap::value_type& octave : source) {
+      Octave& destination_octave = (*destination)[octave.first];
+      for (int sub_bucket = 0; sub_bucket < kNumSubBucketsPerOctave; ++sub_bucket) {
+        destination_octave[sub_bucket] += octave.second[sub_bucket];
+      }
+    }
+  }
+
+  double Clamp(double value) const {
+    return std::min(std::max(value, min_), max_);
+  }
+
+  OctaveMap negative_octaves_;
+  OctaveMap positive_octaves_;
+  uint64_t zero_count_;
+  uint64_t total_count_;
+  double min_;
+  double max_;
+};
+
+}  // namespace statistics
+
+#endif  // ASLAM_STATISTICS_HISTOGRAM_H_
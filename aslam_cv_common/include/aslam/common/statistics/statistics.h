@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "aslam/common/statistics/accumulator.h"
+#include "aslam/common/statistics/histogram.h"
 
 ///
 // Example usage:
@@ -49,6 +50,7 @@ struct StatisticsMapValue {
 
     time_last_called_ = now;
     values_.Add(sample);
+    histogram_.Add(sample);
   }
   inline double GetLastDeltaTime() const {
     if (time_deltas_.total_samples()) {
@@ -85,6 +87,13 @@ struct StatisticsMapValue {
   double LazyVariance() const {
     return values_.LazyVariance();
   }
+  // Percentile over all samples, in [0, 100].
+  double Percentile(double percentile) const {
+    return histogram_.Percentile(percentile);
+  }
+  const LogHistogram& Histogram() const {
+    return histogram_;
+  }
   double MeanCallsPerSec() const {
     double mean_dt = time_deltas_.Mean();
     if (mean_dt != 0) {
@@ -114,6 +123,7 @@ struct StatisticsMapValue {
   // Create an accumulator with specified window size.
   Accumulator<double, double, kWindowSize> values_;
   Accumulator<double, double, kWindowSize> time_deltas_;
+  LogHistogram histogram_;
   std::chrono::time_point<std::chrono::system_clock> time_last_called_;
   std::chrono::time_point<std::chrono::system_clock> epoch_clock_;
 };
@@ -170,6 +180,12 @@ class Statistics {
   static double GetMax(std::string const& tag);
   static double GetHz(size_t handle);
   static double GetHz(std::string const& tag);
+  // Percentile in [0, 100] over all samples, see LogHistogram for the resolution.
+  static double GetPercentile(size_t handle, double percentile);
+  static double GetPercentile(std::string const& tag, double percentile);
+  // Returns a copy of the histogram of all samples, e.g. to merge it with other histograms.
+  static LogHistogram GetHistogram(size_t handle);
+  static LogHistogram GetHistogram(std::string const& tag);
 
   static double GetMeanDeltaTime(std::string const& tag);
   static double GetMeanDeltaTime(size_t handle);
@@ -183,6 +199,7 @@ class Statistics {
   static double GetVarianceDeltaTime(size_t handle);
 
   static void WriteToYamlFile(const std::string& path);
+  static void WriteToYaml(std::ostream& out);  // NOLINT
   static void Print(std::ostream& out);  // NOLINT
   static std::string Print();
   static std::string SecondsToTimeString(double seconds);
@@ -190,6 +207,8 @@ class Statistics {
   static const map_t& GetStatsCollectors() {
     return Instance().tag_map_;
   }
+  // Returns a copy of the tag map that is safe to iterate while tags are being added.
+  static map_t CopyTagMap();
 
  private:
   void AddSample(size_t handle, double sample);
@@ -32,6 +32,7 @@
 #define ASLAM_TIMING_TIMER_H_
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <limits>
 #include <map>
@@ -41,6 +42,21 @@
 
 #include "aslam/common/statistics/statistics.h"
 
+///
+// Example usage:
+//
+// #define ENABLE_TIMING 1 // Turn on/off the timing
+// #include <aslam/common/timer.h>
+//
+// // Look up the tag only once and time with the cached handle afterwards.
+// static const size_t kTimerHandle = timing::Timer::RegisterTag("my_function");
+// timing::Timer timer(kTimerHandle);
+// doSomething();
+// timer.Stop();
+//
+// std::cout << timing::Timing::Print();
+///
+
 namespace timing {
 
 // A class that has the timer interface but does nothing. Swapping this in
@@ -55,6 +71,9 @@ class DummyTimer {
     static_cast<void>(construct_stopped);
   }
   ~DummyTimer() {}
+  static size_t RegisterTag(const std::string& /*tag*/) {
+    return 0u;
+  }
   void Start() {}
   double Stop() {
     return -1.0;
@@ -70,9 +89,14 @@ class DummyTimer {
 
 class TimerImpl {
  public:
+  TimerImpl(size_t handle, bool construct_stopped = false);
   TimerImpl(const std::string& tag, bool construct_stopped = false);
   ~TimerImpl();
 
+  // Returns the handle of the tag. Caching the handle at the call site (e.g. in a
+  // function-local static) avoids the tag lookup when constructing the timer.
+  static size_t RegisterTag(const std::string& tag);
+
   void Start();
   // Returns the amount of time passed between Start() and Stop().
   double Stop();
@@ -81,17 +105,47 @@ class TimerImpl {
   size_t GetHandle() const;
 
  private:
-  std::chrono::time_point<std::chrono::system_clock> time_;
+  std::chrono::time_point<std::chrono::steady_clock> time_;
 
   bool is_timing_;
   size_t handle_;
-  std::string tag_;
 };
 
+namespace internal {
+// Running statistics of the samples of one timer. Samples are accumulated per thread and
+// merged when the timers are queried.
+struct TimerSamples {
+  TimerSamples();
+  void Add(double sample);
+  void Merge(const TimerSamples& other);
+  double Variance() const;
+  // Mean of the most recent samples, see kRollingWindowSize.
+  double RollingMean() const;
+
+  size_t num_samples;
+  double mean;
+  double sum_squared_deviations;
+  double min;
+  double max;
+  // Sum and number of the most recent samples. These are maintained by the per-thread
+  // buffers, which keep the sample window, and are summed up by Merge.
+  double rolling_sum;
+  size_t rolling_num_samples;
+};
+
+class ThreadTimerBuffer;
+}  // namespace internal
+
+class Profiler;
+class TimingTest;
+
 class Timing {
  public:
   typedef std::map<std::string, size_t> map_t;
+  friend class Profiler;
   friend class TimerImpl;
+  friend class TimingTest;
+  friend class internal::ThreadTimerBuffer;
   // Definition of static functions to query the timers.
   static size_t GetHandle(const std::string& tag);
   static std::string GetTag(size_t handle);
@@ -107,29 +161,43 @@ class Timing {
   static double GetMinSeconds(const std::string& tag);
   static double GetMaxSeconds(size_t handle);
   static double GetMaxSeconds(const std::string& tag);
+  // Rate derived from the rolling mean of the most recent samples. The window is kept per
+  // thread, so for timers used from several threads it covers the recent samples of each.
   static double GetHz(size_t handle);
   static double GetHz(const std::string& tag);
   static void WriteToYamlFile(const std::string& path);
+  static void WriteToYaml(std::ostream& out);  // NOLINT
   static void Print(std::ostream& out);  // NOLINT
   static std::string Print();
   static std::string SecondsToTimeString(double seconds);
+  // Discards all samples. The tags keep their handles, so timers that cached a handle stay
+  // valid and no new handles are used up when the same tags are timed again.
   static void Reset();
   static const map_t& GetTimerImpls() {
     return Instance().tag_map_;
   }
+  // Returns a copy of the tag map that is safe to iterate while tags are being added.
+  static map_t CopyTagMap();
 
  private:
-  void AddTime(size_t handle, double seconds);
+  // Lock-free: the sample is added to the buffer of the calling thread.
+  static void AddTime(size_t handle, double seconds);
+  // Merges the samples of all threads.
+  static internal::TimerSamples GetSamples(size_t handle);
 
   static Timing& Instance();
 
   Timing();
   ~Timing();
 
-  typedef std::vector<statistics::StatisticsMapValue> list_t;
-
-  list_t timers_;
+  // Buffers of all running threads that have used a timer.
+  std::vector<internal::ThreadTimerBuffer*> thread_buffers_;
+  // Samples of threads that have exited, indexed by handle.
+  std::vector<internal::TimerSamples> finished_thread_samples_;
   map_t tag_map_;
+  // Incremented by Reset. Thread buffers drop samples recorded in an older generation.
+  std::atomic<size_t> generation_;
+  size_t num_handles_;
   size_t max_tag_length_;
   std::mutex mutex_;
 };
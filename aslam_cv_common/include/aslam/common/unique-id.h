@@ -95,6 +95,21 @@ void generateId(IdType* id) {
   id->fromUint64(hash);
 }
 
+// Generates num_ids unique IDs with a single time sample and counter
+// reservation, appending them to ids.
+template <typename IdType>
+void generateIds(size_t num_ids, std::vector<IdType>* ids) {
+  CHECK_NOTNULL(ids);
+  std::vector<uint64_t> hashes(2u * num_ids);
+  internal::generateUnique128BitHashes(num_ids, hashes.data());
+  ids->reserve(ids->size() + num_ids);
+  for (size_t i = 0u; i < num_ids; ++i) {
+    IdType id;
+    id.fromUint64(&hashes[2u * i]);
+    ids->push_back(id);
+  }
+}
+
 template <typename IdType>
 IdType createRandomId() {
   IdType id;
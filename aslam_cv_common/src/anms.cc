@@ -0,0 +1,237 @@
+#include "aslam/common/anms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include <glog/logging.h>
+
+namespace aslam {
+namespace common {
+
+namespace {
+// Limits the memory of the bucket grid used for the radius queries.
+constexpr int kMaxNumGridCellsPerDimension = 256;
+constexpr int kMaxNumRadiusSearchIterations = 40;
+
+// Bounding box of the keypoints, grown to at least one pixel in each direction.
+struct KeypointBounds {
+  explicit KeypointBounds(const Eigen::Matrix2Xd& keypoints)
+      : min(keypoints.rowwise().minCoeff()),
+        extent((keypoints.rowwise().maxCoeff() - min).cwiseMax(1.0)) {}
+  Eigen::Vector2d min;
+  Eigen::Vector2d extent;
+};
+
+// Buckets the accepted keypoints into square cells with a side length of at least the
+// radius, so all keypoints within the radius of a query lie in the 3x3 neighborhood of the
+// cell of the query. The cells keep singly linked lists of keypoint indices.
+class RadiusSuppressionGrid {
+ public:
+  RadiusSuppressionGrid(
+      const Eigen::Matrix2Xd& keypoints, const KeypointBounds& bounds, double radius)
+      : keypoints_(keypoints), bounds_(bounds), squared_radius_(radius * radius) {
+    cell_size_ = std::max(
+        radius, bounds.extent.maxCoeff() / static_cast<double>(kMaxNumGridCellsPerDimension));
+    num_cols_ = static_cast<int>(bounds.extent.x() / cell_size_) + 1;
+    num_rows_ = static_cast<int>(bounds.extent.y() / cell_size_) + 1;
+    cell_heads_.assign(static_cast<size_t>(num_cols_) * num_rows_, -1);
+    next_.assign(keypoints.cols(), -1);
+  }
+
+  // Adds the keypoint if no previously added keypoint is closer than the radius.
+  bool addIfNotSuppressed(size_t index) {
+    const Eigen::Vector2d keypoint = keypoints_.col(index);
+    const int col = cellCoordinate(keypoint.x() - bounds_.min.x(), num_cols_);
+    const int row = cellCoordinate(keypoint.y() - bounds_.min.y(), num_rows_);
+    for (int neighbor_row = std::max(row - 1, 0);
+         neighbor_row <= std::min(row + 1, num_rows_ - 1); ++neighbor_row) {
+      for (int neighbor_col = std::max(col - 1, 0);
+           neighbor_col <= std::min(col + 1, num_cols_ - 1); ++neighbor_col) {
+        for (int other = cell_heads_[neighbor_row * num_cols_ + neighbor_col]; other >= 0;
+             other = next_[other]) {
+          if ((keypoints_.col(other) - keypoint).squaredNorm() < squared_radius_) {
+            return false;
+          }
+        }
+      }
+    }
+    int& cell_head = cell_heads_[row * num_cols_ + col];
+    next_[index] = cell_head;
+    cell_head = static_cast<int>(index);
+    return true;
+  }
+
+ private:
+  int cellCoordinate(double offset, int num_cells) const {
+    return std::min(static_cast<int>(offset / cell_size_), num_cells - 1);
+  }
+
+  const Eigen::Matrix2Xd& keypoints_;
+  const KeypointBounds& bounds_;
+  const double squared_radius_;
+  double cell_size_;
+  int num_cols_;
+  int num_rows_;
+  std::vector<int> cell_heads_;
+  std::vector<int> next_;
+};
+
+// Greedily accepts the keypoints in the given order unless suppressed by an accepted one.
+// Stops as soon as max_num_selected keypoints are accepted.
+void selectGreedily(
+    const Eigen::Matrix2Xd& keypoints, const KeypointBounds& bounds,
+    const std::vector<size_t>& order, double radius, size_t max_num_selected,
+    std::vector<size_t>* selected_indices) {
+  CHECK_NOTNULL(selected_indices)->clear();
+  RadiusSuppressionGrid grid(keypoints, bounds, radius);
+  for (const size_t index : order) {
+    if (grid.addIfNotSuppressed(index)) {
+      selected_indices->push_back(index);
+      if (selected_indices->size() == max_num_selected) {
+        return;
+      }
+    }
+  }
+}
+
+void selectWithRadiusSuppression(
+    const Eigen::Matrix2Xd& keypoints, const std::vector<size_t>& order,
+    size_t num_keypoints_to_select, std::vector<size_t>* selected_indices) {
+  CHECK_NOTNULL(selected_indices);
+  const KeypointBounds bounds(keypoints);
+  // A radius of zero suppresses nothing, no radius larger than the diagonal keeps more than
+  // one keypoint.
+  double min_radius = 0.0;
+  double max_radius = bounds.extent.norm();
+  std::vector<size_t> candidate_indices;
+  for (int iteration = 0; iteration < kMaxNumRadiusSearchIterations; ++iteration) {
+    const double radius = 0.5 * (min_radius + max_radius);
+    selectGreedily(
+        keypoints, bounds, order, radius, num_keypoints_to_select, &candidate_indices);
+    if (candidate_indices.size() == num_keypoints_to_select) {
+      min_radius = radius;
+      selected_indices->swap(candidate_indices);
+    } else {
+      max_radius = radius;
+    }
+    if (max_radius - min_radius < 0.5) {
+      break;
+    }
+  }
+  if (selected_indices->size() != num_keypoints_to_select) {
+    selectGreedily(
+        keypoints, bounds, order, min_radius, num_keypoints_to_select, selected_indices);
+  }
+  CHECK_EQ(selected_indices->size(), num_keypoints_to_select);
+}
+
+void selectWithGridSuppression(
+    const Eigen::Matrix2Xd& keypoints, const std::vector<size_t>& order,
+    size_t num_keypoints_to_select, std::vector<size_t>* selected_indices) {
+  CHECK_NOTNULL(selected_indices)->clear();
+  const KeypointBounds bounds(keypoints);
+  const double cell_size =
+      std::sqrt(bounds.extent.prod() / static_cast<double>(num_keypoints_to_select));
+  const int num_cols = static_cast<int>(bounds.extent.x() / cell_size) + 1;
+  const int num_rows = static_cast<int>(bounds.extent.y() / cell_size) + 1;
+
+  std::vector<bool> is_cell_occupied(static_cast<size_t>(num_cols) * num_rows, false);
+  std::vector<bool> is_selected(keypoints.cols(), false);
+  for (const size_t index : order) {
+    const int col = std::min(
+        static_cast<int>((keypoints(0, index) - bounds.min.x()) / cell_size), num_cols - 1);
+    const int row = std::min(
+        static_cast<int>((keypoints(1, index) - bounds.min.y()) / cell_size), num_rows - 1);
+    std::vector<bool>::reference is_occupied = is_cell_occupied[row * num_cols + col];
+    if (!is_occupied) {
+      is_occupied = true;
+      is_selected[index] = true;
+      selected_indices->push_back(index);
+      if (selected_indices->size() == num_keypoints_to_select) {
+        return;
+      }
+    }
+  }
+
+  // Fewer occupied cells than keypoints to select: fill up with the strongest leftovers.
+  for (const size_t index : order) {
+    if (!is_selected[index]) {
+      is_selected[index] = true;
+      selected_indices->push_back(index);
+      if (selected_indices->size() == num_keypoints_to_select) {
+        break;
+      }
+    }
+  }
+  std::vector<size_t> score_rank(keypoints.cols());
+  for (size_t rank = 0u; rank < order.size(); ++rank) {
+    score_rank[order[rank]] = rank;
+  }
+  std::sort(
+      selected_indices->begin(), selected_indices->end(),
+      [&score_rank](size_t lhs, size_t rhs) { return score_rank[lhs] < score_rank[rhs]; });
+}
+}  // namespace
+
+void selectKeypointsAnms(
+    const Eigen::Matrix2Xd& keypoints, const Eigen::VectorXd& scores,
+    size_t num_keypoints_to_select, AnmsMethod method, std::vector<size_t>* selected_indices) {
+  CHECK_NOTNULL(selected_indices)->clear();
+  CHECK_EQ(static_cast<int>(keypoints.cols()), scores.size());
+  const size_t num_keypoints = static_cast<size_t>(keypoints.cols());
+
+  std::vector<size_t> order(num_keypoints);
+  std::iota(order.begin(), order.end(), 0u);
+  std::stable_sort(
+      order.begin(), order.end(),
+      [&scores](size_t lhs, size_t rhs) { return scores(lhs) > scores(rhs); });
+
+  if (num_keypoints <= num_keypoints_to_select) {
+    selected_indices->swap(order);
+    return;
+  }
+  if (num_keypoints_to_select == 0u) {
+    return;
+  }
+
+  switch (method) {
+    case AnmsMethod::kRadius:
+      selectWithRadiusSuppression(keypoints, order, num_keypoints_to_select, selected_indices);
+      break;
+    case AnmsMethod::kGrid:
+      selectWithGridSuppression(keypoints, order, num_keypoints_to_select, selected_indices);
+      break;
+    default:
+      LOG(FATAL) << "Unknown ANMS method: " << static_cast<int>(method);
+  }
+}
+
+void selectKeypointsAnms(
+    size_t num_keypoints_to_select, AnmsMethod method, std::vector<cv::KeyPoint>* keypoints) {
+  CHECK_NOTNULL(keypoints);
+  if (keypoints->size() <= num_keypoints_to_select) {
+    return;
+  }
+  Eigen::Matrix2Xd keypoint_coordinates(2, keypoints->size());
+  Eigen::VectorXd scores(keypoints->size());
+  for (size_t i = 0u; i < keypoints->size(); ++i) {
+    const cv::KeyPoint& keypoint = (*keypoints)[i];
+    keypoint_coordinates(0, i) = keypoint.pt.x;
+    keypoint_coordinates(1, i) = keypoint.pt.y;
+    scores(i) = keypoint.response;
+  }
+  std::vector<size_t> selected_indices;
+  selectKeypointsAnms(
+      keypoint_coordinates, scores, num_keypoints_to_select, method, &selected_indices);
+
+  std::vector<cv::KeyPoint> selected_keypoints;
+  selected_keypoints.reserve(selected_indices.size());
+  for (const size_t index : selected_indices) {
+    selected_keypoints.push_back((*keypoints)[index]);
+  }
+  keypoints->swap(selected_keypoints);
+}
+
+}  // namespace common
+}  // namespace aslam
@@ -1,4 +1,7 @@
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 #include <aslam/common/channel.h>
@@ -12,31 +15,197 @@ bool Channel<cv::Mat>::operator==(const Channel<cv::Mat>& other) {
   return cv::countNonZero(value_ != other.value_) == 0;
 }
 
+namespace internal {
+namespace {
+constexpr size_t kNumReaderStripes = 64u;
+
+// Reader counters of both phases, padded to a cache line.
+struct alignas(64) ReaderStripe {
+  std::atomic<uint32_t> num_readers[2];
+};
+
+ReaderStripe reader_stripes[kNumReaderStripes];
+std::atomic<uint32_t> reader_phase(0u);
+std::atomic<size_t> next_reader_stripe(0u);
+// Serializes the phase flips of the writers.
+std::mutex m_reader_phase;
+
+ReaderStripe& getThreadReaderStripe() {
+  thread_local ReaderStripe& stripe =
+      reader_stripes[next_reader_stripe.fetch_add(1u) % kNumReaderStripes];
+  return stripe;
+}
+}  // namespace
+
+ChannelMapReadSection::ChannelMapReadSection() {
+  ReaderStripe& stripe = getThreadReaderStripe();
+  // Register in the current phase. If a writer flipped the phase in between, it may not wait
+  // for the counter we incremented, so retry in the new phase.
+  uint32_t phase = reader_phase.load();
+  while (true) {
+    num_readers_ = &stripe.num_readers[phase];
+    num_readers_->fetch_add(1u);
+    const uint32_t current_phase = reader_phase.load();
+    if (current_phase == phase) {
+      break;
+    }
+    num_readers_->fetch_sub(1u, std::memory_order_release);
+    phase = current_phase;
+  }
+}
+
+ChannelMapReadSection::~ChannelMapReadSection() {
+  num_readers_->fetch_sub(1u, std::memory_order_release);
+}
+
+void waitForChannelMapReaders() {
+  // New readers register in the flipped phase and see the map published before this call.
+  // Only the readers of the previous phase may still hold an unpublished map, and their
+  // number can only drop.
+  std::lock_guard<std::mutex> lock(m_reader_phase);
+  const uint32_t previous_phase = reader_phase.load();
+  reader_phase.store(previous_phase ^ 1u);
+  for (ReaderStripe& stripe : reader_stripes) {
+    while (stripe.num_readers[previous_phase].load(std::memory_order_acquire) != 0u) {
+      std::this_thread::yield();
+    }
+  }
+}
+}  // namespace internal
+
+ChannelGroup::ChannelGroup() : channels_(new ChannelMap()) {}
+
+ChannelGroup::ChannelGroup(const ChannelGroup& other)
+    : channels_(new ChannelMap(other.getChannels())) {}
+
+ChannelGroup::ChannelGroup(const ChannelMap& channels) : channels_(new ChannelMap(channels)) {}
+
+ChannelGroup::~ChannelGroup() {
+  delete channels_.load();
+}
+
+ChannelGroup& ChannelGroup::operator=(const ChannelGroup& other) {
+  if (this == &other) {
+    return *this;
+  }
+  std::unique_ptr<const ChannelMap> channels(new ChannelMap(other.getChannels()));
+  std::lock_guard<std::mutex> lock(m_channels_);
+  publishLocked(std::move(channels));
+  return *this;
+}
+
+ChannelBase* ChannelGroup::getChannelMutable(const std::string& channel_name) {
+  std::lock_guard<std::mutex> lock(m_channels_);
+  const ChannelMap& current_channels = getChannelsLocked();
+  ChannelMap::const_iterator it = current_channels.find(channel_name);
+  if (it == current_channels.end()) {
+    return nullptr;
+  }
+  if (!isChannelSharedLocked(it->second)) {
+    return it->second.get();
+  }
+  std::unique_ptr<ChannelMap> channels(new ChannelMap(current_channels));
+  std::shared_ptr<ChannelBase>& channel = (*channels)[channel_name];
+  channel.reset(channel->clone());
+  ChannelBase* detached_channel = channel.get();
+  publishLocked(std::move(channels));
+  return detached_channel;
+}
+
+bool ChannelGroup::addChannel(const std::string& channel_name,
+                              const std::shared_ptr<ChannelBase>& channel) {
+  CHECK(channel);
+  std::lock_guard<std::mutex> lock(m_channels_);
+  if (getChannelsLocked().count(channel_name) > 0u) {
+    return false;
+  }
+  std::unique_ptr<ChannelMap> channels(new ChannelMap(getChannelsLocked()));
+  channels->emplace(channel_name, channel);
+  publishLocked(std::move(channels));
+  return true;
+}
+
+bool ChannelGroup::removeChannel(const std::string& channel_name) {
+  std::lock_guard<std::mutex> lock(m_channels_);
+  if (getChannelsLocked().count(channel_name) == 0u) {
+    return false;
+  }
+  std::unique_ptr<ChannelMap> channels(new ChannelMap(getChannelsLocked()));
+  channels->erase(channel_name);
+  publishLocked(std::move(channels));
+  return true;
+}
+
+ChannelMap ChannelGroup::getChannels() const {
+  // Copying the map shares its channels, which must not race with the uniqueness check of
+  // getChannelMutable().
+  std::lock_guard<std::mutex> lock(m_channels_);
+  return getChannelsLocked();
+}
+
+void ChannelGroup::printParameters(std::ostream& out) const {
+  std::lock_guard<std::mutex> lock(m_channels_);
+  const ChannelMap& channels = getChannelsLocked();
+  if (!channels.empty()) {
+    out << "  Channels:" << std::endl;
+    for (const ChannelMap::value_type& channel : channels) {
+      out << "   - " << channel.first << std::endl;
+    }
+  } else {
+    out << "  Channels: empty" << std::endl;
+  }
+}
+
+const ChannelMap& ChannelGroup::getChannelsLocked() const {
+  return *channels_.load(std::memory_order_relaxed);
+}
+
+void ChannelGroup::publishLocked(std::unique_ptr<const ChannelMap> channels) {
+  CHECK(channels);
+  std::unique_ptr<const ChannelMap> previous_channels(channels_.exchange(channels.release()));
+  internal::waitForChannelMapReaders();
+}
+
+bool ChannelGroup::isChannelSharedLocked(const std::shared_ptr<ChannelBase>& channel) {
+  CHECK(channel);
+  if (channel.use_count() > 1) {
+    return true;
+  }
+  // use_count() is a relaxed load. Order the writes of the caller after the release of the
+  // last other reference, which may have been read through until then.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return false;
+}
+
 ChannelGroup cloneChannelGroup(const ChannelGroup& channels) {
-  std::lock_guard<std::mutex> lock(channels.m_channels_);
-  ChannelGroup cloned_group;
-  for (const ChannelMap::value_type& channel : channels.channels_) {
+  ChannelMap cloned_channels;
+  for (const ChannelMap::value_type& channel : channels.getChannels()) {
     CHECK(channel.second);
-    cloned_group.channels_.emplace(channel.first,
-                                   std::shared_ptr<ChannelBase>(channel.second->clone()));
+    cloned_channels.emplace(channel.first,
+                            std::shared_ptr<ChannelBase>(channel.second->clone()));
   }
-  return cloned_group;
+  return ChannelGroup(cloned_channels);
 }
 
+ChannelGroup shareChannelGroup(const ChannelGroup& channels) {
+  return ChannelGroup(channels);
+}
+
+
 bool isChannelGroupEqual(const ChannelGroup& left_channels, const ChannelGroup& right_channels) {
   // Early exit if both groups are the same.
   if (&left_channels == &right_channels) {
     return true;
   }
-  std::lock_guard<std::mutex> lock_left(left_channels.m_channels_);
-  std::lock_guard<std::mutex> lock_right(right_channels.m_channels_);
+  const ChannelMap left_channel_map = left_channels.getChannels();
+  const ChannelMap right_channel_map = right_channels.getChannels();
 
-  if (left_channels.channels_.size() != right_channels.channels_.size()) {
+  if (left_channel_map.size() != right_channel_map.size()) {
     return false;
   }
-  for (const ChannelMap::value_type& left_channel_pair : left_channels.channels_) {
-    ChannelMap::const_iterator it_right = right_channels.channels_.find(left_channel_pair.first);
-    if (it_right == right_channels.channels_.end()) {
+  for (const ChannelMap::value_type& left_channel_pair : left_channel_map) {
+    ChannelMap::const_iterator it_right = right_channel_map.find(left_channel_pair.first);
+    if (it_right == right_channel_map.end()) {
       return false;
     }
     if (!CHECK_NOTNULL(it_right->second.get())->compare(*left_channel_pair.second)) {
@@ -3,16 +3,62 @@
 #include <atomic>
 #include <chrono>
 
+#include <glog/logging.h>
+
 namespace aslam {
 namespace internal {
-void generateUnique128BitHash(uint64_t hash[2]) {
-  static std::atomic<uint64_t> counter;
-  hash[0] =
-      aslam::internal::UniqueIdHashSeed::instance().seed() ^
+namespace {
+// Every thread reserves blocks of counter values such that the shared counter
+// is only touched once per block.
+constexpr uint64_t kNumCounterValuesPerBlock = 1024u;
+std::atomic<uint64_t> counter;
+
+struct ThreadCounterBlock {
+  ThreadCounterBlock() : next(0u), end(0u) {}
+  uint64_t next;
+  uint64_t end;
+};
+
+// Reserves num_values consecutive counter values and returns the first one.
+uint64_t reserveCounterValues(uint64_t num_values) {
+  static thread_local ThreadCounterBlock block;
+  if (block.end - block.next < num_values) {
+    if (num_values > kNumCounterValuesPerBlock) {
+      return counter.fetch_add(num_values) + 1u;
+    }
+    block.next = counter.fetch_add(kNumCounterValuesPerBlock) + 1u;
+    block.end = block.next + kNumCounterValuesPerBlock;
+  }
+  const uint64_t first_value = block.next;
+  block.next += num_values;
+  return first_value;
+}
+
+uint64_t timeSeed() {
+  return aslam::internal::UniqueIdHashSeed::instance().seed() ^
       std::hash<uint64_t>()(
           std::chrono::high_resolution_clock::now().time_since_epoch().count());
-  // Increment must happen here, otherwise the sampling is not atomic.
-  hash[1] = std::hash<uint64_t>()(++counter);
+}
+}  // namespace
+
+void generateUnique128BitHash(uint64_t hash[2]) {
+  hash[0] = timeSeed();
+  hash[1] = std::hash<uint64_t>()(reserveCounterValues(1u));
+}
+
+void generateUnique128BitHashes(size_t num_hashes, uint64_t* hashes) {
+  CHECK_NOTNULL(hashes);
+  if (num_hashes == 0u) {
+    return;
+  }
+  // The counter values are unique, so the hashes of one batch can share the
+  // time sample.
+  const uint64_t time_seed = timeSeed();
+  const uint64_t first_value = reserveCounterValues(num_hashes);
+  for (size_t i = 0u; i < num_hashes; ++i) {
+    hashes[2u * i] = time_seed;
+    hashes[2u * i + 1u] = std::hash<uint64_t>()(first_value + i);
+  }
 }
 }  // namespace internal
 }  // namespace common
@@ -0,0 +1,227 @@
+#include "aslam/common/metrics-exporter.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <utility>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+#include "aslam/common/statistics/statistics.h"
+#include "aslam/common/timer.h"
+
+namespace aslam {
+
+namespace {
+void WriteIndented(const std::string& text, std::ostream* out) {
+  CHECK_NOTNULL(out);
+  std::istringstream lines(text);
+  std::string line;
+  while (std::getline(lines, line)) {
+    if (!line.empty()) {
+      *out << "  " << line;
+    }
+    *out << "\n";
+  }
+}
+
+void WritePrometheusLabel(const std::string& tag, std::ostream* out) {
+  CHECK_NOTNULL(out);
+  *out << "{tag=\"";
+  for (const char character : tag) {
+    switch (character) {
+      case '\\':
+        *out << "\\\\";
+        break;
+      case '"':
+        *out << "\\\"";
+        break;
+      case '\n':
+        *out << "\\n";
+        break;
+      default:
+        *out << character;
+    }
+  }
+  *out << "\"";
+}
+
+// Writes all bytes to a file descriptor, retrying partial writes.
+bool WriteAll(int file_descriptor, const std::string& content) {
+  const char* data = content.data();
+  size_t size = content.size();
+  while (size > 0u) {
+    const ssize_t num_written = write(file_descriptor, data, size);
+    if (num_written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += num_written;
+    size -= static_cast<size_t>(num_written);
+  }
+  return true;
+}
+
+// Writes the content to a unique temporary file next to the target and renames it over the
+// target, so concurrent writers of the same path never rename a partial file into place.
+bool WriteFileAtomically(
+    const std::string& path, const std::function<void(std::ostream*)>& write_content) {
+  std::ostringstream content;
+  write_content(&content);
+
+  std::string temporary_path = path + ".XXXXXX";
+  const int file_descriptor = mkstemp(&temporary_path[0]);
+  if (file_descriptor < 0) {
+    LOG(ERROR) << "Could not write metrics: Unable to create a temporary file next to "
+               << path;
+    return false;
+  }
+  // mkstemp creates the file readable by the owner only, but the metrics are collected by
+  // other processes.
+  const bool written = fchmod(file_descriptor, 0644) == 0 &&
+                       WriteAll(file_descriptor, content.str());
+  if (close(file_descriptor) != 0 || !written) {
+    LOG(ERROR) << "Could not write metrics to file: " << temporary_path;
+    unlink(temporary_path.c_str());
+    return false;
+  }
+  if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+    LOG(ERROR) << "Could not move the metrics file " << temporary_path << " to " << path;
+    unlink(temporary_path.c_str());
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+MetricsExporter::MetricsExporter(
+    const std::chrono::milliseconds& interval, const std::string& yaml_path,
+    const std::string& prometheus_path)
+    : interval_(interval),
+      yaml_path_(yaml_path),
+      prometheus_path_(prometheus_path),
+      stop_(false) {
+  CHECK_GT(interval_.count(), 0);
+  CHECK(!yaml_path_.empty() || !prometheus_path_.empty())
+      << "The metrics exporter needs at least one output file.";
+  thread_ = std::thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter() {
+  stop();
+}
+
+void MetricsExporter::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_) {
+      return;
+    }
+    stop_ = true;
+  }
+  stop_requested_.notify_all();
+  thread_.join();
+}
+
+void MetricsExporter::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    stop_requested_.wait_for(lock, interval_, [this]() { return stop_; });
+    // Do not block stop() while writing the files.
+    lock.unlock();
+    exportNow();
+    lock.lock();
+  }
+}
+
+bool MetricsExporter::exportNow() const {
+  bool success = true;
+  if (!yaml_path_.empty()) {
+    success &= WriteFileAtomically(yaml_path_, &MetricsExporter::writeYaml);
+  }
+  if (!prometheus_path_.empty()) {
+    success &= WriteFileAtomically(prometheus_path_, &MetricsExporter::writePrometheus);
+  }
+  return success;
+}
+
+void MetricsExporter::writeYaml(std::ostream* out) {
+  CHECK_NOTNULL(out);
+  std::ostringstream statistics_yaml;
+  statistics::Statistics::WriteToYaml(statistics_yaml);
+  std::ostringstream timing_yaml;
+  timing::Timing::WriteToYaml(timing_yaml);
+
+  *out << "statistics:" << (statistics_yaml.str().empty() ? " {}\n" : "\n");
+  WriteIndented(statistics_yaml.str(), out);
+  *out << "timing:" << (timing_yaml.str().empty() ? " {}\n" : "\n");
+  WriteIndented(timing_yaml.str(), out);
+}
+
+void MetricsExporter::writePrometheus(std::ostream* out) {
+  CHECK_NOTNULL(out);
+  const std::streamsize precision = out->precision();
+  out->precision(std::numeric_limits<double>::max_digits10);
+
+  *out << "# HELP aslam_statistics Samples of statistics::Statistics.\n";
+  *out << "# TYPE aslam_statistics summary\n";
+  for (const statistics::Statistics::map_t::value_type& tag :
+       statistics::Statistics::CopyTagMap()) {
+    const statistics::LogHistogram histogram =
+        statistics::Statistics::GetHistogram(tag.second);
+    if (histogram.total_count() == 0u) {
+      continue;
+    }
+    for (const std::pair<const char*, double>& quantile :
+         {std::make_pair("0.5", 50.0), std::make_pair("0.95", 95.0),
+          std::make_pair("0.99", 99.0), std::make_pair("0.999", 99.9)}) {
+      *out << "aslam_statistics";
+      WritePrometheusLabel(tag.first, out);
+      *out << ",quantile=\"" << quantile.first << "\"} "
+           << histogram.Percentile(quantile.second) << "\n";
+    }
+    *out << "aslam_statistics_sum";
+    WritePrometheusLabel(tag.first, out);
+    *out << "} " << statistics::Statistics::GetTotal(tag.second) << "\n";
+    *out << "aslam_statistics_count";
+    WritePrometheusLabel(tag.first, out);
+    *out << "} " << histogram.total_count() << "\n";
+  }
+
+  *out << "# HELP aslam_timing_seconds Durations of timing::Timer.\n";
+  *out << "# TYPE aslam_timing_seconds summary\n";
+  const timing::Timing::map_t timer_tags = timing::Timing::CopyTagMap();
+  for (const timing::Timing::map_t::value_type& tag : timer_tags) {
+    const size_t num_samples = timing::Timing::GetNumSamples(tag.second);
+    if (num_samples == 0u) {
+      continue;
+    }
+    *out << "aslam_timing_seconds_sum";
+    WritePrometheusLabel(tag.first, out);
+    *out << "} " << timing::Timing::GetTotalSeconds(tag.second) << "\n";
+    *out << "aslam_timing_seconds_count";
+    WritePrometheusLabel(tag.first, out);
+    *out << "} " << num_samples << "\n";
+  }
+  *out << "# HELP aslam_timing_max_seconds Longest duration of timing::Timer.\n";
+  *out << "# TYPE aslam_timing_max_seconds gauge\n";
+  for (const timing::Timing::map_t::value_type& tag : timer_tags) {
+    if (timing::Timing::GetNumSamples(tag.second) == 0u) {
+      continue;
+    }
+    *out << "aslam_timing_max_seconds";
+    WritePrometheusLabel(tag.first, out);
+    *out << "} " << timing::Timing::GetMaxSeconds(tag.second) << "\n";
+  }
+  out->precision(precision);
+}
+
+}  // namespace aslam
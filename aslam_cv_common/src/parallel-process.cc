@@ -0,0 +1,12 @@
+#include <aslam/common/parallel-process.h>
+
+namespace aslam {
+namespace common {
+
+ThreadPool& getParallelProcessThreadPool() {
+  static ThreadPool thread_pool(std::max<size_t>(1u, getNumHardwareThreads() - 1u));
+  return thread_pool;
+}
+
+}  // namespace common
+}  // namespace aslam
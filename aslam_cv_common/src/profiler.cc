@@ -0,0 +1,388 @@
+#include "aslam/common/profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>  // NOLINT
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_uint64(aslam_profiler_max_trace_events_per_thread, 1000000u,
+              "Maximum number of trace events the profiler keeps per thread. Scopes beyond "
+              "this limit are still added to the call tree.");
+
+namespace timing {
+
+namespace {
+constexpr size_t kRootNode = 0u;
+
+struct CallTreeNode {
+  CallTreeNode(size_t _handle, size_t _parent)
+      : handle(_handle), parent(_parent), num_calls(0u), total_seconds(0.0) {}
+  size_t handle;
+  size_t parent;
+  std::vector<size_t> children;
+  size_t num_calls;
+  double total_seconds;
+};
+
+struct TraceEvent {
+  size_t handle;
+  int64_t begin_nanoseconds;
+  int64_t duration_nanoseconds;
+};
+
+// The profile of one thread. Only the owning thread modifies the call tree and the events;
+// the mutex is contended only while exporting.
+struct ThreadProfile {
+  explicit ThreadProfile(size_t _thread_id)
+      : thread_id(_thread_id), current_node(kRootNode), num_dropped_events(0u),
+        is_finished(false) {
+    nodes.emplace_back(std::numeric_limits<size_t>::max(), kRootNode);
+  }
+  bool IsEmpty() const {
+    return nodes[kRootNode].children.empty() && events.empty();
+  }
+  const size_t thread_id;
+  std::string name;
+  std::vector<CallTreeNode> nodes;
+  size_t current_node;
+  std::vector<TraceEvent> events;
+  size_t num_dropped_events;
+  // Set when the thread exited. Guarded by the registry mutex.
+  bool is_finished;
+  std::mutex mutex;
+};
+
+class ProfilerRegistry {
+ public:
+  ProfilerRegistry()
+      : enabled_(false), epoch_(std::chrono::steady_clock::now()), next_thread_id_(1u) {}
+
+  std::shared_ptr<ThreadProfile> RegisterThread() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.emplace_back(new ThreadProfile(next_thread_id_++));
+    return threads_.back();
+  }
+
+  // The profile of an exited thread is kept until the next reset if it holds recorded
+  // scopes, such that they can still be exported.
+  void UnregisterThread(const std::shared_ptr<ThreadProfile>& profile) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool is_empty;
+    {
+      std::lock_guard<std::mutex> profile_lock(profile->mutex);
+      is_empty = profile->IsEmpty();
+    }
+    if (is_empty) {
+      threads_.erase(std::remove(threads_.begin(), threads_.end(), profile), threads_.end());
+    } else {
+      profile->is_finished = true;
+    }
+  }
+
+  void RemoveFinishedThreads() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.erase(
+        std::remove_if(
+            threads_.begin(), threads_.end(),
+            [](const std::shared_ptr<ThreadProfile>& profile) {
+              return profile->is_finished;
+            }),
+        threads_.end());
+  }
+
+  std::vector<std::shared_ptr<ThreadProfile>> GetThreads() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_;
+  }
+
+  std::atomic<bool> enabled_;
+  const std::chrono::time_point<std::chrono::steady_clock> epoch_;
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<ThreadProfile>> threads_;
+  size_t next_thread_id_;
+};
+
+ProfilerRegistry& Registry() {
+  static ProfilerRegistry registry;
+  return registry;
+}
+
+// Registers the profile of a thread when it enters its first scope, such that threads that
+// are never profiled do not allocate a profile, and unregisters it when the thread exits.
+class ThreadProfileHolder {
+ public:
+  ~ThreadProfileHolder() {
+    if (profile_) {
+      Registry().UnregisterThread(profile_);
+    }
+  }
+
+  ThreadProfile& GetProfile() {
+    if (!profile_) {
+      profile_ = Registry().RegisterThread();
+      std::lock_guard<std::mutex> lock(profile_->mutex);
+      profile_->name = name_;
+    }
+    return *profile_;
+  }
+
+  void SetName(const std::string& name) {
+    name_ = name;
+    if (profile_) {
+      std::lock_guard<std::mutex> lock(profile_->mutex);
+      profile_->name = name_;
+    }
+  }
+
+ private:
+  std::string name_;
+  std::shared_ptr<ThreadProfile> profile_;
+};
+
+ThreadProfileHolder& GetThreadProfileHolder() {
+  static thread_local ThreadProfileHolder holder;
+  return holder;
+}
+
+ThreadProfile& GetThreadProfile() {
+  return GetThreadProfileHolder().GetProfile();
+}
+
+// Looks up the tags once per export instead of once per event.
+class TagCache {
+ public:
+  const std::string& GetTag(size_t handle) {
+    std::unordered_map<size_t, std::string>::const_iterator it = tags_.find(handle);
+    if (it == tags_.end()) {
+      it = tags_.emplace(handle, Timing::GetTag(handle)).first;
+    }
+    return it->second;
+  }
+
+ private:
+  std::unordered_map<size_t, std::string> tags_;
+};
+
+void WriteJsonString(const std::string& value, std::ostream* out) {
+  CHECK_NOTNULL(out);
+  *out << '"';
+  for (const char character : value) {
+    switch (character) {
+      case '"':
+        *out << "\\\"";
+        break;
+      case '\\':
+        *out << "\\\\";
+        break;
+      case '\n':
+        *out << "\\n";
+        break;
+      case '\t':
+        *out << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(character) < 0x20) {
+          *out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+               << static_cast<int>(character) << std::dec << std::setfill(' ');
+        } else {
+          *out << character;
+        }
+    }
+  }
+  *out << '"';
+}
+
+void PrintCallTreeNode(
+    const std::vector<CallTreeNode>& nodes, size_t node_index, size_t depth,
+    TagCache* tag_cache, std::ostream* out) {
+  CHECK_NOTNULL(tag_cache);
+  CHECK_NOTNULL(out);
+  const CallTreeNode& node = nodes[node_index];
+  double children_seconds = 0.0;
+  for (const size_t child : node.children) {
+    children_seconds += nodes[child].total_seconds;
+  }
+  *out << std::string(2u * depth, ' ') << tag_cache->GetTag(node.handle) << "\t"
+       << node.num_calls << "\t" << Timing::SecondsToTimeString(node.total_seconds)
+       << "\t(" << Timing::SecondsToTimeString(node.total_seconds / node.num_calls)
+       << ")\tself: " << Timing::SecondsToTimeString(node.total_seconds - children_seconds)
+       << std::endl;
+  for (const size_t child : node.children) {
+    PrintCallTreeNode(nodes, child, depth + 1u, tag_cache, out);
+  }
+}
+}  // namespace
+
+ScopedProfile::ScopedProfile(size_t handle)
+    : handle_(handle), is_active_(Profiler::IsEnabled()) {
+  if (is_active_) {
+    Profiler::EnterScope(handle_);
+    begin_ = std::chrono::steady_clock::now();
+  }
+}
+
+ScopedProfile::ScopedProfile(const std::string& tag)
+    : ScopedProfile(Timing::GetHandle(tag)) {}
+
+ScopedProfile::~ScopedProfile() {
+  if (is_active_) {
+    Profiler::LeaveScope(handle_, begin_, std::chrono::steady_clock::now());
+  }
+}
+
+void Profiler::SetEnabled(bool enabled) {
+  Registry().enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled() {
+  return Registry().enabled_.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+  GetThreadProfileHolder().SetName(name);
+}
+
+void Profiler::EnterScope(size_t handle) {
+  ThreadProfile& profile = GetThreadProfile();
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  const size_t parent = profile.current_node;
+  for (const size_t child : profile.nodes[parent].children) {
+    if (profile.nodes[child].handle == handle) {
+      profile.current_node = child;
+      return;
+    }
+  }
+  profile.current_node = profile.nodes.size();
+  profile.nodes.emplace_back(handle, parent);
+  profile.nodes[parent].children.push_back(profile.current_node);
+}
+
+void Profiler::LeaveScope(
+    size_t handle, const std::chrono::time_point<std::chrono::steady_clock>& begin,
+    const std::chrono::time_point<std::chrono::steady_clock>& end) {
+  const int64_t duration_nanoseconds =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+  const double duration_seconds = static_cast<double>(duration_nanoseconds) * 1e-9;
+  Timing::AddTime(handle, duration_seconds);
+
+  ThreadProfile& profile = GetThreadProfile();
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  // The tree may have been reset while this scope was open.
+  if (profile.current_node != kRootNode &&
+      profile.nodes[profile.current_node].handle == handle) {
+    CallTreeNode& node = profile.nodes[profile.current_node];
+    ++node.num_calls;
+    node.total_seconds += duration_seconds;
+    profile.current_node = node.parent;
+  }
+
+  if (profile.events.size() < FLAGS_aslam_profiler_max_trace_events_per_thread) {
+    TraceEvent event;
+    event.handle = handle;
+    event.begin_nanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(begin - Registry().epoch_)
+            .count();
+    event.duration_nanoseconds = duration_nanoseconds;
+    profile.events.push_back(event);
+  } else {
+    ++profile.num_dropped_events;
+  }
+}
+
+void Profiler::PrintCallTree(std::ostream& out) {  // NOLINT
+  TagCache tag_cache;
+  out << "Profiler call tree (calls, total, (mean), self)\n";
+  out << "-----------\n";
+  for (const std::shared_ptr<ThreadProfile>& profile : Registry().GetThreads()) {
+    std::lock_guard<std::mutex> lock(profile->mutex);
+    if (profile->nodes[kRootNode].children.empty()) {
+      continue;
+    }
+    out << "Thread " << profile->thread_id;
+    if (!profile->name.empty()) {
+      out << " (" << profile->name << ")";
+    }
+    out << std::endl;
+    for (const size_t child : profile->nodes[kRootNode].children) {
+      PrintCallTreeNode(profile->nodes, child, 1u, &tag_cache, &out);
+    }
+  }
+}
+
+std::string Profiler::PrintCallTree() {
+  std::stringstream ss;
+  PrintCallTree(ss);
+  return ss.str();
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) {
+  std::ofstream output_file(path);
+  if (!output_file) {
+    LOG(ERROR) << "Could not write the trace: Unable to open file: " << path;
+    return false;
+  }
+  VLOG(1) << "Writing the trace to file: " << path;
+  WriteChromeTrace(output_file);
+  return static_cast<bool>(output_file);
+}
+
+void Profiler::WriteChromeTrace(std::ostream& out) {  // NOLINT
+  TagCache tag_cache;
+  const int process_id = static_cast<int>(getpid());
+  const std::ios::fmtflags flags = out.flags();
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool is_first_event = true;
+  for (const std::shared_ptr<ThreadProfile>& profile : Registry().GetThreads()) {
+    std::lock_guard<std::mutex> lock(profile->mutex);
+    if (profile->num_dropped_events > 0u) {
+      LOG(WARNING) << "Dropped " << profile->num_dropped_events << " trace events of thread "
+                   << profile->thread_id << ", increase "
+                   << "--aslam_profiler_max_trace_events_per_thread.";
+    }
+    if (!profile->name.empty()) {
+      out << (is_first_event ? "\n" : ",\n");
+      out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << process_id
+          << ",\"tid\":" << profile->thread_id << ",\"args\":{\"name\":";
+      WriteJsonString(profile->name, &out);
+      out << "}}";
+      is_first_event = false;
+    }
+    for (const TraceEvent& event : profile->events) {
+      out << (is_first_event ? "\n" : ",\n");
+      out << "{\"name\":";
+      WriteJsonString(tag_cache.GetTag(event.handle), &out);
+      out << ",\"cat\":\"aslam\",\"ph\":\"X\",\"ts\":" << event.begin_nanoseconds * 1e-3
+          << ",\"dur\":" << event.duration_nanoseconds * 1e-3 << ",\"pid\":" << process_id
+          << ",\"tid\":" << profile->thread_id << "}";
+      is_first_event = false;
+    }
+  }
+  out << "\n]}\n";
+  out.flags(flags);
+}
+
+void Profiler::Reset() {
+  for (const std::shared_ptr<ThreadProfile>& profile : Registry().GetThreads()) {
+    std::lock_guard<std::mutex> lock(profile->mutex);
+    profile->nodes.erase(profile->nodes.begin() + 1, profile->nodes.end());
+    profile->nodes[kRootNode].children.clear();
+    profile->current_node = kRootNode;
+    profile->events.clear();
+    profile->num_dropped_events = 0u;
+  }
+  Registry().RemoveFinishedThreads();
+}
+
+}  // namespace timing
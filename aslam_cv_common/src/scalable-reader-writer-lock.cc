@@ -0,0 +1,113 @@
+#include "aslam/common/scalable-reader-writer-lock.h"
+
+namespace aslam {
+
+// All accesses to readers_blocked_ and the reader slots are sequentially consistent: a reader
+// increments its slot before checking the flag and a writer sets the flag before summing the
+// slots, so at least one of them sees the other.
+
+ScalableReaderWriterMutex::ScalableReaderWriterMutex()
+    : ReaderWriterMutex(), readers_blocked_(false) {}
+
+ScalableReaderWriterMutex::~ScalableReaderWriterMutex() {}
+
+size_t ScalableReaderWriterMutex::getReaderSlotIndex() {
+  static std::atomic<size_t> next_slot_index(0u);
+  static thread_local const size_t slot_index = next_slot_index++ % kNumReaderSlots;
+  return slot_index;
+}
+
+int64_t ScalableReaderWriterMutex::getNumReaders() const {
+  int64_t num_readers = 0;
+  for (const ReaderSlot& slot : reader_slots_) {
+    num_readers += slot.num_readers.load();
+  }
+  return num_readers;
+}
+
+void ScalableReaderWriterMutex::notifyWaitingWriters() {
+  // Taking the mutex ensures a writer is either before its check of the readers or already
+  // waiting.
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_readers_.notify_all();
+}
+
+void ScalableReaderWriterMutex::updateReadersBlocked() {
+  readers_blocked_ = current_writer_ || pending_upgrade_ || num_pending_writers_ != 0u;
+}
+
+void ScalableReaderWriterMutex::acquireReadLock() {
+  std::atomic<int64_t>& num_readers = reader_slots_[getReaderSlotIndex()].num_readers;
+  while (true) {
+    ++num_readers;
+    if (!readers_blocked_) {
+      return;
+    }
+    // Back off and wait for the writer to finish.
+    --num_readers;
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_readers_.notify_all();
+    ++pending_readers_;
+    while (readers_blocked_) {
+      cv_writer_finished_.wait(lock);
+    }
+    --pending_readers_;
+  }
+}
+
+void ScalableReaderWriterMutex::releaseReadLock() {
+  --reader_slots_[getReaderSlotIndex()].num_readers;
+  if (readers_blocked_) {
+    notifyWaitingWriters();
+  }
+}
+
+void ScalableReaderWriterMutex::acquireWriteLock() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  ++num_pending_writers_;
+  readers_blocked_ = true;
+  // An upgrading reader keeps its read lock until the upgrade completes.
+  while (current_writer_ || pending_upgrade_ || getNumReaders() != 0) {
+    cv_readers_.wait(lock);
+  }
+  --num_pending_writers_;
+  current_writer_ = true;
+}
+
+void ScalableReaderWriterMutex::releaseWriteLock() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    current_writer_ = false;
+    updateReadersBlocked();
+    cv_readers_.notify_all();
+  }
+  cv_writer_finished_.notify_all();
+}
+
+// Attempt upgrade. If upgrade fails, relinquish read lock.
+bool ScalableReaderWriterMutex::upgradeToWriteLock() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (pending_upgrade_) {
+    --reader_slots_[getReaderSlotIndex()].num_readers;
+    cv_readers_.notify_all();
+    return false;
+  }
+  pending_upgrade_ = true;
+  readers_blocked_ = true;
+  // No writer can be active while this thread holds a read lock.
+  while (getNumReaders() > 1) {
+    cv_readers_.wait(lock);
+  }
+  --reader_slots_[getReaderSlotIndex()].num_readers;
+  pending_upgrade_ = false;
+  current_writer_ = true;
+  return true;
+}
+
+bool ScalableReaderWriterMutex::isInUse() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return pending_readers_ > 0u || getNumReaders() > 0 || num_pending_writers_ > 0u ||
+         current_writer_ || pending_upgrade_;
+}
+
+}  // namespace aslam
@@ -130,6 +130,20 @@ double Statistics::GetHz(size_t handle) {
 double Statistics::GetHz(std::string const& tag) {
   return GetHz(GetHandle(tag));
 }
+double Statistics::GetPercentile(size_t handle, double percentile) {
+  std::lock_guard<std::mutex> lock(Instance().mutex_);
+  return Instance().stats_collectors_[handle].Percentile(percentile);
+}
+double Statistics::GetPercentile(std::string const& tag, double percentile) {
+  return GetPercentile(GetHandle(tag), percentile);
+}
+LogHistogram Statistics::GetHistogram(size_t handle) {
+  std::lock_guard<std::mutex> lock(Instance().mutex_);
+  return Instance().stats_collectors_[handle].Histogram();
+}
+LogHistogram Statistics::GetHistogram(std::string const& tag) {
+  return GetHistogram(GetHandle(tag));
+}
 
 // Delta time statistics.
 double Statistics::GetMeanDeltaTime(std::string const& tag) {
@@ -194,8 +208,13 @@ std::string Statistics::SecondsToTimeString(double seconds) {
   return buffer;
 }
 
+Statistics::map_t Statistics::CopyTagMap() {
+  std::lock_guard<std::mutex> lock(Instance().mutex_);
+  return Instance().tag_map_;
+}
+
 void Statistics::Print(std::ostream& out) {  // NOLINT
-  const map_t& tag_map = Instance().tag_map_;
+  const map_t tag_map = CopyTagMap();
 
   if (tag_map.empty()) {
     return;
@@ -211,7 +230,8 @@ void Statistics::Print(std::ostream& out) {  // NOLINT
   out << "#\t";
   out << "Hz\t";
   out << "(avg     +- std    )\t";
-  out << "[min,max]\n";
+  out << "[min,max]\t";
+  out << "p50/p95/p99/p99.9\n";
 
   for (const typename map_t::value_type& t : tag_map) {
     size_t i = t.second;
@@ -232,16 +252,18 @@ void Statistics::Print(std::ostream& out) {  // NOLINT
       double min_value = GetMin(i);
       double max_value = GetMax(i);
 
-      out << "[" << min_value << "," << max_value << "]";
+      out << "[" << min_value << "," << max_value << "]\t";
+
+      const LogHistogram histogram = GetHistogram(i);
+      out << histogram.Percentile(50.0) << "/" << histogram.Percentile(95.0) << "/"
+          << histogram.Percentile(99.0) << "/" << histogram.Percentile(99.9);
     }
     out << std::endl;
   }
 }
 
 void Statistics::WriteToYamlFile(const std::string& path) {
-  const map_t& tag_map = Instance().tag_map_;
-
-  if (tag_map.empty()) {
+  if (CopyTagMap().empty()) {
     return;
   }
 
@@ -253,6 +275,11 @@ void Statistics::WriteToYamlFile(const std::string& path) {
   }
 
   VLOG(1) << "Writing statistics to file: " << path;
+  WriteToYaml(output_file);
+}
+
+void Statistics::WriteToYaml(std::ostream& output_file) {  // NOLINT
+  const map_t tag_map = CopyTagMap();
   for (const map_t::value_type& tag : tag_map) {
     const size_t index = tag.second;
 
@@ -270,6 +297,11 @@ void Statistics::WriteToYamlFile(const std::string& path) {
       output_file << "  stddev: " << sqrt(GetVariance(index)) << "\n";
       output_file << "  min: " << GetMin(index) << "\n";
       output_file << "  max: " << GetMax(index) << "\n";
+      const LogHistogram histogram = GetHistogram(index);
+      output_file << "  p50: " << histogram.Percentile(50.0) << "\n";
+      output_file << "  p95: " << histogram.Percentile(95.0) << "\n";
+      output_file << "  p99: " << histogram.Percentile(99.0) << "\n";
+      output_file << "  p99_9: " << histogram.Percentile(99.9) << "\n";
     }
     output_file << "\n";
   }
@@ -1,5 +1,6 @@
 #include <algorithm>
 
+#include <aslam/common/profiler.h>
 #include <aslam/common/thread-pool.h>
 
 namespace aslam {
@@ -25,6 +26,7 @@ ThreadPool::~ThreadPool() {
 }
 
 void ThreadPool::run() {
+  timing::Profiler::SetThreadName("aslam::ThreadPool worker");
   while (true) {
     std::unique_lock<std::mutex> lock(this->tasks_mutex_);
 
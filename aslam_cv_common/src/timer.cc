@@ -1,6 +1,8 @@
 #include "aslam/common/timer.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <fstream>  // NOLINT
 #include <math.h>
 #include <ostream>  //NOLINT
@@ -12,12 +14,220 @@ namespace timing {
 
 const double kNumSecondsPerNanosecond = 1.e-9;
 
+namespace internal {
+// The per-thread timer slots are allocated in chunks on first use so that they never move
+// while other threads read them.
+constexpr size_t kNumTimersPerChunk = 64u;
+constexpr size_t kMaxNumTimerChunks = 64u;
+constexpr size_t kMaxNumTimers = kNumTimersPerChunk * kMaxNumTimerChunks;
+// Number of recent samples the rate of a timer is computed from.
+constexpr size_t kRollingWindowSize = 100u;
+
+TimerSamples::TimerSamples()
+    : num_samples(0u),
+      mean(0.0),
+      sum_squared_deviations(0.0),
+      min(std::numeric_limits<double>::max()),
+      max(std::numeric_limits<double>::lowest()),
+      rolling_sum(0.0),
+      rolling_num_samples(0u) {}
+
+void TimerSamples::Add(double sample) {
+  // Welford's online algorithm.
+  ++num_samples;
+  const double delta = sample - mean;
+  mean += delta / num_samples;
+  sum_squared_deviations += delta * (sample - mean);
+  min = std::min(min, sample);
+  max = std::max(max, sample);
+}
+
+void TimerSamples::Merge(const TimerSamples& other) {
+  if (other.num_samples == 0u) {
+    return;
+  }
+  if (num_samples == 0u) {
+    *this = other;
+    return;
+  }
+  // Chan et al.'s parallel variance algorithm.
+  const size_t total_samples = num_samples + other.num_samples;
+  const double delta = other.mean - mean;
+  mean += delta * other.num_samples / total_samples;
+  sum_squared_deviations += other.sum_squared_deviations +
+      delta * delta * num_samples * other.num_samples / total_samples;
+  num_samples = total_samples;
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  rolling_sum += other.rolling_sum;
+  rolling_num_samples += other.rolling_num_samples;
+}
+
+double TimerSamples::Variance() const {
+  if (num_samples < 2u) {
+    return 0.0;
+  }
+  return sum_squared_deviations / (num_samples - 1u);
+}
+
+double TimerSamples::RollingMean() const {
+  if (rolling_num_samples == 0u) {
+    return 0.0;
+  }
+  return rolling_sum / rolling_num_samples;
+}
+
+// The samples of one timer in one thread. Only the owning thread writes, the query functions
+// read through a sequence lock. Samples of an older generation than the current one of Timing
+// were recorded before the last Reset and are dropped.
+class TimerSlot {
+ public:
+  TimerSlot() : sequence_(0u), generation_(0u) {
+    Store(TimerSamples());
+  }
+
+  void Add(double sample, size_t generation) {
+    const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    TimerSamples samples;
+    if (generation_.load(std::memory_order_relaxed) == generation) {
+      samples = Load();
+    } else {
+      generation_.store(generation, std::memory_order_relaxed);
+    }
+    // The window is only accessed by the owning thread, the readers only see its sum.
+    double& window_sample = window_[samples.num_samples % kRollingWindowSize];
+    if (samples.num_samples < kRollingWindowSize) {
+      ++samples.rolling_num_samples;
+    } else {
+      samples.rolling_sum -= window_sample;
+    }
+    samples.rolling_sum += sample;
+    window_sample = sample;
+    samples.Add(sample);
+    Store(samples);
+    sequence_.store(sequence + 2u, std::memory_order_release);
+  }
+
+  TimerSamples Read(size_t generation) const {
+    while (true) {
+      const uint32_t sequence_before = sequence_.load(std::memory_order_acquire);
+      if ((sequence_before & 1u) == 0u) {
+        const bool is_current = generation_.load(std::memory_order_relaxed) == generation;
+        const TimerSamples samples = Load();
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) == sequence_before) {
+          return is_current ? samples : TimerSamples();
+        }
+      }
+    }
+  }
+
+ private:
+  TimerSamples Load() const {
+    TimerSamples samples;
+    samples.num_samples = num_samples_.load(std::memory_order_relaxed);
+    samples.mean = mean_.load(std::memory_order_relaxed);
+    samples.sum_squared_deviations = sum_squared_deviations_.load(std::memory_order_relaxed);
+    samples.min = min_.load(std::memory_order_relaxed);
+    samples.max = max_.load(std::memory_order_relaxed);
+    samples.rolling_sum = rolling_sum_.load(std::memory_order_relaxed);
+    samples.rolling_num_samples = rolling_num_samples_.load(std::memory_order_relaxed);
+    return samples;
+  }
+
+  void Store(const TimerSamples& samples) {
+    num_samples_.store(samples.num_samples, std::memory_order_relaxed);
+    mean_.store(samples.mean, std::memory_order_relaxed);
+    sum_squared_deviations_.store(samples.sum_squared_deviations, std::memory_order_relaxed);
+    min_.store(samples.min, std::memory_order_relaxed);
+    max_.store(samples.max, std::memory_order_relaxed);
+    rolling_sum_.store(samples.rolling_sum, std::memory_order_relaxed);
+    rolling_num_samples_.store(samples.rolling_num_samples, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint32_t> sequence_;
+  std::atomic<size_t> generation_;
+  std::atomic<size_t> num_samples_;
+  std::atomic<double> mean_;
+  std::atomic<double> sum_squared_deviations_;
+  std::atomic<double> min_;
+  std::atomic<double> max_;
+  std::atomic<double> rolling_sum_;
+  std::atomic<size_t> rolling_num_samples_;
+  std::array<double, kRollingWindowSize> window_;
+};
+
+class ThreadTimerBuffer {
+ public:
+  ThreadTimerBuffer() {
+    for (std::atomic<TimerSlot*>& chunk : chunks_) {
+      chunk.store(nullptr, std::memory_order_relaxed);
+    }
+    Timing& timing = Timing::Instance();
+    std::lock_guard<std::mutex> lock(timing.mutex_);
+    timing.thread_buffers_.push_back(this);
+  }
+
+  ~ThreadTimerBuffer() {
+    Timing& timing = Timing::Instance();
+    {
+      // Hand the samples over to the global timing before the thread goes away.
+      std::lock_guard<std::mutex> lock(timing.mutex_);
+      timing.finished_thread_samples_.resize(timing.num_handles_);
+      for (size_t handle = 0u; handle < timing.num_handles_; ++handle) {
+        TimerSamples samples;
+        if (Read(handle, &samples)) {
+          timing.finished_thread_samples_[handle].Merge(samples);
+        }
+      }
+      timing.thread_buffers_.erase(
+          std::remove(timing.thread_buffers_.begin(), timing.thread_buffers_.end(), this),
+          timing.thread_buffers_.end());
+    }
+    for (std::atomic<TimerSlot*>& chunk : chunks_) {
+      delete[] chunk.load(std::memory_order_relaxed);
+    }
+  }
+
+  void Add(size_t handle, double seconds, size_t generation) {
+    CHECK_LT(handle, kMaxNumTimers);
+    std::atomic<TimerSlot*>& chunk = chunks_[handle / kNumTimersPerChunk];
+    TimerSlot* slots = chunk.load(std::memory_order_relaxed);
+    if (slots == nullptr) {
+      slots = new TimerSlot[kNumTimersPerChunk];
+      chunk.store(slots, std::memory_order_release);
+    }
+    slots[handle % kNumTimersPerChunk].Add(seconds, generation);
+  }
+
+  // Returns false if this thread has never used a timer of this chunk. Must be called with
+  // the timing mutex held such that the generation does not change.
+  bool Read(size_t handle, TimerSamples* samples) const {
+    CHECK_NOTNULL(samples);
+    CHECK_LT(handle, kMaxNumTimers);
+    const TimerSlot* slots =
+        chunks_[handle / kNumTimersPerChunk].load(std::memory_order_acquire);
+    if (slots == nullptr) {
+      return false;
+    }
+    *samples = slots[handle % kNumTimersPerChunk].Read(
+        Timing::Instance().generation_.load(std::memory_order_relaxed));
+    return true;
+  }
+
+ private:
+  std::array<std::atomic<TimerSlot*>, kMaxNumTimerChunks> chunks_;
+};
+}  // namespace internal
+
 Timing& Timing::Instance() {
   static Timing t;
   return t;
 }
 
-Timing::Timing() : max_tag_length_(0u) {}
+Timing::Timing() : generation_(0u), num_handles_(0u), max_tag_length_(0u) {}
 
 Timing::~Timing() {}
 
@@ -28,9 +238,10 @@ size_t Timing::GetHandle(const std::string& tag) {
   map_t::iterator tag_iterator = Instance().tag_map_.find(tag);
   if (tag_iterator == Instance().tag_map_.end()) {
     // If it is not there, create a tag.
-    size_t handle = Instance().timers_.size();
+    CHECK_LT(Instance().num_handles_, internal::kMaxNumTimers)
+        << "Too many timers, can not register timer " << tag;
+    size_t handle = Instance().num_handles_++;
     Instance().tag_map_[tag] = handle;
-    Instance().timers_.push_back(statistics::StatisticsMapValue());
     // Track the maximum tag length to help printing a table of timing values
     // later.
     Instance().max_tag_length_ =
@@ -55,34 +266,41 @@ std::string Timing::GetTag(size_t handle) {
 }
 
 // Class functions used for timing.
-TimerImpl::TimerImpl(const std::string& tag, bool construct_stopped)
-    : is_timing_(false), handle_(Timing::GetHandle(tag)), tag_(tag) {
+TimerImpl::TimerImpl(size_t handle, bool construct_stopped)
+    : is_timing_(false), handle_(handle) {
   if (!construct_stopped) {
     Start();
   }
 }
 
+TimerImpl::TimerImpl(const std::string& tag, bool construct_stopped)
+    : TimerImpl(Timing::GetHandle(tag), construct_stopped) {}
+
 TimerImpl::~TimerImpl() {
   if (IsTiming()) {
     Stop();
   }
 }
 
+size_t TimerImpl::RegisterTag(const std::string& tag) {
+  return Timing::GetHandle(tag);
+}
+
 void TimerImpl::Start() {
   is_timing_ = true;
-  time_ = std::chrono::system_clock::now();
+  time_ = std::chrono::steady_clock::now();
 }
 
 double TimerImpl::Stop() {
   if (is_timing_) {
-    std::chrono::time_point<std::chrono::system_clock> now =
-        std::chrono::system_clock::now();
+    std::chrono::time_point<std::chrono::steady_clock> now =
+        std::chrono::steady_clock::now();
     double dt =
         static_cast<double>(
             std::chrono::duration_cast<std::chrono::nanoseconds>(now - time_)
                 .count()) *
         kNumSecondsPerNanosecond;
-    Timing::Instance().AddTime(handle_, dt);
+    Timing::AddTime(handle_, dt);
     is_timing_ = false;
     return dt;
   }
@@ -102,13 +320,30 @@ size_t TimerImpl::GetHandle() const {
 }
 
 void Timing::AddTime(size_t handle, double seconds) {
+  static thread_local internal::ThreadTimerBuffer thread_buffer;
+  thread_buffer.Add(
+      handle, seconds, Instance().generation_.load(std::memory_order_relaxed));
+}
+
+internal::TimerSamples Timing::GetSamples(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
-  timers_[handle].AddValue(seconds);
+  CHECK_LT(handle, Instance().num_handles_) << "Unknown timer handle.";
+  internal::TimerSamples samples;
+  if (handle < Instance().finished_thread_samples_.size()) {
+    samples = Instance().finished_thread_samples_[handle];
+  }
+  for (const internal::ThreadTimerBuffer* thread_buffer : Instance().thread_buffers_) {
+    internal::TimerSamples thread_samples;
+    if (thread_buffer->Read(handle, &thread_samples)) {
+      samples.Merge(thread_samples);
+    }
+  }
+  return samples;
 }
 
 double Timing::GetTotalSeconds(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().timers_[handle].Sum();
+  const internal::TimerSamples samples = GetSamples(handle);
+  return samples.mean * samples.num_samples;
 }
 
 double Timing::GetTotalSeconds(const std::string& tag) {
@@ -116,8 +351,7 @@ double Timing::GetTotalSeconds(const std::string& tag) {
 }
 
 double Timing::GetMeanSeconds(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().timers_[handle].Mean();
+  return GetSamples(handle).mean;
 }
 
 double Timing::GetMeanSeconds(const std::string& tag) {
@@ -125,8 +359,7 @@ double Timing::GetMeanSeconds(const std::string& tag) {
 }
 
 size_t Timing::GetNumSamples(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().timers_[handle].TotalSamples();
+  return GetSamples(handle).num_samples;
 }
 
 size_t Timing::GetNumSamples(const std::string& tag) {
@@ -134,8 +367,7 @@ size_t Timing::GetNumSamples(const std::string& tag) {
 }
 
 double Timing::GetVarianceSeconds(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().timers_[handle].LazyVariance();
+  return GetSamples(handle).Variance();
 }
 
 double Timing::GetVarianceSeconds(const std::string& tag) {
@@ -143,8 +375,7 @@ double Timing::GetVarianceSeconds(const std::string& tag) {
 }
 
 double Timing::GetMinSeconds(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().timers_[handle].Min();
+  return GetSamples(handle).min;
 }
 
 double Timing::GetMinSeconds(const std::string& tag) {
@@ -152,8 +383,7 @@ double Timing::GetMinSeconds(const std::string& tag) {
 }
 
 double Timing::GetMaxSeconds(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().timers_[handle].Max();
+  return GetSamples(handle).max;
 }
 
 double Timing::GetMaxSeconds(const std::string& tag) {
@@ -161,8 +391,7 @@ double Timing::GetMaxSeconds(const std::string& tag) {
 }
 
 double Timing::GetHz(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return 1.0 / Instance().timers_[handle].RollingMean();
+  return 1.0 / GetSamples(handle).RollingMean();
 }
 
 double Timing::GetHz(const std::string& tag) {
@@ -185,10 +414,13 @@ std::string Timing::SecondsToTimeString(double seconds) {
   return buffer;
 }
 
-void Timing::WriteToYamlFile(const std::string& path) {
-  const map_t& tag_map = Instance().tag_map_;
+Timing::map_t Timing::CopyTagMap() {
+  std::lock_guard<std::mutex> lock(Instance().mutex_);
+  return Instance().tag_map_;
+}
 
-  if (tag_map.empty()) {
+void Timing::WriteToYamlFile(const std::string& path) {
+  if (CopyTagMap().empty()) {
     return;
   }
 
@@ -200,10 +432,15 @@ void Timing::WriteToYamlFile(const std::string& path) {
   }
 
   VLOG(1) << "Writing timing to file: " << path;
+  WriteToYaml(output_file);
+}
+
+void Timing::WriteToYaml(std::ostream& output_file) {  // NOLINT
+  const map_t tag_map = CopyTagMap();
   for (const map_t::value_type& tag : tag_map) {
-    const size_t index = tag.second;
+    const internal::TimerSamples samples = GetSamples(tag.second);
 
-    if (GetNumSamples(index) > 0) {
+    if (samples.num_samples > 0) {
       std::string label = tag.first;
 
       // We do not want colons or hashes in a label, as they might interfere
@@ -212,23 +449,19 @@ void Timing::WriteToYamlFile(const std::string& path) {
       std::replace(label.begin(), label.end(), '#', '_');
 
       output_file << label << ":" << "\n";
-      output_file << "  num_samples: " << GetNumSamples(index) << "\n";
-      output_file << "  total: " << GetTotalSeconds(index) << "\n";
-      output_file << "  mean: " << GetMeanSeconds(index) << "\n";
-      output_file << "  std_dev: " << sqrt(GetVarianceSeconds(index)) << "\n";
-      output_file << "  min: " << GetMinSeconds(index) << "\n";
-      output_file << "  max: " << GetMaxSeconds(index) << "\n";
+      output_file << "  num_samples: " << samples.num_samples << "\n";
+      output_file << "  total: " << samples.mean * samples.num_samples << "\n";
+      output_file << "  mean: " << samples.mean << "\n";
+      output_file << "  std_dev: " << sqrt(samples.Variance()) << "\n";
+      output_file << "  min: " << samples.min << "\n";
+      output_file << "  max: " << samples.max << "\n";
     }
     output_file << "\n";
   }
 }
 
 void Timing::Print(std::ostream& out) {  // NOLINT
-  map_t tagMap;
-  {
-    std::lock_guard<std::mutex> lock(Instance().mutex_);
-    tagMap = Instance().tag_map_;
-  }
+  const map_t tagMap = CopyTagMap();
 
   if (tagMap.empty()) {
     return;
@@ -237,23 +470,23 @@ void Timing::Print(std::ostream& out) {  // NOLINT
   out << "SM Timing\n";
   out << "-----------\n";
   for (typename map_t::value_type t : tagMap) {
-    size_t time_i = t.second;
+    const internal::TimerSamples samples = GetSamples(t.second);
     out.width((std::streamsize)Instance().max_tag_length_);
     out.setf(std::ios::left, std::ios::adjustfield);
     out << t.first << "\t";
     out.width(7);
 
     out.setf(std::ios::right, std::ios::adjustfield);
-    out << GetNumSamples(time_i) << "\t";
-    if (GetNumSamples(time_i) > 0) {
-      out << SecondsToTimeString(GetTotalSeconds(time_i)) << "\t";
-      double meansec = GetMeanSeconds(time_i);
-      double stddev = sqrt(GetVarianceSeconds(time_i));
+    out << samples.num_samples << "\t";
+    if (samples.num_samples > 0) {
+      out << SecondsToTimeString(samples.mean * samples.num_samples) << "\t";
+      double meansec = samples.mean;
+      double stddev = sqrt(samples.Variance());
       out << "(" << SecondsToTimeString(meansec) << " +- ";
       out << SecondsToTimeString(stddev) << ")\t";
 
-      double min_sec = GetMinSeconds(time_i);
-      double max_sec = GetMaxSeconds(time_i);
+      double min_sec = samples.min;
+      double max_sec = samples.max;
 
       // The min or max are out of bounds.
       out << "[" << SecondsToTimeString(min_sec) << ","
@@ -271,7 +504,10 @@ std::string Timing::Print() {
 
 void Timing::Reset() {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
-  Instance().tag_map_.clear();
+  // The thread buffers are written without locking, so their samples are invalidated by
+  // the generation instead of being cleared here.
+  Instance().generation_.fetch_add(1u, std::memory_order_relaxed);
+  Instance().finished_thread_samples_.clear();
 }
 
 }  // namespace timing
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <thread>
@@ -13,33 +16,132 @@ constexpr int kNumThreads = 20;
 
 namespace aslam {
 
-TEST_F(ReaderWriterMutexFixture, ReaderWriterLock) {
+typedef ::testing::Types<ReaderWriterMutex, ScalableReaderWriterMutex> MutexTypes;
+TYPED_TEST_CASE(ReaderWriterMutexFixture, MutexTypes);
+
+TYPED_TEST(ReaderWriterMutexFixture, ReaderWriterLock) {
   aslam::ReaderWriterMutex mutex;
   std::vector<std::thread> threads;
   for (int i = 0; i < kNumThreads; ++i) {
-    threads.emplace_back([this]() { reader(); });
-    threads.emplace_back([this]() { writer(); });
+    threads.emplace_back([this]() { this->reader(); });
+    threads.emplace_back([this]() { this->writer(); });
   }
   for (std::thread& thread : threads) {
     thread.join();
   }
-  EXPECT_EQ(0, value() % kMagicNumber);
+  EXPECT_EQ(0, this->value() % kMagicNumber);
 }
 
-TEST_F(ReaderWriterMutexFixture, UpgradeReaderLock) {
+TYPED_TEST(ReaderWriterMutexFixture, UpgradeReaderLock) {
   std::vector<std::thread> threads;
   for (int i = 0; i < kNumThreads; ++i) {
-    threads.emplace_back([this]() { delayedReader(); });
-    threads.emplace_back([this]() { readerUpgrade(); });
+    threads.emplace_back([this]() { this->delayedReader(); });
+    threads.emplace_back([this]() { this->readerUpgrade(); });
   }
   for (std::thread& thread : threads) {
     thread.join();
   }
-  VLOG(3) << "Number of writes after upgrade: " << num_writes();
-  VLOG(3) << "Number of failed upgrades: " << num_upgrade_failures();
-  EXPECT_NE(0, value());
-  EXPECT_NE(0, num_writes());
-  EXPECT_EQ(value(), num_writes() * kMagicNumber);
+  VLOG(3) << "Number of writes after upgrade: " << this->num_writes();
+  VLOG(3) << "Number of failed upgrades: " << this->num_upgrade_failures();
+  EXPECT_NE(0, this->value());
+  EXPECT_NE(0, this->num_writes());
+  EXPECT_EQ(this->value(), this->num_writes() * kMagicNumber);
+}
+
+TYPED_TEST(ReaderWriterMutexFixture, IsInUse) {
+  TypeParam mutex;
+  EXPECT_FALSE(mutex.isInUse());
+  {
+    ScopedReadLock lock(&mutex);
+    EXPECT_TRUE(mutex.isInUse());
+  }
+  EXPECT_FALSE(mutex.isInUse());
+  {
+    ScopedWriteLock lock(&mutex);
+    EXPECT_TRUE(mutex.isInUse());
+  }
+  EXPECT_FALSE(mutex.isInUse());
+}
+
+// Read-mostly contention: every thread takes short read locks and every kWriteInterval-th
+// lock is a write lock. The writers update two values that readers must always see equal.
+TYPED_TEST(ReaderWriterMutexFixture, ReadMostlyContention) {
+  constexpr int kNumContendingThreads = 4;
+  constexpr int kNumLocksPerThread = 10000;
+  constexpr int kWriteInterval = 100;
+
+  TypeParam mutex;
+  int first_value = 0;
+  int second_value = 0;
+  std::atomic<int> num_inconsistent_reads(0);
+  std::vector<std::thread> threads;
+  for (int thread_idx = 0; thread_idx < kNumContendingThreads; ++thread_idx) {
+    threads.emplace_back([&]() {
+      for (int i = 1; i <= kNumLocksPerThread; ++i) {
+        if (i % kWriteInterval == 0) {
+          ScopedWriteLock lock(&mutex);
+          ++first_value;
+          ++second_value;
+        } else {
+          ScopedReadLock lock(&mutex);
+          if (first_value != second_value) {
+            ++num_inconsistent_reads;
+          }
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, num_inconsistent_reads);
+  EXPECT_EQ(kNumContendingThreads * (kNumLocksPerThread / kWriteInterval), first_value);
+  EXPECT_EQ(first_value, second_value);
+  EXPECT_FALSE(mutex.isInUse());
+}
+
+// Read-mostly contention benchmark: every thread takes short read locks and every
+// kWriteInterval-th lock is a write lock. Reports the lock throughput, which for the
+// scalable mutex should grow with the number of threads instead of collapsing. Disabled so
+// that it does not run with the unit tests, run it with --gtest_also_run_disabled_tests.
+TYPED_TEST(ReaderWriterMutexFixture, DISABLED_ReadMostlyContentionBenchmark) {
+  constexpr int kNumLocksPerThread = 100000;
+  constexpr int kWriteInterval = 1000;
+  const int max_num_threads =
+      std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+
+  for (int num_threads = 1; num_threads <= max_num_threads; num_threads *= 2) {
+    TypeParam mutex;
+    int shared_value = 0;
+    std::atomic<int64_t> read_checksum(0);
+    std::vector<std::thread> threads;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int thread_idx = 0; thread_idx < num_threads; ++thread_idx) {
+      threads.emplace_back([&mutex, &shared_value, &read_checksum]() {
+        int64_t local_checksum = 0;
+        for (int i = 1; i <= kNumLocksPerThread; ++i) {
+          if (i % kWriteInterval == 0) {
+            ScopedWriteLock lock(&mutex);
+            ++shared_value;
+          } else {
+            ScopedReadLock lock(&mutex);
+            local_checksum += shared_value;
+          }
+        }
+        read_checksum += local_checksum;
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(num_threads * (kNumLocksPerThread / kWriteInterval), shared_value);
+    EXPECT_GE(read_checksum, 0);
+    LOG(INFO) << ::testing::UnitTest::GetInstance()->current_test_info()->type_param()
+              << " with " << num_threads << " threads: "
+              << num_threads * kNumLocksPerThread / seconds / 1e6 << " million locks/s";
+  }
 }
 
 }  // namespace aslam
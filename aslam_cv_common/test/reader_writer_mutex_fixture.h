@@ -6,12 +6,14 @@
 
 #include <gtest/gtest.h>
 #include <aslam/common/reader-writer-lock.h>
+#include <aslam/common/scalable-reader-writer-lock.h>
 
 constexpr int kMagicNumber = 29845;
 constexpr int kNumCycles = 1000;
 
 namespace aslam {
 
+template <typename MutexType>
 class ReaderWriterMutexFixture : public ::testing::Test {
  private:
   int value_;
@@ -30,7 +32,7 @@ class ReaderWriterMutexFixture : public ::testing::Test {
   int num_writes() { return num_writes_; }
   int num_upgrade_failures() { return num_upgrade_failures_; }
 
-  ReaderWriterMutex value_mutex_;
+  MutexType value_mutex_;
 };
 
 }  // namespace aslam
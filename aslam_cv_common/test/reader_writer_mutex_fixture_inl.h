@@ -7,28 +7,32 @@
 
 namespace aslam {
 
-void ReaderWriterMutexFixture::SetUp() {
+template <typename MutexType>
+void ReaderWriterMutexFixture<MutexType>::SetUp() {
   ::testing::Test::SetUp();
   value_ = 0;
   num_writes_ = 0;
   num_upgrade_failures_ = 0;
 }
 
-void ReaderWriterMutexFixture::reader() {
+template <typename MutexType>
+void ReaderWriterMutexFixture<MutexType>::reader() {
   for (int i = 0; i < kNumCycles; ++i) {
     aslam::ScopedReadLock lock(&value_mutex_);
     EXPECT_EQ(0, value_ % kMagicNumber);
   }
 }
 
-void ReaderWriterMutexFixture::writer() {
+template <typename MutexType>
+void ReaderWriterMutexFixture<MutexType>::writer() {
   for (int i = 0; i < kNumCycles; ++i) {
     aslam::ScopedWriteLock lock(&value_mutex_);
     value_ = i * kMagicNumber;
   }
 }
 
-void ReaderWriterMutexFixture::delayedReader() {
+template <typename MutexType>
+void ReaderWriterMutexFixture<MutexType>::delayedReader() {
   for (int i = 0; i < kNumCycles; ++i) {
     value_mutex_.acquireReadLock();
     usleep(5);
@@ -37,7 +41,8 @@ void ReaderWriterMutexFixture::delayedReader() {
   }
 }
 
-void ReaderWriterMutexFixture::readerUpgrade() {
+template <typename MutexType>
+void ReaderWriterMutexFixture<MutexType>::readerUpgrade() {
   for (int i = 0; i < kNumCycles; ++i) {
     value_mutex_.acquireReadLock();
     EXPECT_EQ(0, value_ % kMagicNumber);
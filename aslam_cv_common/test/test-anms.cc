@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <aslam/common/entrypoint.h>
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+#include <opencv2/core/core.hpp>
+
+#include "aslam/common/anms.h"
+
+namespace {
+constexpr double kImageWidth = 640.0;
+constexpr double kImageHeight = 480.0;
+
+void createUniformKeypoints(
+    size_t num_keypoints, std::mt19937* generator, Eigen::Matrix2Xd* keypoints,
+    Eigen::VectorXd* scores) {
+  std::uniform_real_distribution<double> x_distribution(0.0, kImageWidth);
+  std::uniform_real_distribution<double> y_distribution(0.0, kImageHeight);
+  std::uniform_real_distribution<double> score_distribution(0.0, 1.0);
+  keypoints->resize(2, num_keypoints);
+  scores->resize(num_keypoints);
+  for (size_t i = 0u; i < num_keypoints; ++i) {
+    (*keypoints)(0, i) = x_distribution(*generator);
+    (*keypoints)(1, i) = y_distribution(*generator);
+    (*scores)(i) = score_distribution(*generator);
+  }
+}
+
+double minPairwiseDistance(
+    const Eigen::Matrix2Xd& keypoints, const std::vector<size_t>& indices) {
+  double min_distance = std::numeric_limits<double>::max();
+  for (size_t i = 0u; i < indices.size(); ++i) {
+    for (size_t j = i + 1u; j < indices.size(); ++j) {
+      min_distance = std::min(
+          min_distance, (keypoints.col(indices[i]) - keypoints.col(indices[j])).norm());
+    }
+  }
+  return min_distance;
+}
+
+void expectSortedByDecreasingScore(
+    const Eigen::VectorXd& scores, const std::vector<size_t>& indices) {
+  for (size_t i = 1u; i < indices.size(); ++i) {
+    EXPECT_GE(scores(indices[i - 1u]), scores(indices[i]));
+  }
+}
+
+const aslam::common::AnmsMethod kMethods[] = {
+    aslam::common::AnmsMethod::kRadius, aslam::common::AnmsMethod::kGrid};
+}  // namespace
+
+TEST(Anms, ReturnsAllKeypointsIfNotMoreThanRequested) {
+  std::mt19937 generator(42u);
+  Eigen::Matrix2Xd keypoints;
+  Eigen::VectorXd scores;
+  createUniformKeypoints(20u, &generator, &keypoints, &scores);
+
+  for (const aslam::common::AnmsMethod method : kMethods) {
+    std::vector<size_t> selected_indices;
+    aslam::common::selectKeypointsAnms(keypoints, scores, 20u, method, &selected_indices);
+    ASSERT_EQ(selected_indices.size(), 20u);
+    expectSortedByDecreasingScore(scores, selected_indices);
+    std::vector<size_t> sorted_indices = selected_indices;
+    std::sort(sorted_indices.begin(), sorted_indices.end());
+    for (size_t i = 0u; i < sorted_indices.size(); ++i) {
+      EXPECT_EQ(sorted_indices[i], i);
+    }
+
+    aslam::common::selectKeypointsAnms(keypoints, scores, 0u, method, &selected_indices);
+    EXPECT_TRUE(selected_indices.empty());
+  }
+}
+
+TEST(Anms, SelectsRequestedNumberOfKeypoints) {
+  std::mt19937 generator(42u);
+  Eigen::Matrix2Xd keypoints;
+  Eigen::VectorXd scores;
+  createUniformKeypoints(2000u, &generator, &keypoints, &scores);
+
+  for (const aslam::common::AnmsMethod method : kMethods) {
+    for (const size_t num_to_select : {1u, 7u, 100u, 500u, 1999u}) {
+      std::vector<size_t> selected_indices;
+      aslam::common::selectKeypointsAnms(
+          keypoints, scores, num_to_select, method, &selected_indices);
+      ASSERT_EQ(selected_indices.size(), num_to_select);
+      expectSortedByDecreasingScore(scores, selected_indices);
+      std::vector<size_t> unique_indices = selected_indices;
+      std::sort(unique_indices.begin(), unique_indices.end());
+      EXPECT_TRUE(
+          std::unique(unique_indices.begin(), unique_indices.end()) == unique_indices.end());
+    }
+  }
+}
+
+TEST(Anms, SpreadsKeypointsOverTheImage) {
+  std::mt19937 generator(42u);
+  Eigen::Matrix2Xd keypoints;
+  Eigen::VectorXd scores;
+  createUniformKeypoints(2000u, &generator, &keypoints, &scores);
+
+  static constexpr size_t kNumToSelect = 100u;
+  std::vector<size_t> strongest_indices(keypoints.cols());
+  for (size_t i = 0u; i < strongest_indices.size(); ++i) {
+    strongest_indices[i] = i;
+  }
+  std::sort(
+      strongest_indices.begin(), strongest_indices.end(),
+      [&scores](size_t lhs, size_t rhs) { return scores(lhs) > scores(rhs); });
+  strongest_indices.resize(kNumToSelect);
+
+  // The radius suppression keeps the selected keypoints at a distance close to the spacing of
+  // a regular grid with the requested number of keypoints, about 55 pixels.
+  std::vector<size_t> selected_indices;
+  aslam::common::selectKeypointsAnms(
+      keypoints, scores, kNumToSelect, aslam::common::AnmsMethod::kRadius, &selected_indices);
+  EXPECT_GT(minPairwiseDistance(keypoints, selected_indices), 25.0);
+  EXPECT_GT(
+      minPairwiseDistance(keypoints, selected_indices),
+      2.0 * minPairwiseDistance(keypoints, strongest_indices));
+}
+
+TEST(Anms, SuppressesClusteredStrongKeypoints) {
+  std::mt19937 generator(42u);
+  Eigen::Matrix2Xd weak_keypoints;
+  Eigen::VectorXd weak_scores;
+  createUniformKeypoints(400u, &generator, &weak_keypoints, &weak_scores);
+
+  // A cluster of strong keypoints in a corner of the image.
+  static constexpr size_t kNumClusteredKeypoints = 100u;
+  std::uniform_real_distribution<double> cluster_distribution(0.0, 10.0);
+  Eigen::Matrix2Xd keypoints(2, kNumClusteredKeypoints + weak_keypoints.cols());
+  Eigen::VectorXd scores(keypoints.cols());
+  for (size_t i = 0u; i < kNumClusteredKeypoints; ++i) {
+    keypoints(0, i) = cluster_distribution(generator);
+    keypoints(1, i) = cluster_distribution(generator);
+    scores(i) = 2.0 + static_cast<double>(i);
+  }
+  keypoints.rightCols(weak_keypoints.cols()) = weak_keypoints;
+  scores.tail(weak_scores.size()) = weak_scores;
+
+  for (const aslam::common::AnmsMethod method : kMethods) {
+    std::vector<size_t> selected_indices;
+    aslam::common::selectKeypointsAnms(keypoints, scores, 50u, method, &selected_indices);
+    ASSERT_EQ(selected_indices.size(), 50u);
+    // The strongest keypoint overall is always kept.
+    EXPECT_EQ(selected_indices.front(), kNumClusteredKeypoints - 1u);
+    const size_t num_selected_in_cluster = std::count_if(
+        selected_indices.begin(), selected_indices.end(),
+        [](size_t index) { return index < kNumClusteredKeypoints; });
+    EXPECT_LE(num_selected_in_cluster, 2u);
+  }
+}
+
+TEST(Anms, FiltersOpenCvKeypoints) {
+  std::mt19937 generator(42u);
+  Eigen::Matrix2Xd keypoints;
+  Eigen::VectorXd scores;
+  createUniformKeypoints(500u, &generator, &keypoints, &scores);
+  std::vector<cv::KeyPoint> cv_keypoints;
+  for (int i = 0; i < keypoints.cols(); ++i) {
+    cv_keypoints.emplace_back(
+        static_cast<float>(keypoints(0, i)), static_cast<float>(keypoints(1, i)), 1.0f, -1.0f,
+        static_cast<float>(scores(i)), 0, i);
+  }
+
+  // The OpenCV keypoints store single precision.
+  const Eigen::Matrix2Xd rounded_keypoints = keypoints.cast<float>().cast<double>();
+  const Eigen::VectorXd rounded_scores = scores.cast<float>().cast<double>();
+
+  for (const aslam::common::AnmsMethod method : kMethods) {
+    std::vector<size_t> selected_indices;
+    aslam::common::selectKeypointsAnms(
+        rounded_keypoints, rounded_scores, 50u, method, &selected_indices);
+    std::vector<cv::KeyPoint> selected_keypoints = cv_keypoints;
+    aslam::common::selectKeypointsAnms(50u, method, &selected_keypoints);
+    ASSERT_EQ(selected_keypoints.size(), selected_indices.size());
+    for (size_t i = 0u; i < selected_indices.size(); ++i) {
+      EXPECT_EQ(selected_keypoints[i].class_id, static_cast<int>(selected_indices[i]));
+    }
+  }
+}
+
+TEST(Anms, MismatchingScoresDie) {
+  std::vector<size_t> selected_indices;
+  EXPECT_DEATH(
+      aslam::common::selectKeypointsAnms(
+          Eigen::Matrix2Xd::Zero(2, 3), Eigen::VectorXd::Zero(2), 1u,
+          aslam::common::AnmsMethod::kGrid, &selected_indices),
+      "^");
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -1,3 +1,11 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <eigen-checks/gtest.h>
 #include <gtest/gtest.h>
 
@@ -6,6 +14,25 @@
 
 DECLARE_CHANNEL(TEST, Eigen::Matrix2Xd)
 
+namespace {
+// Channel whose clone waits until it is released, which holds a detaching writer inside the
+// group lock.
+class BlockingCloneChannel : public aslam::channels::Channel<int> {
+ public:
+  BlockingCloneChannel(const std::shared_future<void>& released, std::atomic<bool>* clone_started)
+      : released_(released), clone_started_(clone_started) {}
+  virtual aslam::channels::ChannelBase* clone() const {
+    *clone_started_ = true;
+    released_.wait();
+    return new aslam::channels::Channel<int>(*this);
+  }
+
+ private:
+  std::shared_future<void> released_;
+  std::atomic<bool>* clone_started_;
+};
+}  // namespace
+
 TEST(Channel, FailUnavailableChannel) {
 aslam::channels::ChannelGroup channels;
 EXPECT_DEATH(aslam::channels::get_TEST_Data(channels), "^");
@@ -35,13 +62,90 @@ EXPECT_TRUE(aslam::channels::has_TEST_Channel(channels));
 TEST(Channel, SetRetrieveChannel) {
 aslam::channels::ChannelGroup channels;
 aslam::channels::add_TEST_Channel(&channels);
-Eigen::Matrix2Xd& data = aslam::channels::get_TEST_Data(channels);
+Eigen::Matrix2Xd& data = aslam::channels::get_TEST_DataMutable(&channels);
 data.resize(Eigen::NoChange, 3);
 data.setRandom();
 Eigen::Matrix2Xd data2 = data;
-Eigen::Matrix2Xd& data3 = aslam::channels::get_TEST_Data(channels);
+const Eigen::Matrix2Xd& data3 = aslam::channels::get_TEST_Data(channels);
 EXPECT_TRUE(EIGEN_MATRIX_NEAR(data3, data2, 1e-8));
 }
 
+TEST(Channel, ShareChannelGroupCopyOnWrite) {
+aslam::channels::ChannelGroup channels;
+aslam::channels::add_TEST_Channel(&channels);
+Eigen::Matrix2Xd& data = aslam::channels::get_TEST_DataMutable(&channels);
+data.setRandom(2, 3);
+const Eigen::Matrix2Xd data_original = data;
+
+aslam::channels::ChannelGroup shared;
+shared = aslam::channels::shareChannelGroup(channels);
+EXPECT_EQ(&data, &aslam::channels::get_TEST_Data(shared));
+
+Eigen::Matrix2Xd& shared_data = aslam::channels::get_TEST_DataMutable(&shared);
+EXPECT_NE(&data, &shared_data);
+shared_data.setZero();
+EXPECT_TRUE(EIGEN_MATRIX_NEAR(data, data_original, 0.0));
+EXPECT_EQ(&data, &aslam::channels::get_TEST_DataMutable(&channels));
+}
+
+TEST(Channel, ConcurrentReadersWhileAddingChannels) {
+aslam::channels::ChannelGroup channels;
+aslam::channels::add_TEST_Channel(&channels).setOnes(2, 10);
+
+constexpr size_t kNumReaders = 4u;
+constexpr size_t kNumAddedChannels = 100u;
+std::atomic<bool> done(false);
+std::atomic<bool> failed(false);
+std::vector<std::thread> readers;
+for (size_t i = 0u; i < kNumReaders; ++i) {
+  readers.emplace_back([&]() {
+    while (!done) {
+      if (!aslam::channels::has_TEST_Channel(channels) ||
+          aslam::channels::get_TEST_Data(channels).cols() != 10) {
+        failed = true;
+      }
+    }
+  });
+}
+for (size_t i = 0u; i < kNumAddedChannels; ++i) {
+  aslam::channels::addChannel<int>("INT_" + std::to_string(i), &channels) = i;
+}
+done = true;
+for (std::thread& reader : readers) {
+  reader.join();
+}
+EXPECT_FALSE(failed);
+for (size_t i = 0u; i < kNumAddedChannels; ++i) {
+  EXPECT_EQ(static_cast<int>(i),
+            aslam::channels::getChannelData<int>("INT_" + std::to_string(i), channels));
+}
+}
+
+TEST(Channel, ReadersDoNotWaitForWriters) {
+aslam::channels::ChannelGroup channels;
+std::promise<void> release;
+std::atomic<bool> clone_started(false);
+ASSERT_TRUE(channels.addChannel("BLOCKING", std::make_shared<BlockingCloneChannel>(
+    release.get_future().share(), &clone_started)));
+aslam::channels::ChannelGroup shared = aslam::channels::shareChannelGroup(channels);
+
+// Detaching the shared channel clones it while holding the group lock.
+std::thread writer([&channels]() {
+  EXPECT_TRUE(channels.getChannelMutable("BLOCKING") != nullptr);
+});
+while (!clone_started) {
+  std::this_thread::yield();
+}
+std::future<bool> read = std::async(std::launch::async, [&channels]() {
+  return channels.hasChannel("BLOCKING") && channels.getChannel("OTHER") == nullptr;
+});
+const bool read_finished = read.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+release.set_value();
+writer.join();
+ASSERT_TRUE(read_finished);
+EXPECT_TRUE(read.get());
+EXPECT_NE(channels.getChannel("BLOCKING"), shared.getChannel("BLOCKING"));
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
 
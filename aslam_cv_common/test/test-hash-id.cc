@@ -1,5 +1,8 @@
 #include <algorithm>
+#include <mutex>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -49,4 +52,43 @@ TEST(HashIdTest, StdHash) {
   EXPECT_EQ(*found, needle);
 }
 
+TEST(HashIdTest, GenerateIdsBatch) {
+  std::vector<HashId> ids;
+  generateIds(5000u, &ids);
+  generateIds(3u, &ids);
+  ASSERT_EQ(5003u, ids.size());
+  std::unordered_set<HashId> unique_ids(ids.begin(), ids.end());
+  EXPECT_EQ(ids.size(), unique_ids.size());
+  for (const HashId& id : ids) {
+    EXPECT_TRUE(id.isValid());
+  }
+}
+
+TEST(HashIdTest, UniqueAcrossThreads) {
+  constexpr size_t kNumThreads = 8u;
+  constexpr size_t kNumIdsPerThread = 2000u;
+  std::mutex mutex;
+  std::vector<HashId> all_ids;
+  std::vector<std::thread> threads;
+  for (size_t thread_idx = 0u; thread_idx < kNumThreads; ++thread_idx) {
+    threads.emplace_back([&]() {
+      std::vector<HashId> ids;
+      for (size_t i = 0u; i < kNumIdsPerThread; ++i) {
+        HashId id;
+        generateId(&id);
+        ids.push_back(id);
+        ids.push_back(HashId::random());
+      }
+      generateIds(kNumIdsPerThread, &ids);
+      std::lock_guard<std::mutex> lock(mutex);
+      all_ids.insert(all_ids.end(), ids.begin(), ids.end());
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  std::unordered_set<HashId> unique_ids(all_ids.begin(), all_ids.end());
+  EXPECT_EQ(3u * kNumThreads * kNumIdsPerThread, unique_ids.size());
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
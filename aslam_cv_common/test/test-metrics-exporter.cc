@@ -0,0 +1,113 @@
+#include <chrono>
+#include <fstream>  // NOLINT
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <glob.h>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/metrics-exporter.h>
+#include <aslam/common/statistics/statistics.h>
+#include <aslam/common/timer.h>
+
+namespace aslam {
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path);
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+// Number of temporary files left next to the path.
+size_t NumTemporaryFiles(const std::string& path) {
+  glob_t matches;
+  const int result = glob((path + ".??????").c_str(), 0, nullptr, &matches);
+  const size_t num_matches = result == 0 ? matches.gl_pathc : 0u;
+  globfree(&matches);
+  return num_matches;
+}
+
+void AddSamples() {
+  statistics::StatsCollectorImpl collector("MetricsExporter \"stat\"");
+  for (size_t i = 1u; i <= 100u; ++i) {
+    collector.AddSample(static_cast<double>(i));
+  }
+  timing::TimerImpl timer("MetricsExporter::timer");
+  timer.Stop();
+}
+
+TEST(MetricsExporter, WritesPrometheusTextFormat) {
+  AddSamples();
+  std::stringstream prometheus;
+  MetricsExporter::writePrometheus(&prometheus);
+  const std::string text = prometheus.str();
+  EXPECT_NE(std::string::npos, text.find("# TYPE aslam_statistics summary\n"));
+  EXPECT_NE(
+      std::string::npos,
+      text.find("aslam_statistics{tag=\"MetricsExporter \\\"stat\\\"\",quantile=\"0.5\"} "));
+  EXPECT_NE(
+      std::string::npos,
+      text.find("aslam_statistics_count{tag=\"MetricsExporter \\\"stat\\\"\"} 100\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("aslam_statistics_sum{tag=\"MetricsExporter \\\"stat\\\"\"} 5050\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("aslam_timing_seconds_count{tag=\"MetricsExporter::timer\"} 1\n"));
+}
+
+TEST(MetricsExporter, WritesYamlSections) {
+  AddSamples();
+  std::stringstream yaml;
+  MetricsExporter::writeYaml(&yaml);
+  const std::string text = yaml.str();
+  EXPECT_EQ(0u, text.find("statistics:\n"));
+  EXPECT_NE(std::string::npos, text.find("\n  MetricsExporter \"stat\":\n    samples: "));
+  EXPECT_NE(std::string::npos, text.find("\ntiming:\n"));
+  EXPECT_NE(std::string::npos, text.find("\n  MetricsExporter__timer:\n    num_samples: "));
+}
+
+TEST(MetricsExporter, ExportsPeriodicallyAndOnStop) {
+  AddSamples();
+  const std::string kYamlPath = "metrics_exporter_test.yaml";
+  const std::string kPrometheusPath = "metrics_exporter_test.prom";
+  std::remove(kYamlPath.c_str());
+  std::remove(kPrometheusPath.c_str());
+
+  MetricsExporter exporter(std::chrono::milliseconds(10), kYamlPath, kPrometheusPath);
+  const std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (ReadFile(kPrometheusPath).empty() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_FALSE(ReadFile(kPrometheusPath).empty());
+
+  exporter.stop();
+  EXPECT_NE(std::string::npos, ReadFile(kYamlPath).find("statistics:"));
+  EXPECT_NE(std::string::npos, ReadFile(kPrometheusPath).find("aslam_timing_seconds_sum"));
+  EXPECT_EQ(0u, NumTemporaryFiles(kYamlPath));
+  EXPECT_EQ(0u, NumTemporaryFiles(kPrometheusPath));
+}
+
+TEST(MetricsExporter, ConcurrentExportersOfTheSamePath) {
+  AddSamples();
+  const std::string kPrometheusPath = "metrics_exporter_concurrent_test.prom";
+  std::remove(kPrometheusPath.c_str());
+  {
+    MetricsExporter first_exporter(std::chrono::milliseconds(1), "", kPrometheusPath);
+    MetricsExporter second_exporter(std::chrono::milliseconds(1), "", kPrometheusPath);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  const std::string text = ReadFile(kPrometheusPath);
+  EXPECT_NE(std::string::npos, text.find("# TYPE aslam_statistics summary\n"));
+  EXPECT_NE(std::string::npos, text.find("aslam_timing_seconds_sum"));
+  EXPECT_EQ(0u, NumTemporaryFiles(kPrometheusPath));
+  std::remove(kPrometheusPath.c_str());
+}
+
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <vector>
+
 #include <aslam/common/entrypoint.h>
 #include <eigen-checks/gtest.h>
 #include <Eigen/Core>
@@ -8,6 +11,7 @@
 
 typedef aslam::common::WeightedKeypoint<double, double, size_t> Point;
 typedef aslam::common::WeightedOccupancyGrid<Point> WeightedOccupancyGrid;
+typedef aslam::common::FixedCapacityOccupancyGrid<Point> FixedCapacityOccupancyGrid;
 
 TEST(OccupancyGrid, addPointOrReplaceWeakestIfCellFull) {
   WeightedOccupancyGrid grid(2.0, 2.0, 1.0, 1.0);
@@ -282,6 +286,152 @@ TEST(OccupancyGrid, GetOccupancyMask) {
   EXPECT_EQ(mask.at<unsigned char>(75, 75 - kMaskRadiusAroundPointsPx - 1), 255);
 }
 
+std::vector<size_t> sortedIds(const WeightedOccupancyGrid::PointList& points) {
+  std::vector<size_t> ids;
+  for (const Point& point : points) {
+    ids.push_back(point.id);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+TEST(OccupancyGrid, FixedCapacityGridMatchesWeightedGrid) {
+  const double kWidth = 752.0;
+  const double kHeight = 480.0;
+  const double kCellSize = 40.0;
+  const size_t kMaxNumPointsPerCell = 3u;
+  const size_t kNumRandomPoints = 5000u;
+  FixedCapacityOccupancyGrid fixed_grid(
+      kHeight, kWidth, kCellSize, kCellSize, kMaxNumPointsPerCell);
+
+  // Reuse the grid to make sure reset() clears all cells.
+  for (size_t run = 0u; run < 2u; ++run) {
+    fixed_grid.reset();
+    WeightedOccupancyGrid grid(kHeight, kWidth, kCellSize, kCellSize);
+
+    Eigen::Matrix2Xd random_points(2, kNumRandomPoints);
+    random_points.setRandom();
+    random_points = (random_points.array() + 1.0) / 2.0 * 0.999;
+    random_points.row(0) *= kHeight;
+    random_points.row(1) *= kWidth;
+    Eigen::VectorXd random_scores(kNumRandomPoints);
+    random_scores.setRandom();
+
+    for (size_t idx = 0u; idx < kNumRandomPoints; ++idx) {
+      const Point point(random_points(0, idx), random_points(1, idx), random_scores(idx), idx);
+      EXPECT_EQ(grid.addPointOrReplaceWeakestIfCellFull(point, kMaxNumPointsPerCell),
+                fixed_grid.addPointOrReplaceWeakestIfCellFull(point));
+    }
+    ASSERT_EQ(grid.getNumPoints(), fixed_grid.getNumPoints());
+
+    for (size_t i_row = 0u; i_row < fixed_grid.getNumGridRows(); ++i_row) {
+      for (size_t j_col = 0u; j_col < fixed_grid.getNumGridCols(); ++j_col) {
+        const double u_rows = (i_row + 0.5) * kCellSize;
+        const double v_cols = (j_col + 0.5) * kCellSize;
+        if (u_rows >= kHeight || v_cols >= kWidth) {
+          continue;
+        }
+        const FixedCapacityOccupancyGrid::CellView cell = fixed_grid.getGridCell(i_row, j_col);
+        EXPECT_LE(cell.size(), kMaxNumPointsPerCell);
+        EXPECT_EQ(sortedIds(grid.getGridCell(u_rows, v_cols)),
+                  sortedIds(WeightedOccupancyGrid::PointList(cell.begin(), cell.end())));
+      }
+    }
+
+    // Stay above the number of cells, the weighted grid can not empty cells.
+    const size_t kMaxTotalNumPoints = 300u;
+    grid.removePointsFromFullestCellsUntilSize(kMaxTotalNumPoints);
+    fixed_grid.removePointsFromFullestCellsUntilSize(kMaxTotalNumPoints);
+    WeightedOccupancyGrid::PointList points, fixed_points;
+    grid.getAllPointsInGrid(&points);
+    EXPECT_EQ(kMaxTotalNumPoints, fixed_grid.getAllPointsInGrid(&fixed_points));
+    EXPECT_EQ(sortedIds(points), sortedIds(fixed_points));
+  }
+}
+
+TEST(OccupancyGrid, BulkAddPointsOrReplaceWeakestIfCellFull) {
+  const double kWidth = 752.0;
+  const double kHeight = 480.0;
+  const double kCellSize = 40.0;
+  const size_t kMaxNumPointsPerCell = 4u;
+  const size_t kNumRandomPoints = 5000u;
+
+  Eigen::Matrix2Xd random_points(2, kNumRandomPoints);
+  random_points.setRandom();
+  random_points = (random_points.array() + 1.0) / 2.0 * 0.999;
+  random_points.row(0) *= kHeight;
+  random_points.row(1) *= kWidth;
+  Eigen::VectorXd random_scores(kNumRandomPoints);
+  random_scores.setRandom();
+
+  WeightedOccupancyGrid sequential_grid(kHeight, kWidth, kCellSize, kCellSize);
+  for (size_t idx = 0u; idx < kNumRandomPoints; ++idx) {
+    sequential_grid.addPointOrReplaceWeakestIfCellFull(
+        Point(random_points(0, idx), random_points(1, idx), random_scores(idx), idx),
+        kMaxNumPointsPerCell);
+  }
+
+  for (const size_t num_threads : {1u, 4u}) {
+    WeightedOccupancyGrid bulk_grid(kHeight, kWidth, kCellSize, kCellSize);
+    bulk_grid.addPointsOrReplaceWeakestIfCellFull(
+        random_points, random_scores, kMaxNumPointsPerCell, num_threads);
+    ASSERT_EQ(sequential_grid.getNumPoints(), bulk_grid.getNumPoints());
+    for (double u_rows = 0.5 * kCellSize; u_rows < kHeight; u_rows += kCellSize) {
+      for (double v_cols = 0.5 * kCellSize; v_cols < kWidth; v_cols += kCellSize) {
+        const WeightedOccupancyGrid::PointList& sequential_cell =
+            sequential_grid.getGridCell(u_rows, v_cols);
+        const WeightedOccupancyGrid::PointList& bulk_cell = bulk_grid.getGridCell(u_rows, v_cols);
+        ASSERT_EQ(sequential_cell.size(), bulk_cell.size());
+        for (size_t i = 0u; i < sequential_cell.size(); ++i) {
+          EXPECT_EQ(sequential_cell[i].id, bulk_cell[i].id);
+        }
+      }
+    }
+  }
+}
+
+TEST(OccupancyGrid, BulkAddPointsOrReplaceWeakestNearestPoints) {
+  const double kMinDistanceBetweenPoints = 5.0;
+  const double kWidth = 752.0;
+  const double kHeight = 480.0;
+  const size_t kNumRandomPoints = 5000u;
+
+  Eigen::Matrix2Xd random_points(2, kNumRandomPoints);
+  random_points.setRandom();
+  random_points = (random_points.array() + 1.0) / 2.0 * 0.999;
+  random_points.row(0) *= kHeight;
+  random_points.row(1) *= kWidth;
+  Eigen::VectorXd random_scores(kNumRandomPoints);
+  random_scores.setRandom();
+
+  WeightedOccupancyGrid::PointList points_single_thread;
+  for (const size_t num_threads : {1u, 4u}) {
+    WeightedOccupancyGrid grid(kHeight, kWidth, kMinDistanceBetweenPoints,
+                               kMinDistanceBetweenPoints);
+    grid.addPointsOrReplaceWeakestNearestPoints(
+        random_points, random_scores, kMinDistanceBetweenPoints, num_threads);
+    WeightedOccupancyGrid::PointList points;
+    grid.getAllPointsInGrid(&points);
+    EXPECT_EQ(points.size(), grid.getNumPoints());
+
+    // No two remaining points violate the min. distance.
+    for (size_t i = 0u; i < points.size(); ++i) {
+      for (size_t j = i + 1u; j < points.size(); ++j) {
+        const double du = points[i].u_rows - points[j].u_rows;
+        const double dv = points[i].v_cols - points[j].v_cols;
+        EXPECT_GE(du * du + dv * dv, kMinDistanceBetweenPoints * kMinDistanceBetweenPoints);
+      }
+    }
+
+    // The result does not depend on the number of threads.
+    if (num_threads == 1u) {
+      points_single_thread = points;
+    } else {
+      EXPECT_EQ(sortedIds(points_single_thread), sortedIds(points));
+    }
+  }
+}
+
 TEST(OccupancyGrid, InvalidGridParameters) {
   // Zero sized grid.
   EXPECT_DEATH(WeightedOccupancyGrid(0.0, 1.0, 1.0, 1.0), "^");
@@ -292,6 +442,9 @@ TEST(OccupancyGrid, InvalidGridParameters) {
   EXPECT_DEATH(WeightedOccupancyGrid(1.0, 1.0, 2.0, 0.5), "^");
   EXPECT_DEATH(WeightedOccupancyGrid(1.0, 1.0, 0.5, 2.0), "^");
   EXPECT_DEATH(WeightedOccupancyGrid(1.0, 1.0, 2.0, 2.0), "^");
+
+  // Cells without capacity.
+  EXPECT_DEATH(FixedCapacityOccupancyGrid(1.0, 1.0, 1.0, 1.0, 0u), "^");
 }
 
 ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,61 @@
+#include <atomic>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/parallel-process.h>
+
+namespace aslam {
+namespace common {
+
+TEST(ParallelProcess, ProcessesEveryItemOnce) {
+  constexpr size_t kNumItems = 1000u;
+  for (size_t num_threads = 1u; num_threads <= 16u; num_threads *= 2u) {
+    std::vector<int> num_calls(kNumItems, 0);
+    std::atomic<size_t> num_blocks(0u);
+    parallelProcess(kNumItems, num_threads, [&](size_t begin, size_t end) {
+      EXPECT_LT(begin, end);
+      ++num_blocks;
+      for (size_t item = begin; item < end; ++item) {
+        ++num_calls[item];
+      }
+    });
+    EXPECT_EQ(num_threads, num_blocks.load());
+    for (const int calls : num_calls) {
+      EXPECT_EQ(1, calls);
+    }
+  }
+}
+
+TEST(ParallelProcess, SmallRangesAreProcessedSerially) {
+  size_t num_blocks = 0u;
+  parallelProcess(
+      99u, 8u,
+      [&](size_t begin, size_t end) {
+        EXPECT_EQ(0u, begin);
+        EXPECT_EQ(99u, end);
+        ++num_blocks;
+      },
+      100u /*min_items_per_block*/);
+  EXPECT_EQ(1u, num_blocks);
+}
+
+TEST(ParallelProcess, NestedCallsDoNotDeadlock) {
+  // More outer blocks than pool threads, each of which waits for inner blocks.
+  const size_t num_threads = 4u * getNumHardwareThreads();
+  std::atomic<size_t> num_items(0u);
+  parallelProcess(num_threads, num_threads, [&](size_t begin, size_t end) {
+    for (size_t item = begin; item < end; ++item) {
+      parallelProcess(num_threads, num_threads, [&](size_t inner_begin, size_t inner_end) {
+        num_items += inner_end - inner_begin;
+      });
+    }
+  });
+  EXPECT_EQ(num_threads * num_threads, num_items.load());
+}
+
+}  // namespace common
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,112 @@
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/profiler.h>
+
+namespace timing {
+
+class ProfilerTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    Profiler::Reset();
+    Profiler::SetEnabled(true);
+  }
+  virtual void TearDown() {
+    Profiler::SetEnabled(false);
+    Profiler::Reset();
+  }
+};
+
+size_t CountOccurrences(const std::string& text, const std::string& pattern) {
+  size_t count = 0u;
+  for (size_t pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + pattern.size())) {
+    ++count;
+  }
+  return count;
+}
+
+TEST_F(ProfilerTest, BuildsCallTree) {
+  for (size_t i = 0u; i < 3u; ++i) {
+    ScopedProfile outer("ProfilerTest.outer");
+    {
+      ScopedProfile inner("ProfilerTest.inner");
+    }
+    {
+      ScopedProfile inner("ProfilerTest.inner");
+    }
+  }
+  EXPECT_EQ(3u, Timing::GetNumSamples("ProfilerTest.outer"));
+  EXPECT_EQ(6u, Timing::GetNumSamples("ProfilerTest.inner"));
+
+  const std::string call_tree = Profiler::PrintCallTree();
+  EXPECT_NE(std::string::npos, call_tree.find("  ProfilerTest.outer\t3\t"));
+  EXPECT_NE(std::string::npos, call_tree.find("    ProfilerTest.inner\t6\t"));
+  EXPECT_EQ(1u, CountOccurrences(call_tree, "ProfilerTest.inner"));
+}
+
+TEST_F(ProfilerTest, ExportsOneEventPerScopeWithThreadIds) {
+  {
+    ScopedProfile scope("ProfilerTest.\"quoted\"");
+  }
+  std::thread worker([]() {
+    Profiler::SetThreadName("worker");
+    ScopedProfile scope("ProfilerTest.worker");
+  });
+  worker.join();
+
+  std::stringstream trace;
+  Profiler::WriteChromeTrace(trace);
+  const std::string json = trace.str();
+  EXPECT_EQ(2u, CountOccurrences(json, "\"ph\":\"X\""));
+  EXPECT_EQ(1u, CountOccurrences(json, "\"name\":\"ProfilerTest.\\\"quoted\\\"\""));
+  EXPECT_EQ(1u, CountOccurrences(json, "\"name\":\"ProfilerTest.worker\""));
+  EXPECT_EQ(1u, CountOccurrences(json, "\"args\":{\"name\":\"worker\"}"));
+  EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+}
+
+TEST_F(ProfilerTest, DisabledProfilerRecordsNothing) {
+  Profiler::SetEnabled(false);
+  {
+    ScopedProfile scope("ProfilerTest.disabled");
+  }
+  std::stringstream trace;
+  Profiler::WriteChromeTrace(trace);
+  EXPECT_EQ(0u, CountOccurrences(trace.str(), "ProfilerTest.disabled"));
+  EXPECT_EQ(0u, Timing::GetNumSamples("ProfilerTest.disabled"));
+}
+
+TEST_F(ProfilerTest, RegistersThreadsOnlyWhileProfiling) {
+  Profiler::SetEnabled(false);
+  std::thread idle_worker([]() {
+    Profiler::SetThreadName("idle_worker");
+    ScopedProfile scope("ProfilerTest.idle");
+  });
+  idle_worker.join();
+  Profiler::SetEnabled(true);
+  std::thread worker([]() {
+    Profiler::SetThreadName("worker");
+    ScopedProfile scope("ProfilerTest.worker");
+  });
+  worker.join();
+
+  std::stringstream trace;
+  Profiler::WriteChromeTrace(trace);
+  EXPECT_EQ(0u, CountOccurrences(trace.str(), "idle_worker"));
+  EXPECT_EQ(1u, CountOccurrences(trace.str(), "\"args\":{\"name\":\"worker\"}"));
+
+  // The profiles of exited threads are dropped on reset.
+  Profiler::Reset();
+  std::stringstream trace_after_reset;
+  Profiler::WriteChromeTrace(trace_after_reset);
+  EXPECT_EQ(0u, CountOccurrences(trace_after_reset.str(), "\"args\":{\"name\":\"worker\"}"));
+}
+
+}  // namespace timing
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/statistics/histogram.h>
+#include <aslam/common/statistics/statistics.h>
+
+namespace statistics {
+
+// Returns the smallest sample such that at least the given percentage of samples are less or
+// equal.
+double ExactPercentile(std::vector<double> samples, double percentile) {
+  std::sort(samples.begin(), samples.end());
+  const size_t rank = std::max<size_t>(
+      1u, static_cast<size_t>(std::ceil(percentile / 100.0 * samples.size())));
+  return samples[rank - 1u];
+}
+
+TEST(LogHistogram, PercentilesWithinRelativeError) {
+  std::mt19937 generator(42);
+  std::lognormal_distribution<double> distribution(-7.0, 1.5);
+  std::vector<double> samples;
+  LogHistogram histogram;
+  for (size_t i = 0u; i < 100000u; ++i) {
+    samples.push_back(distribution(generator));
+    histogram.Add(samples.back());
+  }
+  EXPECT_EQ(samples.size(), histogram.total_count());
+  EXPECT_EQ(*std::min_element(samples.begin(), samples.end()), histogram.min());
+  EXPECT_EQ(*std::max_element(samples.begin(), samples.end()), histogram.max());
+
+  const double kMaxRelativeError = 1.0 / LogHistogram::kNumSubBucketsPerOctave;
+  for (const double percentile : {0.0, 1.0, 50.0, 95.0, 99.0, 99.9, 100.0}) {
+    const double exact = ExactPercentile(samples, percentile);
+    EXPECT_NEAR(exact, histogram.Percentile(percentile), exact * kMaxRelativeError)
+        << "Percentile " << percentile;
+  }
+}
+
+TEST(LogHistogram, HandlesZeroAndNegativeSamples) {
+  LogHistogram histogram;
+  EXPECT_EQ(0.0, histogram.Percentile(50.0));
+  for (const double sample : {-4.0, -2.0, 0.0, 0.0, 1.0, 8.0}) {
+    histogram.Add(sample);
+  }
+  EXPECT_EQ(-4.0, histogram.Percentile(0.0));
+  EXPECT_NEAR(-2.0, histogram.Percentile(30.0), 2.0 / LogHistogram::kNumSubBucketsPerOctave);
+  EXPECT_EQ(0.0, histogram.Percentile(50.0));
+  EXPECT_NEAR(1.0, histogram.Percentile(70.0), 1.0 / LogHistogram::kNumSubBucketsPerOctave);
+  EXPECT_EQ(8.0, histogram.Percentile(100.0));
+}
+
+TEST(LogHistogram, AllocatesOnlyOccupiedOctaves) {
+  LogHistogram histogram;
+  histogram.Add(0.0);
+  histogram.Add(1.0);
+  EXPECT_EQ(1u, histogram.num_octaves());
+  histogram.Add(-1.0);
+  histogram.Add(1e-12);
+  histogram.Add(1.5);
+  EXPECT_EQ(3u, histogram.num_octaves());
+  EXPECT_EQ(-1.0, histogram.Percentile(0.0));
+  EXPECT_EQ(0.0, histogram.Percentile(40.0));
+  EXPECT_NEAR(1e-12, histogram.Percentile(60.0), 1e-12 / LogHistogram::kNumSubBucketsPerOctave);
+}
+
+TEST(LogHistogram, MergeEqualsCombinedHistogram) {
+  std::mt19937 generator(7);
+  std::exponential_distribution<double> distribution(100.0);
+  LogHistogram combined;
+  LogHistogram first;
+  LogHistogram second;
+  for (size_t i = 0u; i < 10000u; ++i) {
+    const double sample = distribution(generator) * (i < 5000u ? 1.0 : 1000.0);
+    combined.Add(sample);
+    (i % 3u == 0u ? first : second).Add(sample);
+  }
+  first.Merge(second);
+  EXPECT_EQ(combined.total_count(), first.total_count());
+  EXPECT_EQ(combined.min(), first.min());
+  EXPECT_EQ(combined.max(), first.max());
+  for (const double percentile : {10.0, 50.0, 95.0, 99.0, 99.9}) {
+    EXPECT_EQ(combined.Percentile(percentile), first.Percentile(percentile));
+  }
+}
+
+TEST(Statistics, ReportsPercentiles) {
+  const std::string kTag = "Statistics.ReportsPercentiles";
+  StatsCollectorImpl collector(kTag);
+  for (size_t i = 1u; i <= 1000u; ++i) {
+    collector.AddSample(static_cast<double>(i));
+  }
+  const double kMaxRelativeError = 1.0 / LogHistogram::kNumSubBucketsPerOctave;
+  EXPECT_NEAR(500.0, Statistics::GetPercentile(kTag, 50.0), 500.0 * kMaxRelativeError);
+  EXPECT_NEAR(950.0, Statistics::GetPercentile(kTag, 95.0), 950.0 * kMaxRelativeError);
+  EXPECT_NEAR(990.0, Statistics::GetPercentile(kTag, 99.0), 990.0 * kMaxRelativeError);
+  EXPECT_NEAR(999.0, Statistics::GetPercentile(kTag, 99.9), 999.0 * kMaxRelativeError);
+  EXPECT_EQ(1000u, Statistics::GetHistogram(kTag).total_count());
+  EXPECT_NE(std::string::npos, Statistics::Print().find("p50/p95/p99/p99.9"));
+}
+
+}  // namespace statistics
+
+ASLAM_UNITTEST_ENTRYPOINT
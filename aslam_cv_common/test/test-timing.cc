@@ -0,0 +1,141 @@
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/timer.h>
+
+namespace timing {
+
+TEST(Timing, CachedHandleMatchesTag) {
+  const std::string kTag = "Timing.CachedHandleMatchesTag";
+  const size_t handle = TimerImpl::RegisterTag(kTag);
+  EXPECT_EQ(handle, TimerImpl::RegisterTag(kTag));
+  EXPECT_EQ(handle, Timing::GetHandle(kTag));
+  EXPECT_EQ(kTag, Timing::GetTag(handle));
+
+  TimerImpl timer(handle);
+  EXPECT_TRUE(timer.IsTiming());
+  EXPECT_EQ(handle, timer.GetHandle());
+  EXPECT_GE(timer.Stop(), 0.0);
+  EXPECT_FALSE(timer.IsTiming());
+  EXPECT_EQ(1u, Timing::GetNumSamples(kTag));
+}
+
+TEST(Timing, MergesSamplesOfAllThreads) {
+  const std::string kTag = "Timing.MergesSamplesOfAllThreads";
+  const size_t handle = TimerImpl::RegisterTag(kTag);
+  constexpr size_t kNumThreads = 4u;
+  constexpr size_t kNumSamplesPerThread = 1000u;
+
+  // Keep one thread alive until the samples were queried such that both the samples of
+  // running and finished threads are merged.
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool samples_queried = false;
+  size_t num_threads_done = 0u;
+  std::thread running_thread([&]() {
+    for (size_t i = 0u; i < kNumSamplesPerThread; ++i) {
+      TimerImpl timer(handle);
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    ++num_threads_done;
+    condition.notify_all();
+    condition.wait(lock, [&]() { return samples_queried; });
+  });
+
+  std::vector<std::thread> threads;
+  for (size_t thread_idx = 1u; thread_idx < kNumThreads; ++thread_idx) {
+    threads.emplace_back([&]() {
+      for (size_t i = 0u; i < kNumSamplesPerThread; ++i) {
+        TimerImpl timer(handle);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&]() { return num_threads_done == 1u; });
+  }
+
+  EXPECT_EQ(kNumThreads * kNumSamplesPerThread, Timing::GetNumSamples(handle));
+  EXPECT_GE(Timing::GetMinSeconds(handle), 0.0);
+  EXPECT_LE(Timing::GetMinSeconds(handle), Timing::GetMeanSeconds(handle));
+  EXPECT_LE(Timing::GetMeanSeconds(handle), Timing::GetMaxSeconds(handle));
+  EXPECT_NEAR(Timing::GetTotalSeconds(handle),
+              Timing::GetMeanSeconds(handle) * kNumThreads * kNumSamplesPerThread, 1e-9);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    samples_queried = true;
+  }
+  condition.notify_all();
+  running_thread.join();
+  EXPECT_EQ(kNumThreads * kNumSamplesPerThread, Timing::GetNumSamples(handle));
+}
+
+TEST(Timing, MergedStatisticsMatchSequentialStatistics) {
+  internal::TimerSamples all_samples;
+  internal::TimerSamples first_half;
+  internal::TimerSamples second_half;
+  for (size_t i = 0u; i < 100u; ++i) {
+    const double sample = 0.001 * (i % 7) + 0.01;
+    all_samples.Add(sample);
+    if (i < 30u) {
+      first_half.Add(sample);
+    } else {
+      second_half.Add(sample);
+    }
+  }
+  first_half.Merge(second_half);
+  EXPECT_EQ(all_samples.num_samples, first_half.num_samples);
+  EXPECT_NEAR(all_samples.mean, first_half.mean, 1e-12);
+  EXPECT_NEAR(all_samples.Variance(), first_half.Variance(), 1e-12);
+  EXPECT_EQ(all_samples.min, first_half.min);
+  EXPECT_EQ(all_samples.max, first_half.max);
+}
+
+class TimingTest : public testing::Test {
+ protected:
+  static void AddTime(size_t handle, double seconds) {
+    Timing::AddTime(handle, seconds);
+  }
+};
+
+TEST_F(TimingTest, ResetKeepsHandlesAndDropsSamples) {
+  const std::string kTag = "Timing.ResetKeepsHandlesAndDropsSamples";
+  const size_t handle = TimerImpl::RegisterTag(kTag);
+  AddTime(handle, 1.0);
+  std::thread([handle]() { AddTime(handle, 1.0); }).join();
+  EXPECT_EQ(2u, Timing::GetNumSamples(handle));
+
+  Timing::Reset();
+  EXPECT_EQ(0u, Timing::GetNumSamples(handle));
+  EXPECT_EQ(handle, Timing::GetHandle(kTag));
+
+  AddTime(handle, 0.5);
+  EXPECT_EQ(1u, Timing::GetNumSamples(handle));
+  EXPECT_DOUBLE_EQ(0.5, Timing::GetMeanSeconds(handle));
+}
+
+TEST_F(TimingTest, HzUsesRollingMean) {
+  const size_t handle = TimerImpl::RegisterTag("Timing.HzUsesRollingMean");
+  for (size_t i = 0u; i < 1000u; ++i) {
+    AddTime(handle, 1.0);
+  }
+  for (size_t i = 0u; i < 100u; ++i) {
+    AddTime(handle, 0.1);
+  }
+  EXPECT_NEAR(10.0, Timing::GetHz(handle), 1e-9);
+  EXPECT_GT(Timing::GetMeanSeconds(handle), 0.5);
+}
+
+}  // namespace timing
+
+ASLAM_UNITTEST_ENTRYPOINT
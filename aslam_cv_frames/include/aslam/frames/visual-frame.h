@@ -2,6 +2,8 @@
 #define ASLAM_FRAMES_VISUAL_FRAME_H_
 
 #include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <cstdint>
 
@@ -50,6 +52,10 @@ class VisualFrame  {
   virtual ~VisualFrame() {};
 
   /// Copy constructor for clone operation. (Cameras are not cloned!)
+  /// The channel data is shared copy-on-write: the copy and the original frame point to the
+  /// same data until either side requests mutable access to a channel through one of the
+  /// get*Mutable(), set*() or swap*() methods. References obtained from the const getters
+  /// before such a call keep pointing to the data that was shared.
   VisualFrame(const VisualFrame& other);
   VisualFrame& operator=(const VisualFrame& other);
 
@@ -84,9 +90,12 @@ class VisualFrame  {
   /// Are there track ids stored in this frame?
   bool hasTrackIds() const;
 
-  /// Is there a raw image stored in this frame?
+  /// Is there a raw image stored in this frame? (Either decoded or compressed.)
   bool hasRawImage() const;
 
+  /// Is the raw image stored in compressed form?
+  bool hasCompressedRawImage() const;
+
   /// Is a certain channel stored in this frame?
   bool hasChannel(const std::string& channel) const {
     return aslam::channels::hasChannel(channel, channels_);
@@ -122,12 +131,27 @@ class VisualFrame  {
   /// The track ids stored in this frame.
   const Eigen::VectorXi& getTrackIds() const;
 
-  /// The raw image stored in a frame.
+  /// The raw image stored in a frame. If the frame only holds a compressed raw image, the
+  /// image is decoded on the first call and the decoded copy is kept until
+  /// releaseDecodedRawImage() or any other non-const raw image method is called, which
+  /// invalidates the returned reference. Copy the cv::Mat to keep the image beyond that.
   const cv::Mat& getRawImage() const;
 
+  /// The encoded raw image as single-channel byte buffer.
+  const cv::Mat& getCompressedRawImage() const;
+
   /// Release the raw image. Only if the cv::Mat reference count is 1 the memory will be freed.
   void releaseRawImage();
 
+  /// Release the lazily decoded copy of a compressed raw image, e.g. under memory pressure.
+  /// The compressed raw image is kept and decoded again on the next access. Invalidates the
+  /// references returned by getRawImage(); copies of the cv::Mat keep the decoded data alive.
+  void releaseDecodedRawImage();
+
+  /// Encode the raw image (e.g. ".png", ".jpg") and only keep the compressed version in the
+  /// frame. The image is decoded again on demand by getRawImage().
+  void compressRawImage(const std::string& format_extension = ".png");
+
   template<typename CHANNEL_DATA_TYPE>
   const CHANNEL_DATA_TYPE& getChannelData(const std::string& channel) const {
     return aslam::channels::getChannelData<CHANNEL_DATA_TYPE>(channel, channels_);
@@ -155,18 +179,19 @@ class VisualFrame  {
   Eigen::VectorXi* getTrackIdsMutable();
 
   /// A pointer to the raw image, can be used to swap in new data.
+  /// A compressed raw image gets decoded and replaced by the decoded image.
   cv::Mat* getRawImageMutable();
 
   template<typename CHANNEL_DATA_TYPE>
-  CHANNEL_DATA_TYPE* getChannelDataMutable(const std::string& channel) const {
+  CHANNEL_DATA_TYPE* getChannelDataMutable(const std::string& channel) {
     CHANNEL_DATA_TYPE& data =
-        aslam::channels::getChannelData<CHANNEL_DATA_TYPE>(channel,
-                                                           channels_);
+        aslam::channels::getChannelDataMutable<CHANNEL_DATA_TYPE>(channel,
+                                                                  &channels_);
     return &data;
   }
 
   /// Return block expression of the keypoint measurement pointed to by index.
-  const Eigen::Block<Eigen::Matrix2Xd, 2, 1> getKeypointMeasurement(size_t index) const;
+  const Eigen::Block<const Eigen::Matrix2Xd, 2, 1> getKeypointMeasurement(size_t index) const;
 
   /// Return the keypoint measurement uncertainty at index.
   double getKeypointMeasurementUncertainty(size_t index) const;
@@ -216,6 +241,10 @@ class VisualFrame  {
   ///        should be owned by the VisualFrame.
   void setRawImage(const cv::Mat& image);
 
+  /// Replace the raw image by an encoded image (single-channel byte buffer as returned by
+  /// cv::imencode). The image is decoded lazily on the first access through getRawImage().
+  void setCompressedRawImage(const cv::Mat& compressed_image);
+
   template<typename CHANNEL_DATA_TYPE>
   void setChannelData(const std::string& channel,
                       const CHANNEL_DATA_TYPE& data_new) {
@@ -223,7 +252,7 @@ class VisualFrame  {
       aslam::channels::addChannel<CHANNEL_DATA_TYPE>(channel, &channels_);
     }
     CHANNEL_DATA_TYPE& data =
-        aslam::channels::getChannelData<CHANNEL_DATA_TYPE>(channel, channels_);
+        aslam::channels::getChannelDataMutable<CHANNEL_DATA_TYPE>(channel, &channels_);
     data = data_new;
   }
 
@@ -260,7 +289,7 @@ class VisualFrame  {
       aslam::channels::addChannel<CHANNEL_DATA_TYPE>(channel, &channels_);
     }
     CHANNEL_DATA_TYPE& data =
-        aslam::channels::getChannelData<CHANNEL_DATA_TYPE>(channel, channels_);
+        aslam::channels::getChannelDataMutable<CHANNEL_DATA_TYPE>(channel, &channels_);
     data.swap(*data_new);
   }
 
@@ -307,7 +336,8 @@ class VisualFrame  {
                                        Eigen::Matrix2Xd* out_image_coordinates,
                                        std::vector<aslam::ProjectionResult>* results) const;
 
-  /// Return a list of normalized bearing vectors for the specified keypoint indices.
+  /// Return a list of normalized bearing vectors for the specified keypoint indices. Uses the
+  /// bearing lookup table of the camera if enabled, see Camera::getNormalizedBearingVectors.
   Eigen::Matrix3Xd getNormalizedBearingVectors(
       const std::vector<size_t>& keypoint_indices,
       std::vector<unsigned char>* backprojection_success) const;
@@ -357,6 +387,12 @@ class VisualFrame  {
 
   aslam::FrameId id_;
   aslam::channels::ChannelGroup channels_;
+
+  /// Lazily decoded copy of the compressed raw image. Only assigned once by the const
+  /// getRawImage() and reset by non-const methods.
+  mutable cv::Mat decoded_raw_image_;
+  mutable std::mutex m_decoded_raw_image_;
+
   Camera::ConstPtr camera_geometry_;
   Camera::ConstPtr raw_camera_geometry_;
 
@@ -1,9 +1,12 @@
 #include "aslam/frames/visual-frame.h"
 
 #include <memory>
+#include <vector>
+
 #include <aslam/common/channel-definitions.h>
 #include <aslam/common/stl-helpers.h>
 #include <aslam/common/time.h>
+#include <opencv2/highgui/highgui.hpp>
 
 namespace aslam {
 VisualFrame::VisualFrame()
@@ -20,7 +23,11 @@ VisualFrame& VisualFrame::operator=(const VisualFrame& other) {
   camera_geometry_ = other.camera_geometry_;
   raw_camera_geometry_ = other.raw_camera_geometry_;
 
-  channels_ = channels::cloneChannelGroup(other.channels_);
+  channels_ = channels::shareChannelGroup(other.channels_);
+  {
+    std::lock_guard<std::mutex> lock(other.m_decoded_raw_image_);
+    decoded_raw_image_ = other.decoded_raw_image_;
+  }
   is_valid_ = other.is_valid_;
   return *this;
 }
@@ -69,7 +76,10 @@ bool VisualFrame::hasTrackIds() const {
   return aslam::channels::has_TRACK_IDS_Channel(channels_);
 }
 bool VisualFrame::hasRawImage() const {
-  return aslam::channels::has_RAW_IMAGE_Channel(channels_);
+  return aslam::channels::has_RAW_IMAGE_Channel(channels_) || hasCompressedRawImage();
+}
+bool VisualFrame::hasCompressedRawImage() const {
+  return aslam::channels::has_RAW_IMAGE_COMPRESSED_Channel(channels_);
 }
 
 const Eigen::Matrix2Xd& VisualFrame::getKeypointMeasurements() const {
@@ -94,93 +104,130 @@ const Eigen::VectorXi& VisualFrame::getTrackIds() const {
   return aslam::channels::get_TRACK_IDS_Data(channels_);
 }
 const cv::Mat& VisualFrame::getRawImage() const {
-  return aslam::channels::get_RAW_IMAGE_Data(channels_);
+  if (aslam::channels::has_RAW_IMAGE_Channel(channels_) || !hasCompressedRawImage()) {
+    return aslam::channels::get_RAW_IMAGE_Data(channels_);
+  }
+  std::lock_guard<std::mutex> lock(m_decoded_raw_image_);
+  if (decoded_raw_image_.empty()) {
+    decoded_raw_image_ = cv::imdecode(getCompressedRawImage(), cv::IMREAD_UNCHANGED);
+    CHECK(!decoded_raw_image_.empty()) << "Failed to decode the compressed raw image.";
+  }
+  return decoded_raw_image_;
+}
+const cv::Mat& VisualFrame::getCompressedRawImage() const {
+  return aslam::channels::get_RAW_IMAGE_COMPRESSED_Data(channels_);
 }
 
 void VisualFrame::releaseRawImage() {
-  aslam::channels::remove_RAW_IMAGE_Channel(&channels_);
+  CHECK(hasRawImage()) << "The frame does not contain a raw image.";
+  if (aslam::channels::has_RAW_IMAGE_Channel(channels_)) {
+    aslam::channels::remove_RAW_IMAGE_Channel(&channels_);
+  }
+  if (hasCompressedRawImage()) {
+    aslam::channels::remove_RAW_IMAGE_COMPRESSED_Channel(&channels_);
+  }
+  releaseDecodedRawImage();
+}
+
+void VisualFrame::releaseDecodedRawImage() {
+  std::lock_guard<std::mutex> lock(m_decoded_raw_image_);
+  decoded_raw_image_ = cv::Mat();
+}
+
+void VisualFrame::compressRawImage(const std::string& format_extension) {
+  CHECK(aslam::channels::has_RAW_IMAGE_Channel(channels_))
+      << "The frame does not contain a decoded raw image.";
+  std::vector<unsigned char> buffer;
+  CHECK(cv::imencode(format_extension, getRawImage(), buffer))
+      << "Failed to encode the raw image as " << format_extension << ".";
+  setCompressedRawImage(cv::Mat(buffer, true /* copy data */));
 }
 
 Eigen::Matrix2Xd* VisualFrame::getKeypointMeasurementsMutable() {
   Eigen::Matrix2Xd& keypoints =
-      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENTS_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENTS_DataMutable(&channels_);
     return &keypoints;
 }
 Eigen::VectorXd* VisualFrame::getKeypointMeasurementUncertaintiesMutable() {
   Eigen::VectorXd& uncertainties =
-      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENT_UNCERTAINTIES_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENT_UNCERTAINTIES_DataMutable(&channels_);
     return &uncertainties;
 }
 Eigen::VectorXd* VisualFrame::getKeypointScalesMutable() {
   Eigen::VectorXd& scales =
-      aslam::channels::get_VISUAL_KEYPOINT_SCALES_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_SCALES_DataMutable(&channels_);
     return &scales;
 }
 Eigen::VectorXd* VisualFrame::getKeypointOrientationsMutable() {
   Eigen::VectorXd& orientations =
-      aslam::channels::get_VISUAL_KEYPOINT_ORIENTATIONS_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_ORIENTATIONS_DataMutable(&channels_);
     return &orientations;
 }
 Eigen::VectorXd* VisualFrame::getKeypointScoresMutable() {
   Eigen::VectorXd& scores =
-      aslam::channels::get_VISUAL_KEYPOINT_SCORES_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_SCORES_DataMutable(&channels_);
     return &scores;
 }
 VisualFrame::DescriptorsT* VisualFrame::getDescriptorsMutable() {
   VisualFrame::DescriptorsT& descriptors =
-      aslam::channels::get_DESCRIPTORS_Data(channels_);
+      aslam::channels::get_DESCRIPTORS_DataMutable(&channels_);
   return &descriptors;
 }
 Eigen::VectorXi* VisualFrame::getTrackIdsMutable() {
   Eigen::VectorXi& track_ids =
-      aslam::channels::get_TRACK_IDS_Data(channels_);
+      aslam::channels::get_TRACK_IDS_DataMutable(&channels_);
   return &track_ids;
 }
 cv::Mat* VisualFrame::getRawImageMutable() {
+  if (!aslam::channels::has_RAW_IMAGE_Channel(channels_) && hasCompressedRawImage()) {
+    // Materialize the decoded image as writes would invalidate the compressed one.
+    const cv::Mat decoded_image = getRawImage();
+    setRawImage(decoded_image);
+  }
   cv::Mat& image =
-      aslam::channels::get_RAW_IMAGE_Data(channels_);
+      aslam::channels::get_RAW_IMAGE_DataMutable(&channels_);
   return &image;
 }
 
-const Eigen::Block<Eigen::Matrix2Xd, 2, 1>
+const Eigen::Block<const Eigen::Matrix2Xd, 2, 1>
 VisualFrame::getKeypointMeasurement(size_t index) const {
-  Eigen::Matrix2Xd& keypoints =
+  const Eigen::Matrix2Xd& keypoints =
       aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENTS_Data(channels_);
   CHECK_LT(static_cast<int>(index), keypoints.cols());
   return keypoints.block<2, 1>(0, index);
 }
 double VisualFrame::getKeypointMeasurementUncertainty(size_t index) const {
-  Eigen::VectorXd& data =
+  const Eigen::VectorXd& data =
       aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENT_UNCERTAINTIES_Data(channels_);
   CHECK_LT(static_cast<int>(index), data.rows());
   return data.coeff(index, 0);
 }
 double VisualFrame::getKeypointScale(size_t index) const {
-  Eigen::VectorXd& data =
+  const Eigen::VectorXd& data =
       aslam::channels::get_VISUAL_KEYPOINT_SCALES_Data(channels_);
   CHECK_LT(static_cast<int>(index), data.rows());
   return data.coeff(index, 0);
 }
 double VisualFrame::getKeypointOrientation(size_t index) const {
-  Eigen::VectorXd& data =
+  const Eigen::VectorXd& data =
       aslam::channels::get_VISUAL_KEYPOINT_ORIENTATIONS_Data(channels_);
   CHECK_LT(static_cast<int>(index), data.rows());
   return data.coeff(index, 0);
 }
 double VisualFrame::getKeypointScore(size_t index) const {
-  Eigen::VectorXd& data =
+  const Eigen::VectorXd& data =
       aslam::channels::get_VISUAL_KEYPOINT_SCORES_Data(channels_);
   CHECK_LT(static_cast<int>(index), data.rows());
   return data.coeff(index, 0);
 }
 const unsigned char* VisualFrame::getDescriptor(size_t index) const {
-  VisualFrame::DescriptorsT& descriptors =
+  const VisualFrame::DescriptorsT& descriptors =
       aslam::channels::get_DESCRIPTORS_Data(channels_);
   CHECK_LT(static_cast<int>(index), descriptors.cols());
-  return &descriptors.coeffRef(0, index);
+  return descriptors.col(index).data();
 }
 int VisualFrame::getTrackId(size_t index) const {
-  Eigen::VectorXi& track_ids =
+  const Eigen::VectorXi& track_ids =
       aslam::channels::get_TRACK_IDS_Data(channels_);
   CHECK_LT(static_cast<int>(index), track_ids.rows());
   return track_ids.coeff(index, 0);
@@ -192,7 +239,7 @@ void VisualFrame::setKeypointMeasurements(
     aslam::channels::add_VISUAL_KEYPOINT_MEASUREMENTS_Channel(&channels_);
   }
   Eigen::Matrix2Xd& keypoints =
-      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENTS_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENTS_DataMutable(&channels_);
   keypoints = keypoints_new;
 }
 void VisualFrame::setKeypointMeasurementUncertainties(
@@ -201,7 +248,7 @@ void VisualFrame::setKeypointMeasurementUncertainties(
     aslam::channels::add_VISUAL_KEYPOINT_MEASUREMENT_UNCERTAINTIES_Channel(&channels_);
   }
   Eigen::VectorXd& data =
-      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENT_UNCERTAINTIES_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENT_UNCERTAINTIES_DataMutable(&channels_);
   data = uncertainties_new;
 }
 void VisualFrame::setKeypointScales(
@@ -210,7 +257,7 @@ void VisualFrame::setKeypointScales(
     aslam::channels::add_VISUAL_KEYPOINT_SCALES_Channel(&channels_);
   }
   Eigen::VectorXd& data =
-      aslam::channels::get_VISUAL_KEYPOINT_SCALES_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_SCALES_DataMutable(&channels_);
   data = scales_new;
 }
 void VisualFrame::setKeypointOrientations(
@@ -219,7 +266,7 @@ void VisualFrame::setKeypointOrientations(
     aslam::channels::add_VISUAL_KEYPOINT_ORIENTATIONS_Channel(&channels_);
   }
   Eigen::VectorXd& data =
-      aslam::channels::get_VISUAL_KEYPOINT_ORIENTATIONS_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_ORIENTATIONS_DataMutable(&channels_);
   data = orientations_new;
 }
 void VisualFrame::setKeypointScores(
@@ -228,7 +275,7 @@ void VisualFrame::setKeypointScores(
     aslam::channels::add_VISUAL_KEYPOINT_SCORES_Channel(&channels_);
   }
   Eigen::VectorXd& data =
-      aslam::channels::get_VISUAL_KEYPOINT_SCORES_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_SCORES_DataMutable(&channels_);
   data = scores_new;
 }
 void VisualFrame::setDescriptors(
@@ -237,7 +284,7 @@ void VisualFrame::setDescriptors(
     aslam::channels::add_DESCRIPTORS_Channel(&channels_);
   }
   VisualFrame::DescriptorsT& descriptors =
-      aslam::channels::get_DESCRIPTORS_Data(channels_);
+      aslam::channels::get_DESCRIPTORS_DataMutable(&channels_);
   descriptors = descriptors_new;
 }
 void VisualFrame::setDescriptors(
@@ -246,7 +293,7 @@ void VisualFrame::setDescriptors(
     aslam::channels::add_DESCRIPTORS_Channel(&channels_);
   }
   VisualFrame::DescriptorsT& descriptors =
-      aslam::channels::get_DESCRIPTORS_Data(channels_);
+      aslam::channels::get_DESCRIPTORS_DataMutable(&channels_);
   descriptors = descriptors_new;
 }
 void VisualFrame::setTrackIds(const Eigen::VectorXi& track_ids_new) {
@@ -254,7 +301,7 @@ void VisualFrame::setTrackIds(const Eigen::VectorXi& track_ids_new) {
     aslam::channels::add_TRACK_IDS_Channel(&channels_);
   }
   Eigen::VectorXi& data =
-      aslam::channels::get_TRACK_IDS_Data(channels_);
+      aslam::channels::get_TRACK_IDS_DataMutable(&channels_);
   data = track_ids_new;
 }
 
@@ -263,8 +310,26 @@ void VisualFrame::setRawImage(const cv::Mat& image_new) {
     aslam::channels::add_RAW_IMAGE_Channel(&channels_);
   }
   cv::Mat& image =
-      aslam::channels::get_RAW_IMAGE_Data(channels_);
+      aslam::channels::get_RAW_IMAGE_DataMutable(&channels_);
   image = image_new;
+  if (hasCompressedRawImage()) {
+    aslam::channels::remove_RAW_IMAGE_COMPRESSED_Channel(&channels_);
+  }
+  releaseDecodedRawImage();
+}
+
+void VisualFrame::setCompressedRawImage(const cv::Mat& compressed_image) {
+  CHECK_EQ(compressed_image.type(), CV_8UC1);
+  if (!hasCompressedRawImage()) {
+    aslam::channels::add_RAW_IMAGE_COMPRESSED_Channel(&channels_);
+  }
+  cv::Mat& image =
+      aslam::channels::get_RAW_IMAGE_COMPRESSED_DataMutable(&channels_);
+  image = compressed_image;
+  if (aslam::channels::has_RAW_IMAGE_Channel(channels_)) {
+    aslam::channels::remove_RAW_IMAGE_Channel(&channels_);
+  }
+  releaseDecodedRawImage();
 }
 
 void VisualFrame::swapKeypointMeasurements(Eigen::Matrix2Xd* keypoints_new) {
@@ -272,7 +337,7 @@ void VisualFrame::swapKeypointMeasurements(Eigen::Matrix2Xd* keypoints_new) {
     aslam::channels::add_VISUAL_KEYPOINT_MEASUREMENTS_Channel(&channels_);
   }
   Eigen::Matrix2Xd& keypoints =
-      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENTS_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENTS_DataMutable(&channels_);
   keypoints.swap(*keypoints_new);
 }
 void VisualFrame::swapKeypointMeasurementUncertainties(Eigen::VectorXd* uncertainties_new) {
@@ -280,7 +345,7 @@ void VisualFrame::swapKeypointMeasurementUncertainties(Eigen::VectorXd* uncertai
     aslam::channels::add_VISUAL_KEYPOINT_MEASUREMENT_UNCERTAINTIES_Channel(&channels_);
   }
   Eigen::VectorXd& data =
-      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENT_UNCERTAINTIES_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENT_UNCERTAINTIES_DataMutable(&channels_);
   data.swap(*uncertainties_new);
 }
 void VisualFrame::swapKeypointScales(Eigen::VectorXd* scales_new) {
@@ -288,7 +353,7 @@ void VisualFrame::swapKeypointScales(Eigen::VectorXd* scales_new) {
     aslam::channels::add_VISUAL_KEYPOINT_SCALES_Channel(&channels_);
   }
   Eigen::VectorXd& data =
-      aslam::channels::get_VISUAL_KEYPOINT_SCALES_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_SCALES_DataMutable(&channels_);
   data.swap(*scales_new);
 }
 void VisualFrame::swapKeypointOrientations(Eigen::VectorXd* orientations_new) {
@@ -296,7 +361,7 @@ void VisualFrame::swapKeypointOrientations(Eigen::VectorXd* orientations_new) {
     aslam::channels::add_VISUAL_KEYPOINT_ORIENTATIONS_Channel(&channels_);
   }
   Eigen::VectorXd& data =
-      aslam::channels::get_VISUAL_KEYPOINT_ORIENTATIONS_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_ORIENTATIONS_DataMutable(&channels_);
   data.swap(*orientations_new);
 }
 void VisualFrame::swapKeypointScores(Eigen::VectorXd* scores_new) {
@@ -304,7 +369,7 @@ void VisualFrame::swapKeypointScores(Eigen::VectorXd* scores_new) {
     aslam::channels::add_VISUAL_KEYPOINT_SCORES_Channel(&channels_);
   }
   Eigen::VectorXd& data =
-      aslam::channels::get_VISUAL_KEYPOINT_SCORES_Data(channels_);
+      aslam::channels::get_VISUAL_KEYPOINT_SCORES_DataMutable(&channels_);
   data.swap(*scores_new);
 }
 void VisualFrame::swapDescriptors(DescriptorsT* descriptors_new) {
@@ -312,7 +377,7 @@ void VisualFrame::swapDescriptors(DescriptorsT* descriptors_new) {
     aslam::channels::add_DESCRIPTORS_Channel(&channels_);
   }
   VisualFrame::DescriptorsT& descriptors =
-      aslam::channels::get_DESCRIPTORS_Data(channels_);
+      aslam::channels::get_DESCRIPTORS_DataMutable(&channels_);
   descriptors.swap(*descriptors_new);
 }
 
@@ -320,7 +385,7 @@ void VisualFrame::swapTrackIds(Eigen::VectorXi* track_ids_new) {
   if (!aslam::channels::has_TRACK_IDS_Channel(channels_)) {
     aslam::channels::add_TRACK_IDS_Channel(&channels_);
   }
-  Eigen::VectorXi& track_ids = aslam::channels::get_TRACK_IDS_Data(channels_);
+  Eigen::VectorXi& track_ids = aslam::channels::get_TRACK_IDS_DataMutable(&channels_);
   track_ids.swap(*track_ids_new);
 }
 
@@ -432,9 +497,10 @@ Eigen::Matrix3Xd VisualFrame::getNormalizedBearingVectors(
     keypoints_reduced.col(list_idx++) = keypoints.col(keypoint_idx);
   }
 
-  Eigen::Matrix3Xd points_3d;
-  camera.backProject3Vectorized(keypoints_reduced, &points_3d, backprojection_success);
-  return points_3d.colwise().normalized();
+  Eigen::Matrix3Xd bearing_vectors;
+  camera.getNormalizedBearingVectors(
+      keypoints_reduced, &bearing_vectors, backprojection_success);
+  return bearing_vectors;
 }
 
 VisualFrame::Ptr VisualFrame::createEmptyTestVisualFrame(const aslam::Camera::ConstPtr& camera,
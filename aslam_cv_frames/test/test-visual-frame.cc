@@ -150,6 +150,34 @@ TEST(Frame, SetGetImage) {
   EXPECT_TRUE(gtest_catkin::ImagesEqual(data, data_2));
 }
 
+TEST(Frame, CompressedRawImage) {
+  aslam::VisualFrame frame;
+  EXPECT_FALSE(frame.hasRawImage());
+  cv::Mat image = cv::Mat(30, 20, CV_8UC1);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+  frame.setRawImage(image);
+  EXPECT_FALSE(frame.hasCompressedRawImage());
+
+  // Lossless compression gets decoded lazily to the original image.
+  frame.compressRawImage(".png");
+  EXPECT_TRUE(frame.hasRawImage());
+  EXPECT_TRUE(frame.hasCompressedRawImage());
+  EXPECT_NEAR_OPENCV(image, frame.getRawImage(), 0);
+  EXPECT_EQ(frame.getRawImage().data, frame.getRawImage().data);
+
+  // The decoded copy can be dropped and gets decoded again on demand.
+  frame.releaseDecodedRawImage();
+  EXPECT_NEAR_OPENCV(image, frame.getRawImage(), 0);
+
+  // Mutable access replaces the compressed image by the decoded one.
+  cv::Mat* image_mutable = frame.getRawImageMutable();
+  EXPECT_FALSE(frame.hasCompressedRawImage());
+  EXPECT_NEAR_OPENCV(image, *image_mutable, 0);
+
+  frame.releaseRawImage();
+  EXPECT_FALSE(frame.hasRawImage());
+}
+
 TEST(Frame, CopyConstructor) {
   aslam::Camera::Ptr camera = aslam::PinholeCamera::createTestCamera();
   aslam::VisualFrame frame;
@@ -201,6 +229,40 @@ TEST(Frame, CopyConstructor) {
   EXPECT_TRUE(frame == frame_cloned);
 }
 
+TEST(Frame, CopyOnWrite) {
+  aslam::VisualFrame frame;
+  constexpr size_t kNumRandomValues = 10;
+  Eigen::Matrix2Xd keypoints = Eigen::Matrix2Xd::Random(2, kNumRandomValues);
+  frame.setKeypointMeasurements(keypoints);
+  aslam::VisualFrame::DescriptorsT descriptors =
+      aslam::VisualFrame::DescriptorsT::Random(48, kNumRandomValues);
+  frame.setDescriptors(descriptors);
+
+  // The copy shares the channel data with the original frame.
+  aslam::VisualFrame frame_copy(frame);
+  EXPECT_EQ(&frame.getKeypointMeasurements(), &frame_copy.getKeypointMeasurements());
+  EXPECT_EQ(&frame.getDescriptors(), &frame_copy.getDescriptors());
+
+  // Writing to the copy detaches the written channel only.
+  Eigen::Matrix2Xd* keypoints_copy = frame_copy.getKeypointMeasurementsMutable();
+  EXPECT_NE(&frame.getKeypointMeasurements(), keypoints_copy);
+  EXPECT_EQ(&frame.getDescriptors(), &frame_copy.getDescriptors());
+  keypoints_copy->setZero();
+  EXPECT_TRUE(EIGEN_MATRIX_EQUAL(keypoints, frame.getKeypointMeasurements()));
+  EXPECT_TRUE(EIGEN_MATRIX_EQUAL(Eigen::Matrix2Xd::Zero(2, kNumRandomValues),
+                                 frame_copy.getKeypointMeasurements()));
+
+  // A detached channel is written in place.
+  EXPECT_EQ(keypoints_copy, frame_copy.getKeypointMeasurementsMutable());
+
+  // Swapping into the original detaches it from the copy.
+  aslam::VisualFrame::DescriptorsT descriptors_new =
+      aslam::VisualFrame::DescriptorsT::Zero(48, kNumRandomValues);
+  frame.swapDescriptors(&descriptors_new);
+  EXPECT_NE(&frame.getDescriptors(), &frame_copy.getDescriptors());
+  EXPECT_TRUE(EIGEN_MATRIX_EQUAL(descriptors, frame_copy.getDescriptors()));
+}
+
 TEST(Frame, getNormalizedBearingVectors) {
   // Create a test nframe with some keypoints.
   aslam::UnifiedProjectionCamera::Ptr camera = aslam::UnifiedProjectionCamera::createTestCamera();
@@ -93,7 +93,9 @@ private:
 template<typename MatchingProblem>
 bool MatchingEngineExclusive<MatchingProblem>::match(
     MatchingProblem* problem, typename MatchingProblem::MatchesWithScore* matches_A_B) {
-  timing::Timer method_timer("MatchingEngineExclusive<MatchingProblem>::match()");
+  static const size_t kTimerHandle =
+      timing::Timer::RegisterTag("MatchingEngineExclusive<MatchingProblem>::match()");
+  timing::Timer method_timer(kTimerHandle);
 
   CHECK_NOTNULL(problem);
   CHECK_NOTNULL(matches_A_B);
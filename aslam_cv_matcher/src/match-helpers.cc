@@ -1,6 +1,7 @@
 #include "aslam/matcher/match-helpers.h"
 
 #include <aslam/cameras/camera.h>
+#include <aslam/cameras/camera-dispatch.h>
 #include <aslam/common/stl-helpers.h>
 #include <aslam/frames/visual-frame.h>
 #include <Eigen/Core>
@@ -155,34 +156,45 @@ double getUnrotatedMatchPixelDisparityMedian(
       CHECK_EQ(static_cast<int>(success.size()), bearing_vectors_k.cols());
       CHECK_EQ(static_cast<int>(matches_kp1_k[cam_idx].size()), bearing_vectors_k.cols());
 
-      if (bearing_vectors_k.cols() == 0u) {
+      // Only project the bearing vectors that could be back-projected.
+      std::vector<size_t> valid_match_indices;
+      valid_match_indices.reserve(success.size());
+      for (size_t i = 0u; i < success.size(); ++i) {
+        if (success[i]) {
+          valid_match_indices.emplace_back(i);
+        } else {
+          ++projection_failed_counter;
+        }
+      }
+      if (valid_match_indices.empty()) {
         continue;
       }
+      Eigen::Matrix3Xd valid_bearing_vectors_k(3, valid_match_indices.size());
+      for (size_t i = 0u; i < valid_match_indices.size(); ++i) {
+        valid_bearing_vectors_k.col(i) = bearing_vectors_k.col(valid_match_indices[i]);
+      }
 
       // Rotate the bearing vectors into the frame_kp1 coordinates.
-      Eigen::Matrix3Xd bearing_vectors_k_kp1 = q_kp1_k.rotateVectorized(bearing_vectors_k);
+      Eigen::Matrix3Xd bearing_vectors_k_kp1 =
+          q_kp1_k.rotateVectorized(valid_bearing_vectors_k);
 
       // Project the bearing vectors to the frame kp1 and calculate the disparity.
       const Eigen::Matrix2Xd& keypoints_kp1 =
           nframe_kp1.getFrame(cam_idx).getKeypointMeasurements();
-      for (int i = 0; i < bearing_vectors_k_kp1.cols(); ++i) {
-        if (success[i]) {
-          Eigen::Vector2d rotated_k_keypoint;
-          aslam::ProjectionResult projection_result =
-              nframe_kp1.getCamera(cam_idx).project3(bearing_vectors_k_kp1.col(i),
-                                                     &rotated_k_keypoint);
-          if (projection_result == aslam::ProjectionResult::KEYPOINT_VISIBLE) {
-            const size_t kp1_match_index = matches_kp1_k[cam_idx][i].first;
-            CHECK_LT(static_cast<int>(kp1_match_index), keypoints_kp1.cols());
-            disparity_px.emplace_back((keypoints_kp1.col(kp1_match_index)
-                - rotated_k_keypoint).norm());
-          } else {
-            ++projection_failed_counter;
-          }
+      aslam::applyProjectionKernel(
+          nframe_kp1.getCamera(cam_idx), bearing_vectors_k_kp1,
+          [&](int i, const Eigen::Vector2d& rotated_k_keypoint,
+              const aslam::ProjectionResult& projection_result) {
+        if (projection_result == aslam::ProjectionResult::KEYPOINT_VISIBLE) {
+          const size_t kp1_match_index =
+              matches_kp1_k[cam_idx][valid_match_indices[i]].first;
+          CHECK_LT(static_cast<int>(kp1_match_index), keypoints_kp1.cols());
+          disparity_px.emplace_back((keypoints_kp1.col(kp1_match_index)
+              - rotated_k_keypoint).norm());
         } else {
           ++projection_failed_counter;
         }
-      }
+      });
     }
   }
   CHECK_EQ(disparity_px.size() + projection_failed_counter, num_matches);
@@ -0,0 +1,105 @@
+#ifndef ASLAM_PIPELINE_CALIBRATION_CACHE_H_
+#define ASLAM_PIPELINE_CALIBRATION_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <aslam/cameras/ncamera.h>
+#include <aslam/common/macros.h>
+#include <aslam/common/types.h>
+#include <aslam/pipeline/undistorter-mapped.h>
+
+namespace aslam {
+
+/// \brief Settings of the mapped undistorters of a calibration cache, see
+///        \ref createMappedUndistorter.
+struct UndistorterSettings {
+  float alpha = 0.0f;
+  float scale = 1.0f;
+  InterpolationMethod interpolation = InterpolationMethod::Linear;
+};
+
+/// \brief Key of a calibration cache: a hash of the calibration file, of the undistorter
+///        settings and of the cache format. Hashing the file is much cheaper than parsing it.
+/// @param[in] calibration Contents of the calibration file.
+/// @param[in] settings    Settings of the undistorters.
+uint64_t computeCalibrationCacheKey(
+    const std::string& calibration, const UndistorterSettings& settings);
+
+/// \class CalibrationCache
+/// \brief A camera rig with a mapped undistorter and a bearing vector lookup table per
+///        camera, which can be stored in a binary file to skip the YAML parsing and the
+///        computation of the maps and tables at startup.
+///
+/// The file starts with a header that holds the key of the calibration, the size of the
+/// payload and a checksum over the payload. Loading reads the file in one go and rejects
+/// it if the header does not match or the checksum fails, the caller then falls back to
+/// the YAML calibration. The file stores the values in the byte order of the machine that
+/// wrote it and is meant as a local cache, not for distribution.
+///
+/// Only pinhole and unified projection cameras are supported, like in
+/// \ref createMappedUndistorter, see \ref isSupported.
+class CalibrationCache {
+ public:
+  ASLAM_POINTER_TYPEDEFS(CalibrationCache);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(CalibrationCache);
+
+  /// \brief Returns true if all cameras of the rig have a mapped undistorter.
+  static bool isSupported(const NCamera& ncamera);
+
+  /// \brief Builds the undistorters and the bearing vector lookup tables of a copy of the
+  ///        camera rig. The rig must be supported, see \ref isSupported.
+  CalibrationCache(const NCamera& ncamera, const UndistorterSettings& settings);
+
+  ~CalibrationCache() = default;
+
+  /// \brief Loads the calibration cache of a YAML calibration file. If the cache file is
+  ///        missing or does not belong to the calibration, the calibration is parsed, the
+  ///        cache is built and written to the cache file.
+  /// @param[in] ncamera_yaml_file The YAML calibration of the camera rig.
+  /// @param[in] cache_file        The binary cache file.
+  /// @param[in] settings          Settings of the undistorters.
+  /// @return The cache, nullptr if the calibration can not be loaded or contains an
+  ///         unsupported camera.
+  static std::unique_ptr<CalibrationCache> loadOrBuild(
+      const std::string& ncamera_yaml_file, const std::string& cache_file,
+      const UndistorterSettings& settings);
+
+  /// \brief Loads a cache file.
+  /// @param[in] cache_file The binary cache file.
+  /// @param[in] key        Expected key of the calibration, see
+  ///                       \ref computeCalibrationCacheKey.
+  /// @return The cache, nullptr if the file is missing, belongs to another calibration or
+  ///         is corrupted.
+  static std::unique_ptr<CalibrationCache> loadFromFile(
+      const std::string& cache_file, uint64_t key);
+
+  /// \brief Writes the cache to a file. The file is written to a unique temporary file in
+  ///        the same directory first and then renamed, so it is replaced atomically.
+  /// @param[in] cache_file The binary cache file.
+  /// @param[in] key        Key of the calibration, see \ref computeCalibrationCacheKey.
+  /// @return False if the file can not be written.
+  bool saveToFile(const std::string& cache_file, uint64_t key) const;
+
+  /// The camera rig. The bearing vector lookup tables of its cameras are enabled.
+  const NCamera& getNCamera() const { return *ncamera_; }
+  NCamera::Ptr getNCameraShared() const { return ncamera_; }
+
+  /// The undistorter of camera i.
+  const MappedUndistorter& getUndistorter(size_t camera_index) const;
+
+  const UndistorterSettings& getUndistorterSettings() const { return settings_; }
+
+ private:
+  explicit CalibrationCache(const UndistorterSettings& settings);
+
+  NCamera::Ptr ncamera_;
+  std::vector<std::unique_ptr<MappedUndistorter>> undistorters_;
+  UndistorterSettings settings_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_PIPELINE_CALIBRATION_CACHE_H_
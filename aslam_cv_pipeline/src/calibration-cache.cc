@@ -0,0 +1,568 @@
+#include "aslam/pipeline/calibration-cache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+
+#include <unistd.h>
+
+#include <aslam/cameras/bearing-lookup-table.h>
+#include <aslam/cameras/camera-factory.h>
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/camera-unified-projection.h>
+#include <aslam/common/pose-types.h>
+#include <aslam/common/unique-id.h>
+#include <aslam/common/yaml-serialization.h>
+#include <glog/logging.h>
+
+namespace aslam {
+
+namespace {
+constexpr char kCacheMagic[8] = {'A', 'S', 'L', 'A', 'M', 'C', 'A', 'L'};
+// Increment on every change of the payload layout.
+constexpr uint32_t kCacheFormatVersion = 1u;
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t header_size;
+  uint64_t key;
+  uint64_t payload_size;
+  uint64_t payload_checksum;
+};
+
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+// FNV-1a that consumes eight bytes per step, fast enough to check the maps on every load.
+uint64_t hashBytes(const char* data, size_t size, uint64_t hash = kFnvOffsetBasis) {
+  size_t pos = 0u;
+  for (; pos + sizeof(uint64_t) <= size; pos += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + pos, sizeof(word));
+    hash = (hash ^ word) * kFnvPrime;
+  }
+  for (; pos < size; ++pos) {
+    hash = (hash ^ static_cast<unsigned char>(data[pos])) * kFnvPrime;
+  }
+  return hash;
+}
+
+// Appends values in the byte order of the machine.
+class BinaryWriter {
+ public:
+  template <typename Type>
+  void write(const Type& value) {
+    static_assert(std::is_trivially_copyable<Type>::value, "Only plain data is written.");
+    buffer_.append(reinterpret_cast<const char*>(&value), sizeof(Type));
+  }
+
+  void writeBytes(const void* data, size_t size) {
+    write<uint64_t>(size);
+    buffer_.append(static_cast<const char*>(data), size);
+  }
+
+  void writeString(const std::string& value) {
+    writeBytes(value.data(), value.size());
+  }
+
+  void writeId(const SensorId& id) {
+    HashId hash_id;
+    id.toHashId(&hash_id);
+    uint64_t words[2];
+    hash_id.toUint64(words);
+    write(words);
+  }
+
+  void writeVector(const Eigen::VectorXd& vector) {
+    writeBytes(vector.data(), vector.size() * sizeof(double));
+  }
+
+  void writeMat(const cv::Mat& mat) {
+    write<int32_t>(mat.rows);
+    write<int32_t>(mat.cols);
+    write<int32_t>(mat.type());
+    const size_t row_size = mat.cols * mat.elemSize();
+    write<uint64_t>(mat.rows * row_size);
+    for (int row = 0; row < mat.rows; ++row) {
+      buffer_.append(reinterpret_cast<const char*>(mat.ptr(row)), row_size);
+    }
+  }
+
+  const std::string& buffer() const {
+    return buffer_;
+  }
+
+ private:
+  std::string buffer_;
+};
+
+// Reads the values written by BinaryWriter. Every read fails instead of reading past the
+// end of the data, so truncated files are rejected.
+class BinaryReader {
+ public:
+  BinaryReader(const char* data, size_t size) : data_(data), size_(size), pos_(0u) {}
+
+  template <typename Type>
+  bool read(Type* value) {
+    static_assert(std::is_trivially_copyable<Type>::value, "Only plain data is read.");
+    const char* bytes = take(sizeof(Type));
+    if (bytes == nullptr) {
+      return false;
+    }
+    memcpy(value, bytes, sizeof(Type));
+    return true;
+  }
+
+  bool readBytes(const char** out_data, size_t* out_size) {
+    uint64_t size;
+    if (!read(&size) || size > size_ - pos_) {
+      return false;
+    }
+    *out_size = size;
+    *out_data = take(size);
+    return true;
+  }
+
+  bool readString(std::string* value) {
+    const char* data;
+    size_t size;
+    if (!readBytes(&data, &size)) {
+      return false;
+    }
+    value->assign(data, size);
+    return true;
+  }
+
+  template <typename IdType>
+  bool readId(IdType* id) {
+    uint64_t words[2];
+    if (!read(&words)) {
+      return false;
+    }
+    id->fromHashId(HashId(words));
+    return id->isValid();
+  }
+
+  bool readVector(Eigen::VectorXd* vector) {
+    const char* data;
+    size_t size;
+    if (!readBytes(&data, &size) || size % sizeof(double) != 0u) {
+      return false;
+    }
+    vector->resize(size / sizeof(double));
+    memcpy(vector->data(), data, size);
+    return true;
+  }
+
+  bool readMat(cv::Mat* mat) {
+    int32_t rows, cols, type;
+    const char* data;
+    size_t size;
+    if (!read(&rows) || !read(&cols) || !read(&type) || !readBytes(&data, &size) ||
+        rows < 0 || cols < 0) {
+      return false;
+    }
+    if (rows == 0 || cols == 0) {
+      *mat = cv::Mat();
+      return size == 0u;
+    }
+    mat->create(rows, cols, type);
+    const size_t row_size = cols * mat->elemSize();
+    if (size != rows * row_size) {
+      return false;
+    }
+    for (int row = 0; row < rows; ++row) {
+      memcpy(mat->ptr(row), data + row * row_size, row_size);
+    }
+    return true;
+  }
+
+  bool isAtEnd() const {
+    return pos_ == size_;
+  }
+
+ private:
+  const char* take(size_t size) {
+    if (size > size_ - pos_) {
+      return nullptr;
+    }
+    const char* bytes = data_ + pos_;
+    pos_ += size;
+    return bytes;
+  }
+
+  const char* data_;
+  size_t size_;
+  size_t pos_;
+};
+
+// Reads a whole file in binary mode. Returns false if the file can not be read.
+bool readFile(const std::string& filename, std::string* contents) {
+  CHECK_NOTNULL(contents);
+  std::ifstream stream(filename, std::ios::binary | std::ios::ate);
+  if (!stream.is_open()) {
+    return false;
+  }
+  const std::streamoff size = stream.tellg();
+  if (size < 0) {
+    return false;
+  }
+  contents->resize(static_cast<size_t>(size));
+  stream.seekg(0, std::ios::beg);
+  stream.read(&(*contents)[0], size);
+  return stream.good();
+}
+
+// Writes all bytes to a file descriptor, retrying partial writes.
+bool writeAll(int file_descriptor, const char* data, size_t size) {
+  while (size > 0u) {
+    const ssize_t num_written = write(file_descriptor, data, size);
+    if (num_written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += num_written;
+    size -= static_cast<size_t>(num_written);
+  }
+  return true;
+}
+
+void writeSensor(const Sensor& sensor, BinaryWriter* writer) {
+  writer->writeId(sensor.getId());
+  writer->writeString(sensor.getTopic());
+  writer->writeString(sensor.getDescription());
+}
+
+template <typename IdType>
+bool readSensor(
+    BinaryReader* reader, IdType* id, std::string* topic, std::string* description) {
+  return reader->readId(id) && reader->readString(topic) && reader->readString(description);
+}
+
+Camera::Ptr createUndistortedCamera(
+    Camera::Type camera_type, const Eigen::VectorXd& intrinsics, uint32_t image_width,
+    uint32_t image_height) {
+  switch (camera_type) {
+    case Camera::Type::kPinhole:
+      return Camera::Ptr(new PinholeCamera(intrinsics, image_width, image_height));
+    case Camera::Type::kUnifiedProjection:
+      return Camera::Ptr(new UnifiedProjectionCamera(intrinsics, image_width, image_height));
+    default:
+      return nullptr;
+  }
+}
+}  // namespace
+
+uint64_t computeCalibrationCacheKey(
+    const std::string& calibration, const UndistorterSettings& settings) {
+  BinaryWriter writer;
+  writer.write(kCacheFormatVersion);
+  writer.write(settings.alpha);
+  writer.write(settings.scale);
+  writer.write(static_cast<int32_t>(settings.interpolation));
+  writer.writeString(calibration);
+  return hashBytes(writer.buffer().data(), writer.buffer().size());
+}
+
+bool CalibrationCache::isSupported(const NCamera& ncamera) {
+  for (size_t camera_idx = 0u; camera_idx < ncamera.getNumCameras(); ++camera_idx) {
+    const Camera::Type camera_type = ncamera.getCamera(camera_idx).getType();
+    if (camera_type != Camera::Type::kPinhole &&
+        camera_type != Camera::Type::kUnifiedProjection) {
+      return false;
+    }
+  }
+  return true;
+}
+
+CalibrationCache::CalibrationCache(const UndistorterSettings& settings) : settings_(settings) {}
+
+CalibrationCache::CalibrationCache(
+    const NCamera& ncamera, const UndistorterSettings& settings)
+    : ncamera_(ncamera.cloneToShared()), settings_(settings) {
+  CHECK(isSupported(*ncamera_)) << "The camera rig contains an unsupported camera type.";
+  for (size_t camera_idx = 0u; camera_idx < ncamera_->getNumCameras(); ++camera_idx) {
+    Camera& camera = ncamera_->getCameraMutable(camera_idx);
+    undistorters_.emplace_back(createMappedUndistorter(
+        camera, settings_.alpha, settings_.scale, settings_.interpolation));
+    camera.setBearingLookupTableEnabled(true);
+    CHECK(camera.getBearingLookupTable());
+  }
+}
+
+const MappedUndistorter& CalibrationCache::getUndistorter(size_t camera_index) const {
+  CHECK_LT(camera_index, undistorters_.size());
+  return *CHECK_NOTNULL(undistorters_[camera_index].get());
+}
+
+std::unique_ptr<CalibrationCache> CalibrationCache::loadOrBuild(
+    const std::string& ncamera_yaml_file, const std::string& cache_file,
+    const UndistorterSettings& settings) {
+  std::ifstream yaml_stream(ncamera_yaml_file);
+  if (!yaml_stream.is_open()) {
+    LOG(ERROR) << "Failed to open the calibration file " << ncamera_yaml_file;
+    return nullptr;
+  }
+  std::stringstream calibration;
+  calibration << yaml_stream.rdbuf();
+  const uint64_t key = computeCalibrationCacheKey(calibration.str(), settings);
+
+  std::unique_ptr<CalibrationCache> cache = loadFromFile(cache_file, key);
+  if (cache) {
+    return cache;
+  }
+
+  VLOG(1) << "No valid calibration cache in " << cache_file << ", building it.";
+  NCamera::Ptr ncamera = aligned_shared<NCamera>();
+  if (!ncamera->deserialize(YAML::Load(calibration.str()))) {
+    LOG(ERROR) << "Failed to parse the calibration file " << ncamera_yaml_file;
+    return nullptr;
+  }
+  if (!isSupported(*ncamera)) {
+    LOG(ERROR) << "The calibration file " << ncamera_yaml_file << " contains a camera "
+               << "type without a mapped undistorter.";
+    return nullptr;
+  }
+  cache.reset(new CalibrationCache(*ncamera, settings));
+  LOG_IF(WARNING, !cache->saveToFile(cache_file, key))
+      << "Failed to write the calibration cache " << cache_file;
+  return cache;
+}
+
+bool CalibrationCache::saveToFile(const std::string& cache_file, uint64_t key) const {
+  BinaryWriter writer;
+  writer.write(settings_.alpha);
+  writer.write(settings_.scale);
+  writer.write(static_cast<int32_t>(settings_.interpolation));
+
+  writeSensor(*ncamera_, &writer);
+  TransformationCovariance covariance;
+  const bool has_covariance = ncamera_->get_T_G_B_fixed_localization_covariance(&covariance);
+  writer.write<uint8_t>(has_covariance);
+  if (has_covariance) {
+    writer.writeBytes(covariance.data(), covariance.size() * sizeof(double));
+  }
+
+  const size_t num_cameras = ncamera_->getNumCameras();
+  writer.write<uint64_t>(num_cameras);
+  for (size_t camera_idx = 0u; camera_idx < num_cameras; ++camera_idx) {
+    const Camera& camera = ncamera_->getCamera(camera_idx);
+    writeSensor(camera, &writer);
+    writer.write<int32_t>(static_cast<int32_t>(camera.getType()));
+    writer.write<int32_t>(static_cast<int32_t>(camera.getDistortion().getType()));
+    writer.write<uint32_t>(camera.imageWidth());
+    writer.write<uint32_t>(camera.imageHeight());
+    writer.write<uint64_t>(camera.getLineDelayNanoSeconds());
+    writer.write<uint8_t>(camera.hasCompressedImages());
+    writer.writeVector(camera.getParameters());
+    writer.writeVector(camera.getDistortion().getParameters());
+    writer.writeMat(camera.getMask());
+
+    const Transformation& T_C_B = ncamera_->get_T_C_B(camera_idx);
+    const Quaternion& q_C_B = T_C_B.getRotation();
+    const Position3D& p_C_B = T_C_B.getPosition();
+    const double pose[7] = {q_C_B.w(), q_C_B.x(), q_C_B.y(), q_C_B.z(),
+                            p_C_B[0], p_C_B[1], p_C_B[2]};
+    writer.write(pose);
+
+    const MappedUndistorter& undistorter = *undistorters_[camera_idx];
+    const Camera& output_camera = undistorter.getOutputCamera();
+    writer.writeId(output_camera.getId());
+    writer.write<int32_t>(static_cast<int32_t>(output_camera.getType()));
+    writer.write<uint32_t>(output_camera.imageWidth());
+    writer.write<uint32_t>(output_camera.imageHeight());
+    writer.writeVector(output_camera.getParameters());
+    writer.writeMat(undistorter.getUndistortMapU());
+    writer.writeMat(undistorter.getUndistortMapV());
+
+    const bool has_table = camera.isBearingLookupTableEnabled();
+    writer.write<uint8_t>(has_table);
+    if (has_table) {
+      std::shared_ptr<const BearingLookupTable> table = camera.getBearingLookupTable();
+      const Eigen::Matrix3Xf& bearings = table->getBearings();
+      writer.writeBytes(bearings.data(), bearings.size() * sizeof(float));
+      const std::vector<unsigned char>& is_valid = table->getNodeValidity();
+      writer.writeBytes(is_valid.data(), is_valid.size());
+    }
+  }
+
+  CacheHeader header;
+  memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+  header.format_version = kCacheFormatVersion;
+  header.header_size = sizeof(CacheHeader);
+  header.key = key;
+  header.payload_size = writer.buffer().size();
+  header.payload_checksum = hashBytes(writer.buffer().data(), writer.buffer().size());
+
+  // Write to a unique temporary file next to the cache file and rename it, so concurrent
+  // writers do not interfere and a reader never sees a partial file.
+  std::string temporary_file = cache_file + ".XXXXXX";
+  const int file_descriptor = mkstemp(&temporary_file[0]);
+  if (file_descriptor < 0) {
+    return false;
+  }
+  const bool written =
+      writeAll(file_descriptor, reinterpret_cast<const char*>(&header), sizeof(header)) &&
+      writeAll(file_descriptor, writer.buffer().data(), writer.buffer().size());
+  if (close(file_descriptor) != 0 || !written ||
+      std::rename(temporary_file.c_str(), cache_file.c_str()) != 0) {
+    unlink(temporary_file.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<CalibrationCache> CalibrationCache::loadFromFile(
+    const std::string& cache_file, uint64_t key) {
+  std::string file;
+  if (!readFile(cache_file, &file) || file.size() < sizeof(CacheHeader)) {
+    VLOG(1) << "No calibration cache in " << cache_file;
+    return nullptr;
+  }
+  CacheHeader header;
+  memcpy(&header, file.data(), sizeof(header));
+  if (memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+      header.format_version != kCacheFormatVersion ||
+      header.header_size != sizeof(CacheHeader) || header.key != key ||
+      header.payload_size != file.size() - sizeof(CacheHeader)) {
+    VLOG(1) << "The calibration cache " << cache_file << " belongs to another calibration.";
+    return nullptr;
+  }
+  const char* payload = file.data() + sizeof(CacheHeader);
+  if (hashBytes(payload, header.payload_size) != header.payload_checksum) {
+    LOG(WARNING) << "The calibration cache " << cache_file << " is corrupted.";
+    return nullptr;
+  }
+
+  BinaryReader reader(payload, header.payload_size);
+  UndistorterSettings settings;
+  int32_t interpolation;
+  if (!reader.read(&settings.alpha) || !reader.read(&settings.scale) ||
+      !reader.read(&interpolation)) {
+    return nullptr;
+  }
+  settings.interpolation = static_cast<InterpolationMethod>(interpolation);
+  std::unique_ptr<CalibrationCache> cache(new CalibrationCache(settings));
+
+  NCameraId ncamera_id;
+  std::string ncamera_topic, ncamera_description;
+  uint8_t has_covariance;
+  if (!readSensor(&reader, &ncamera_id, &ncamera_topic, &ncamera_description) ||
+      !reader.read(&has_covariance)) {
+    return nullptr;
+  }
+  TransformationCovariance covariance;
+  if (has_covariance) {
+    const char* data;
+    size_t size;
+    if (!reader.readBytes(&data, &size) || size != covariance.size() * sizeof(double)) {
+      return nullptr;
+    }
+    memcpy(covariance.data(), data, size);
+  }
+
+  uint64_t num_cameras;
+  if (!reader.read(&num_cameras) || num_cameras == 0u) {
+    return nullptr;
+  }
+  TransformationVector T_C_B_vector;
+  std::vector<Camera::Ptr> cameras;
+  std::vector<std::shared_ptr<const BearingLookupTable>> tables;
+  for (uint64_t camera_idx = 0u; camera_idx < num_cameras; ++camera_idx) {
+    CameraId camera_id;
+    std::string topic, description;
+    int32_t camera_type, distortion_type;
+    uint32_t image_width, image_height;
+    uint64_t line_delay_nanoseconds;
+    uint8_t is_compressed;
+    Eigen::VectorXd intrinsics, distortion_parameters;
+    cv::Mat mask;
+    double pose[7];
+    if (!readSensor(&reader, &camera_id, &topic, &description) ||
+        !reader.read(&camera_type) || !reader.read(&distortion_type) ||
+        !reader.read(&image_width) || !reader.read(&image_height) ||
+        !reader.read(&line_delay_nanoseconds) || !reader.read(&is_compressed) ||
+        !reader.readVector(&intrinsics) || !reader.readVector(&distortion_parameters) ||
+        !reader.readMat(&mask) || !reader.read(&pose)) {
+      return nullptr;
+    }
+    Camera::Ptr camera = createCamera(
+        camera_id, intrinsics, image_width, image_height, distortion_parameters,
+        static_cast<Camera::Type>(camera_type),
+        static_cast<Distortion::Type>(distortion_type));
+    camera->setTopic(topic);
+    camera->setDescription(description);
+    camera->setLineDelayNanoSeconds(line_delay_nanoseconds);
+    camera->setCompressedImages(is_compressed);
+    if (!mask.empty()) {
+      camera->setMask(mask);
+    }
+    T_C_B_vector.emplace_back(
+        Quaternion(pose[0], pose[1], pose[2], pose[3]),
+        Position3D(pose[4], pose[5], pose[6]));
+
+    CameraId output_camera_id;
+    int32_t output_camera_type;
+    uint32_t output_width, output_height;
+    Eigen::VectorXd output_intrinsics;
+    cv::Mat map_u, map_v;
+    if (!reader.readId(&output_camera_id) || !reader.read(&output_camera_type) ||
+        !reader.read(&output_width) || !reader.read(&output_height) ||
+        !reader.readVector(&output_intrinsics) || !reader.readMat(&map_u) || !reader.readMat(&map_v)) {
+      return nullptr;
+    }
+    Camera::Ptr output_camera = createUndistortedCamera(
+        static_cast<Camera::Type>(output_camera_type), output_intrinsics, output_width,
+        output_height);
+    if (!output_camera) {
+      return nullptr;
+    }
+    output_camera->setId(output_camera_id);
+    cache->undistorters_.emplace_back(new MappedUndistorter(
+        Camera::Ptr(camera->clone()), output_camera, map_u, map_v, settings.interpolation));
+
+    uint8_t has_table;
+    if (!reader.read(&has_table)) {
+      return nullptr;
+    }
+    if (has_table) {
+      const char* data;
+      size_t size;
+      const int num_nodes = (image_width + 1) * (image_height + 1);
+      Eigen::Matrix3Xf bearings(3, num_nodes);
+      if (!reader.readBytes(&data, &size) || size != bearings.size() * sizeof(float)) {
+        return nullptr;
+      }
+      memcpy(bearings.data(), data, size);
+      if (!reader.readBytes(&data, &size) || size != static_cast<size_t>(num_nodes)) {
+        return nullptr;
+      }
+      const std::vector<unsigned char> is_valid(data, data + size);
+      camera->setBearingLookupTable(std::make_shared<const BearingLookupTable>(
+          *camera, bearings, is_valid));
+    }
+    cameras.emplace_back(camera);
+  }
+  if (!reader.isAtEnd()) {
+    return nullptr;
+  }
+
+  if (has_covariance) {
+    cache->ncamera_ = aligned_shared<NCamera>(
+        ncamera_id, T_C_B_vector, covariance, cameras, ncamera_description);
+  } else {
+    cache->ncamera_ =
+        aligned_shared<NCamera>(ncamera_id, T_C_B_vector, cameras, ncamera_description);
+  }
+  cache->ncamera_->setTopic(ncamera_topic);
+  return cache;
+}
+
+}  // namespace aslam
@@ -4,6 +4,7 @@
 #include <aslam/cameras/ncamera.h>
 #include <aslam/cameras/random-camera-generator.h>
 #include <aslam/common/memory.h>
+#include <aslam/common/profiler.h>
 #include <aslam/common/thread-pool.h>
 #include <aslam/common/time.h>
 #include <aslam/frames/visual-nframe.h>
@@ -214,6 +215,9 @@ size_t VisualNPipeline::getNumFramesProcessing() const {
 
 void VisualNPipeline::work(size_t camera_index, const cv::Mat& image,
                            int64_t timestamp_nanoseconds) {
+  static const size_t kProfileHandle =
+      timing::ScopedProfile::RegisterTag("VisualNPipeline::work");
+  timing::ScopedProfile profile(kProfileHandle);
   CHECK_LE(camera_index, pipelines_.size());
   std::shared_ptr<VisualFrame> frame;
   frame = pipelines_[camera_index]->processImage(image, timestamp_nanoseconds);
@@ -221,6 +225,9 @@ void VisualNPipeline::work(size_t camera_index, const cv::Mat& image,
   /// Create an iterator into the processing queue.
   std::map<int64_t, std::shared_ptr<VisualNFrame>>::iterator proc_it;
   {
+    static const size_t kAssembleProfileHandle =
+        timing::ScopedProfile::RegisterTag("VisualNPipeline::work::assembleNFrame");
+    timing::ScopedProfile assemble_profile(kAssembleProfileHandle);
     std::lock_guard<std::mutex> lock(mutex_);
     bool create_new_nframes = false;
     if (processing_.empty()) {
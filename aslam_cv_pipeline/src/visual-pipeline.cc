@@ -1,6 +1,7 @@
 #include <aslam/pipeline/visual-pipeline.h>
 
 #include <aslam/cameras/camera.h>
+#include <aslam/common/profiler.h>
 #include <aslam/frames/visual-frame.h>
 #include <aslam/pipeline/undistorter.h>
 
@@ -27,6 +28,9 @@ VisualPipeline::VisualPipeline(std::unique_ptr<Undistorter>& preprocessing, bool
 
 std::shared_ptr<VisualFrame> VisualPipeline::processImage(const cv::Mat& raw_image,
                                                           int64_t timestamp) const {
+  static const size_t kProfileHandle =
+      timing::ScopedProfile::RegisterTag("VisualPipeline::processImage");
+  timing::ScopedProfile profile(kProfileHandle);
   CHECK_EQ(input_camera_->imageWidth(), static_cast<size_t>(raw_image.cols));
   CHECK_EQ(input_camera_->imageHeight(), static_cast<size_t>(raw_image.rows));
 
@@ -46,12 +50,20 @@ std::shared_ptr<VisualFrame> VisualPipeline::processImage(const cv::Mat& raw_ima
 
   cv::Mat image;
   if(preprocessing_) {
+    static const size_t kPreprocessingProfileHandle =
+        timing::ScopedProfile::RegisterTag("VisualPipeline::processImage::preprocessing");
+    timing::ScopedProfile preprocessing_profile(kPreprocessingProfileHandle);
     preprocessing_->processImage(raw_image, &image);
   } else {
     image = raw_image;
   }
   /// Send the image to the derived class for processing
-  processFrameImpl(image, frame.get());
+  {
+    static const size_t kProcessFrameProfileHandle =
+        timing::ScopedProfile::RegisterTag("VisualPipeline::processImage::processFrameImpl");
+    timing::ScopedProfile process_frame_profile(kProcessFrameProfileHandle);
+    processFrameImpl(image, frame.get());
+  }
 
   return frame;
 }
@@ -0,0 +1,189 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <Eigen/Core>
+#include <eigen-checks/gtest.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/bearing-lookup-table.h>
+#include <aslam/cameras/camera-3d-lidar.h>
+#include <aslam/cameras/ncamera.h>
+#include <aslam/cameras/random-camera-generator.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/unique-id.h>
+#include <aslam/pipeline/calibration-cache.h>
+
+namespace {
+bool areMatsEqual(const cv::Mat& lhs, const cv::Mat& rhs) {
+  if (lhs.rows != rhs.rows || lhs.cols != rhs.cols || lhs.type() != rhs.type()) {
+    return false;
+  }
+  const size_t row_size = lhs.cols * lhs.elemSize();
+  for (int row = 0; row < lhs.rows; ++row) {
+    if (memcmp(lhs.ptr(row), rhs.ptr(row), row_size) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string readFile(const std::string& filename) {
+  std::ifstream stream(filename, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& filename, const std::string& contents) {
+  std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+  stream.write(contents.data(), contents.size());
+}
+
+void expectCachesEqual(
+    const aslam::CalibrationCache& expected, const aslam::CalibrationCache& actual) {
+  ASSERT_TRUE(expected.getNCamera().isEqual(actual.getNCamera(), true /*verbose*/));
+  EXPECT_EQ(expected.getNCamera().getTopic(), actual.getNCamera().getTopic());
+  const size_t num_cameras = expected.getNCamera().getNumCameras();
+  for (size_t camera_idx = 0u; camera_idx < num_cameras; ++camera_idx) {
+    const aslam::Camera& expected_camera = expected.getNCamera().getCamera(camera_idx);
+    const aslam::Camera& actual_camera = actual.getNCamera().getCamera(camera_idx);
+    EXPECT_EQ(expected_camera.getTopic(), actual_camera.getTopic());
+
+    const aslam::MappedUndistorter& expected_undistorter = expected.getUndistorter(camera_idx);
+    const aslam::MappedUndistorter& actual_undistorter = actual.getUndistorter(camera_idx);
+    EXPECT_TRUE(expected_undistorter.getOutputCamera().isEqual(
+        actual_undistorter.getOutputCamera(), true /*verbose*/));
+    EXPECT_TRUE(areMatsEqual(
+        expected_undistorter.getUndistortMapU(), actual_undistorter.getUndistortMapU()));
+    EXPECT_TRUE(areMatsEqual(
+        expected_undistorter.getUndistortMapV(), actual_undistorter.getUndistortMapV()));
+
+    ASSERT_TRUE(actual_camera.isBearingLookupTableEnabled());
+    std::shared_ptr<const aslam::BearingLookupTable> expected_table =
+        expected_camera.getBearingLookupTable();
+    std::shared_ptr<const aslam::BearingLookupTable> actual_table =
+        actual_camera.getBearingLookupTable();
+    EXPECT_TRUE(EIGEN_MATRIX_EQUAL(expected_table->getBearings(), actual_table->getBearings()));
+    EXPECT_EQ(expected_table->getNodeValidity(), actual_table->getNodeValidity());
+  }
+}
+}  // namespace
+
+class CalibrationCacheTest : public testing::Test {
+ protected:
+  CalibrationCacheTest()
+      : yaml_file_("test_calibration_cache.yaml"), cache_file_("test_calibration_cache.bin") {}
+
+  virtual void SetUp() {
+    ncamera_ = aslam::createTestNCamera(2u);
+    ncamera_->setTopic("rig");
+    ncamera_->serializeToFile(yaml_file_);
+    key_ = aslam::computeCalibrationCacheKey(readFile(yaml_file_), settings_);
+  }
+
+  virtual void TearDown() {
+    std::remove(yaml_file_.c_str());
+    std::remove(cache_file_.c_str());
+  }
+
+  const std::string yaml_file_;
+  const std::string cache_file_;
+  aslam::UndistorterSettings settings_;
+  aslam::NCamera::Ptr ncamera_;
+  uint64_t key_;
+};
+
+TEST_F(CalibrationCacheTest, SaveAndLoad) {
+  aslam::CalibrationCache cache(*ncamera_, settings_);
+  ASSERT_TRUE(cache.saveToFile(cache_file_, key_));
+
+  std::unique_ptr<aslam::CalibrationCache> loaded_cache =
+      aslam::CalibrationCache::loadFromFile(cache_file_, key_);
+  ASSERT_TRUE(loaded_cache != nullptr);
+  expectCachesEqual(cache, *loaded_cache);
+
+  // The restored tables give the same bearings as the cameras they were built for.
+  const aslam::Camera& camera = loaded_cache->getNCamera().getCamera(0u);
+  Eigen::Matrix2Xd keypoints(2, 2);
+  keypoints << 10.5, 200.25,
+               30.0, 100.75;
+  Eigen::Matrix3Xd bearings_cached, bearings_built;
+  std::vector<unsigned char> success_cached, success_built;
+  camera.getNormalizedBearingVectors(keypoints, &bearings_cached, &success_cached);
+  cache.getNCamera().getCamera(0u).getNormalizedBearingVectors(
+      keypoints, &bearings_built, &success_built);
+  EXPECT_TRUE(EIGEN_MATRIX_EQUAL(bearings_cached, bearings_built));
+  EXPECT_EQ(success_cached, success_built);
+}
+
+TEST_F(CalibrationCacheTest, RejectsOtherCalibration) {
+  aslam::CalibrationCache cache(*ncamera_, settings_);
+  ASSERT_TRUE(cache.saveToFile(cache_file_, key_));
+  EXPECT_TRUE(aslam::CalibrationCache::loadFromFile(cache_file_, key_ + 1u) == nullptr);
+
+  aslam::UndistorterSettings other_settings = settings_;
+  other_settings.alpha = 1.0f;
+  EXPECT_NE(key_, aslam::computeCalibrationCacheKey(readFile(yaml_file_), other_settings));
+  EXPECT_NE(key_, aslam::computeCalibrationCacheKey(readFile(yaml_file_) + " ", settings_));
+}
+
+TEST_F(CalibrationCacheTest, RejectsDamagedFile) {
+  EXPECT_TRUE(aslam::CalibrationCache::loadFromFile(cache_file_, key_) == nullptr);
+
+  aslam::CalibrationCache cache(*ncamera_, settings_);
+  ASSERT_TRUE(cache.saveToFile(cache_file_, key_));
+  const std::string contents = readFile(cache_file_);
+  ASSERT_GT(contents.size(), 100u);
+
+  std::string corrupted = contents;
+  corrupted[contents.size() / 2] ^= 0x01;
+  writeFile(cache_file_, corrupted);
+  EXPECT_TRUE(aslam::CalibrationCache::loadFromFile(cache_file_, key_) == nullptr);
+
+  writeFile(cache_file_, contents.substr(0u, contents.size() - 1u));
+  EXPECT_TRUE(aslam::CalibrationCache::loadFromFile(cache_file_, key_) == nullptr);
+
+  writeFile(cache_file_, contents);
+  EXPECT_TRUE(aslam::CalibrationCache::loadFromFile(cache_file_, key_) != nullptr);
+}
+
+TEST_F(CalibrationCacheTest, LoadOrBuild) {
+  std::remove(cache_file_.c_str());
+  std::unique_ptr<aslam::CalibrationCache> built_cache =
+      aslam::CalibrationCache::loadOrBuild(yaml_file_, cache_file_, settings_);
+  ASSERT_TRUE(built_cache != nullptr);
+  EXPECT_TRUE(built_cache->getNCamera().isEqual(*ncamera_, true /*verbose*/));
+
+  // The first call wrote the cache.
+  std::unique_ptr<aslam::CalibrationCache> loaded_cache =
+      aslam::CalibrationCache::loadFromFile(cache_file_, key_);
+  ASSERT_TRUE(loaded_cache != nullptr);
+  expectCachesEqual(*built_cache, *loaded_cache);
+
+  loaded_cache = aslam::CalibrationCache::loadOrBuild(yaml_file_, cache_file_, settings_);
+  ASSERT_TRUE(loaded_cache != nullptr);
+  expectCachesEqual(*built_cache, *loaded_cache);
+
+  EXPECT_TRUE(aslam::CalibrationCache::loadOrBuild(
+      "missing_calibration.yaml", cache_file_, settings_) == nullptr);
+}
+
+TEST_F(CalibrationCacheTest, RejectsUnsupportedCameras) {
+  EXPECT_TRUE(aslam::CalibrationCache::isSupported(*ncamera_));
+
+  std::vector<aslam::Camera::Ptr> cameras;
+  cameras.emplace_back(ncamera_->getCameraShared(0u));
+  cameras.emplace_back(aslam::Camera3DLidar::createTestCamera());
+  aslam::TransformationVector T_C_B_vector(2u, ncamera_->get_T_C_B(0u));
+  aslam::NCameraId ncamera_id;
+  aslam::generateId(&ncamera_id);
+  aslam::NCamera lidar_ncamera(ncamera_id, T_C_B_vector, cameras, "rig with a lidar");
+  EXPECT_FALSE(aslam::CalibrationCache::isSupported(lidar_ncamera));
+
+  lidar_ncamera.serializeToFile(yaml_file_);
+  EXPECT_TRUE(
+      aslam::CalibrationCache::loadOrBuild(yaml_file_, cache_file_, settings_) == nullptr);
+}
+
+ASLAM_UNITTEST_ENTRYPOINT